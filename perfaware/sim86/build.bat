@@ -4,14 +4,19 @@ pushd build
 
 call cl -nologo -Zi -FC ..\sim86.cpp -Fesim86_msvc_debug.exe
 call clang -g -fuse-ld=lld ..\sim86.cpp -o sim86_clang_debug.exe
-call cl -O2 -nologo -Zi -FC ..\sim86.cpp -Fesim86_msvc_release.exe
-call clang -O3 -g -fuse-ld=lld ..\sim86.cpp -o sim86_clang_release.exe
+call cl -O2 -arch:AVX2 -nologo -Zi -FC ..\sim86.cpp -Fesim86_msvc_release.exe
+call clang -O3 -mavx2 -g -fuse-ld=lld ..\sim86.cpp -o sim86_clang_release.exe
+
+call cl -O2 -nologo -Zi -FC ..\sim86_decode_bench.cpp -Fesim86_decode_bench.exe
+call cl -O2 -nologo -Zi -FC ..\sim86_packed_bench.cpp -Fesim86_packed_bench.exe
+call cl -O2 -nologo -Zi -FC ..\sim86_trace_replay.cpp -Fesim86_trace_replay.exe
+call cl -O2 -nologo -Zi -FC ..\sim86_delta_rebuild.cpp -Fesim86_delta_rebuild.exe
 
 call clang -P -E ..\sim86_lib.h | call clang-format --style="Microsoft" > ..\shared\sim86_shared.h
 call clang -P -E ..\sim86_instruction_table_standalone.h | call clang-format --style="Microsoft" > sim86_instruction_table_standalone.h
 
-call cl -nologo -Zi -FC ..\sim86_lib.cpp -Fesim86_shared_debug.dll /link /DLL /PDBALTPATH:sim86_shared_debug.pdb /export:Sim86_Decode8086Instruction /export:Sim86_RegisterNameFromOperand /export:Sim86_MnemonicFromOperationType /export:Sim86_Get8086InstructionTable /export:Sim86_GetVersion
-call cl -nologo -O2 -Zi -FC ..\sim86_lib.cpp -Fesim86_shared_release.dll /link /DLL /PDBALTPATH:sim86_shared_release.pdb /export:Sim86_Decode8086Instruction /export:Sim86_RegisterNameFromOperand /export:Sim86_MnemonicFromOperationType /export:Sim86_Get8086InstructionTable /export:Sim86_GetVersion
+call cl -nologo -Zi -FC ..\sim86_lib.cpp -Fesim86_shared_debug.dll /link /DLL /PDBALTPATH:sim86_shared_debug.pdb /export:Sim86_Decode8086Instruction /export:Sim86_DecodeBlock /export:Sim86_DecodeBlockPacked /export:Sim86_UnpackInstruction /export:Sim86_RegisterNameFromOperand /export:Sim86_MnemonicFromOperationType /export:Sim86_Get8086InstructionTable /export:Sim86_GetVersion /export:Sim86_CreateMachine /export:Sim86_FreeMachine /export:Sim86_LoadImage /export:Sim86_Run /export:Sim86_Step /export:Sim86_GetRegisters /export:Sim86_ReadMemory /export:Sim86_GetClocks
+call cl -nologo -O2 -Zi -FC ..\sim86_lib.cpp -Fesim86_shared_release.dll /link /DLL /PDBALTPATH:sim86_shared_release.pdb /export:Sim86_Decode8086Instruction /export:Sim86_DecodeBlock /export:Sim86_DecodeBlockPacked /export:Sim86_UnpackInstruction /export:Sim86_RegisterNameFromOperand /export:Sim86_MnemonicFromOperationType /export:Sim86_Get8086InstructionTable /export:Sim86_GetVersion /export:Sim86_CreateMachine /export:Sim86_FreeMachine /export:Sim86_LoadImage /export:Sim86_Run /export:Sim86_Step /export:Sim86_GetRegisters /export:Sim86_ReadMemory /export:Sim86_GetClocks
 
 call copy sim86_shared*.dll ..\shared
 call copy sim86_shared*.lib ..\shared
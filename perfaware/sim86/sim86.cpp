@@ -31,27 +31,42 @@
 #include "sim86_instruction_table.h"
 #include "sim86_memory.h"
 #include "sim86_decode.h"
+#include "sim86_decode_cache.h"
+#include "sim86_blocks.h"
 #include "sim86_execute.h"
 #include "sim86_cycles.h"
+#include "sim86_jit.h"
+#include "sim86_threaded.h"
+#include "sim86_lockstep.h"
 #include "sim86_text.h"
+#include "sim86_trace.h"
+#include "sim86_trace_writer.h"
+#include "sim86_snapshot.h"
+#include "sim86_delta.h"
+#include "sim86_delta_writer.h"
+#include "sim86_profile.h"
+#include "sim86_loops.h"
+#include "sim86_platform.h"
 
 #include "sim86_instruction.cpp"
 #include "sim86_instruction_table.cpp"
 #include "sim86_memory.cpp"
 #include "sim86_decode.cpp"
+#include "sim86_decode_cache.cpp"
+#include "sim86_blocks.cpp"
 #include "sim86_execute.cpp"
 #include "sim86_cycles.cpp"
+#include "sim86_threaded.cpp"
+#include "sim86_lockstep.cpp"
 #include "sim86_text_table.cpp"
 #include "sim86_text.cpp"
-
-enum sim_flags
-{
-    SimFlag_StopOnRet = 0x1,
-    SimFlag_ShowClocks = 0x2,
-    SimFlag_DumpMemory = 0x4,
-    SimFlag_ExplainClocks = 0x8,
-    SimFlag_NoRegisterDiffs = 0x10,
-};
+#include "sim86_trace_writer.cpp"
+#include "sim86_snapshot.cpp"
+#include "sim86_delta_writer.cpp"
+#include "sim86_profile.cpp"
+#include "sim86_loops.cpp"
+#include "sim86_platform.cpp"
+#include "sim86_jit.cpp"
 
 static u32 LoadMemoryFromFile(char *FileName, segmented_access SegMem, u32 AtOffset)
 {
@@ -78,177 +93,1332 @@ static u32 LoadMemoryFromFile(char *FileName, segmented_access SegMem, u32 AtOff
     return Result;
 }
 
+static u8 *LoadPaddedImageFromFile(char *FileName, u32 Padding, u32 *ByteCount)
+{
+    // NOTE: Unlike LoadMemoryFromFile, this loads the whole file no matter how big it is,
+    // followed by Padding bytes of zeroes.
+    u8 *Result = 0;
+    *ByteCount = 0;
+    
+    FILE *File = fopen(FileName, "rb");
+    if(File)
+    {
+        fseek(File, 0, SEEK_END);
+        long Size = ftell(File);
+        fseek(File, 0, SEEK_SET);
+        
+        if((Size >= 0) && ((u64)Size <= (0xffffffffull - Padding)))
+        {
+            Result = (u8 *)calloc(1, (size_t)Size + Padding);
+            if(Result)
+            {
+                *ByteCount = (u32)fread(Result, 1, (size_t)Size, File);
+            }
+            else
+            {
+                fprintf(stderr, "ERROR: Unable to allocate space for %s.\n", FileName);
+            }
+        }
+        else
+        {
+            fprintf(stderr, "ERROR: %s is too large.\n", FileName);
+        }
+        
+        fclose(File);
+    }
+    else
+    {
+        fprintf(stderr, "ERROR: Unable to open %s.\n", FileName);
+    }
+    
+    return Result;
+}
+
 static segmented_access AllocateMemoryPow2(u32 SizePow2)
 {
     static u8 FailedAllocationByte;
     
-    u8 *Memory = (u8 *)malloc(1 << SizePow2);
-    if(!Memory)
+    // NOTE: Memory is mirrored when the OS allows it, so that word and string accesses that wrap
+    // around the end of memory can still be done directly (see AccessContiguousMemory).
+    u32 MirrorSize = (SizePow2 >= 16) ? (1 << SizePow2) : 0;
+    u8 *Memory = MirrorSize ? AllocateMirroredMemory(MirrorSize) : 0;
+    if(!Memory)
+    {
+        MirrorSize = 0;
+        Memory = (u8 *)malloc(1 << SizePow2);
+    }
+    
+    if(!Memory)
+    {
+        SizePow2 = 0;
+        Memory = &FailedAllocationByte;
+    }
+    
+    segmented_access Result = FixedMemoryPow2(SizePow2, Memory);
+    Result.MirrorSize = MirrorSize;
+    return Result;
+}
+
+static void FreeMemoryPow2(segmented_access Memory)
+{
+    if(Memory.MirrorSize)
+    {
+        FreeMirroredMemory(Memory.Memory, Memory.MirrorSize);
+    }
+    else
+    {
+        free(Memory.Memory);
+    }
+}
+
+static instruction DecodeAndCheck(instruction_table Table, segmented_access At, u32 SimFlags)
+{
+    instruction Result = DecodeInstruction(Table, At);
+    
+    if(SimFlags & SimFlag_CheckDecode)
+    {
+        // NOTE: The interpreted decoder is the reference, so if the two ever disagree,
+        // report it and carry on with what the reference decoder produced.
+        instruction Reference = DecodeInstruction(Table, At, Decode_Interpreted);
+        if(memcmp(&Result, &Reference, sizeof(Result)) != 0)
+        {
+            fprintf(stderr, "ERROR: Specialized decoder does not match reference decoder at address %u.\n",
+                    GetAbsoluteAddressOf(At));
+            Result = Reference;
+        }
+    }
+    
+    return Result;
+}
+
+static void DisAsm8086(u32 DisAsmByteCount, segmented_access DisAsmStart, u32 SimFlags, timing_state Timing, FILE *Out)
+{
+    segmented_access At = DisAsmStart;
+    
+    instruction_table Table = Get8086InstructionTable();
+
+    // NOTE(casey): When not simulating, assume branches are taken, since that is what most loop conditionals will do
+    // and that is what we would normally be timing.
+    Timing.AssumeBranchTaken = true;
+    instruction_clock_interval TimeAccum = {};
+    
+    u32 Count = DisAsmByteCount;
+    while(Count)
+    {
+        instruction Instruction = DecodeAndCheck(Table, At, SimFlags);
+        if(Instruction.Op)
+        {
+            if(Count >= Instruction.Size)
+            {
+                At = MoveBaseBy(At, Instruction.Size);
+                Count -= Instruction.Size;
+            }
+            else
+            {
+                fprintf(stderr, "ERROR: Instruction extends outside disassembly region\n");
+                break;
+            }
+            
+            PrintInstruction(Instruction, Out);
+            if(SimFlags & SimFlag_ShowClocks)
+            {
+                fprintf(Out, " ; ");
+                PrintEstimatedClocks(Timing, Instruction, SimFlags, &TimeAccum, Out);
+            }
+            fprintf(Out, "\n");
+        }
+        else
+        {
+            fprintf(stderr, "ERROR: Unrecognized binary in instruction stream.\n");
+            break;
+        }
+    }
+}
+
+static void PrintUnreachedBytes(segmented_access Memory, u32 Address, u32 EndAddress, FILE *Out)
+{
+    // NOTE: Bytes that no path reached are printed as data, so the output still reassembles to the same image.
+    fprintf(Out, "; 0x%05x-0x%05x not reached\n", Address, EndAddress);
+    while(Address < EndAddress)
+    {
+        fprintf(Out, "db ");
+        for(u32 Index = 0; (Index < 16) && (Address < EndAddress); ++Index, ++Address)
+        {
+            fprintf(Out, "%s0x%02x", Index ? ", " : "", *AccessMemory(AtBlockAddress(Memory, Address)));
+        }
+        fprintf(Out, "\n");
+    }
+}
+
+static void PrintBlockEdge(block_edge Edge, FILE *Out)
+{
+    char const *KindNames[] = {"fallthrough", "taken", "call"};
+    fprintf(Out, " %s 0x%05x", KindNames[Edge.Kind], Edge.Address);
+    if(Edge.Block != BLOCK_NONE)
+    {
+        fprintf(Out, " (block %u)", Edge.Block);
+    }
+    else
+    {
+        fprintf(Out, " (none)");
+    }
+}
+
+static void DisAsmBlocks8086(u32 DisAsmByteCount, segmented_access DisAsmStart, u32 SimFlags, timing_state Timing, FILE *Out)
+{
+    instruction_table Table = Get8086InstructionTable();
+    
+    Timing.AssumeBranchTaken = true;
+    
+    u32 Entry = 0;
+    block_graph Graph = BuildBlockGraph(Table, DisAsmStart, DisAsmByteCount, 1, &Entry);
+    
+    u32 Address = 0;
+    for(u32 BlockIndex = 0; BlockIndex < Graph.BlockCount; ++BlockIndex)
+    {
+        basic_block *Block = Graph.Blocks + BlockIndex;
+        if(Address < Block->Address)
+        {
+            PrintUnreachedBytes(DisAsmStart, Address, Block->Address, Out);
+        }
+        
+        fprintf(Out, "; block %u: 0x%05x-0x%05x, %u instructions%s\n", BlockIndex, Block->Address,
+                Block->Address + Block->ByteCount, Block->InstructionCount, (Block->Flags & Block_Entry) ? ", entry" : "");
+        
+        instruction_clock_interval TimeAccum = {};
+        for(u32 Index = 0; Index < Block->InstructionCount; ++Index)
+        {
+            instruction Instruction = UnpackInstruction(Graph.Instructions[Block->FirstInstruction + Index]);
+            PrintInstruction(Instruction, Out);
+            if(SimFlags & SimFlag_ShowClocks)
+            {
+                // NOTE: Clocks are totalled per block, since blocks don't execute in address order.
+                fprintf(Out, " ; ");
+                PrintEstimatedClocks(Timing, Instruction, SimFlags, &TimeAccum, Out);
+            }
+            fprintf(Out, "\n");
+        }
+        
+        fprintf(Out, "; successors:");
+        for(u32 EdgeIndex = 0; EdgeIndex < Block->EdgeCount; ++EdgeIndex)
+        {
+            PrintBlockEdge(Block->Edges[EdgeIndex], Out);
+        }
+        if(Block->Flags & Block_IndirectExit) {fprintf(Out, " indirect");}
+        if(Block->Flags & Block_IndirectCall) {fprintf(Out, " indirect-call");}
+        if(Block->Flags & Block_Halt) {fprintf(Out, " halt");}
+        if(Block->Flags & Block_DecodeError) {fprintf(Out, " decode-error");}
+        if(Block->Flags & Block_Overlap) {fprintf(Out, " overlap");}
+        fprintf(Out, "\n");
+        
+        Address = Block->Address + Block->ByteCount;
+    }
+    
+    if(Address < DisAsmByteCount)
+    {
+        PrintUnreachedBytes(DisAsmStart, Address, DisAsmByteCount, Out);
+    }
+    
+    FreeBlockGraph(&Graph);
+}
+
+/* NOTE: The parallel disassembler works on a flat image rather than the 8086's memory, so that
+   it can handle images far larger than 1mb. The image is split into chunks, and each chunk is decoded
+   speculatively from every offset the true instruction stream could enter it at (since no instruction
+   is longer than MaxInstructionByteCount, that is only the first few bytes of the chunk). Speculative
+   streams usually fall into step with each other within a few instructions, so each one only has to be
+   decoded until it lands on an instruction boundary of the stream that starts at the chunk's first byte.
+   
+   Once every chunk knows where each of its possible entry points comes out, the true stream is stitched
+   together chunk by chunk, which is just a table lookup per chunk. Then the chunks are decoded again
+   from their true entry points and printed to their own temporary files in parallel, which get copied
+   to stdout in order, so the output is exactly what the sequential disassembler would print. */
+
+#define DISASM_CANDIDATE_COUNT 16
+#define DISASM_IMAGE_PADDING 64
+#define DISASM_MIN_CHUNK_SIZE (64*1024)
+
+enum disasm_stop
+{
+    DisAsmStop_None,
+    DisAsmStop_Unrecognized,
+    DisAsmStop_OutsideRegion,
+};
+
+struct disasm_exit
+{
+    u32 Offset; // NOTE: The first instruction boundary at or past the chunk's end, or where decoding stopped
+    disasm_stop Stop;
+};
+
+struct disasm_chunk
+{
+    u32 Begin;
+    u32 End;
+    disasm_exit Candidates[DISASM_CANDIDATE_COUNT];
+    
+    u32 Entry;
+    disasm_exit Exit;
+    instruction_clock_interval ClocksBefore;
+    instruction_clock_interval Clocks;
+    FILE *Output;
+};
+
+enum disasm_phase
+{
+    DisAsmPhase_Speculate,
+    DisAsmPhase_SumClocks,
+    DisAsmPhase_Print,
+};
+
+struct parallel_disasm
+{
+    u8 *Image;
+    u32 ByteCount;
+    u32 SimFlags;
+    timing_state Timing;
+    instruction_table Table;
+    
+    u32 ThreadCount;
+    u32 ChunkCount;
+    disasm_chunk *Chunks;
+    u8 *Boundaries;
+    u32 BoundaryStride;
+    
+    disasm_phase Phase;
+};
+
+static instruction DecodeFromImage(parallel_disasm *DisAsm, u32 Offset)
+{
+    // NOTE: The image is padded, so the decoder can always look past the end of it.
+    segmented_access At = FixedMemoryPow2(20, DisAsm->Image + Offset);
+    instruction Result = DecodeAndCheck(DisAsm->Table, At, DisAsm->SimFlags);
+    return Result;
+}
+
+static disasm_stop GetDisAsmStop(parallel_disasm *DisAsm, u32 Offset, instruction Instruction)
+{
+    disasm_stop Result = DisAsmStop_None;
+    if(!Instruction.Op)
+    {
+        Result = DisAsmStop_Unrecognized;
+    }
+    else if(Instruction.Size > (DisAsm->ByteCount - Offset))
+    {
+        Result = DisAsmStop_OutsideRegion;
+    }
+    
+    return Result;
+}
+
+static void SpeculateChunk(parallel_disasm *DisAsm, disasm_chunk *Chunk, u8 *Boundaries, b32 FirstChunk)
+{
+    u32 ChunkSize = Chunk->End - Chunk->Begin;
+    memset(Boundaries, 0, (ChunkSize + 7) / 8);
+    
+    // NOTE: Decode from the first byte of the chunk, remembering where every instruction starts.
+    disasm_exit Main = {};
+    u32 Offset = Chunk->Begin;
+    while(Offset < Chunk->End)
+    {
+        u32 Rel = Offset - Chunk->Begin;
+        Boundaries[Rel / 8] |= (u8)(1 << (Rel % 8));
+        
+        instruction Instruction = DecodeFromImage(DisAsm, Offset);
+        Main.Stop = GetDisAsmStop(DisAsm, Offset, Instruction);
+        if(Main.Stop)
+        {
+            break;
+        }
+        
+        Offset += Instruction.Size;
+    }
+    Main.Offset = Offset;
+    Chunk->Candidates[0] = Main;
+    
+    // NOTE: Then from every other entry point, until the stream lands on one of those instructions.
+    u32 CandidateCount = FirstChunk ? 1 : DisAsm->Table.MaxInstructionByteCount;
+    for(u32 CandidateIndex = 1; CandidateIndex < CandidateCount; ++CandidateIndex)
+    {
+        disasm_exit Exit = {};
+        Offset = Chunk->Begin + CandidateIndex;
+        while(Offset < Chunk->End)
+        {
+            u32 Rel = Offset - Chunk->Begin;
+            if(Boundaries[Rel / 8] & (1 << (Rel % 8)))
+            {
+                break;
+            }
+            
+            instruction Instruction = DecodeFromImage(DisAsm, Offset);
+            Exit.Stop = GetDisAsmStop(DisAsm, Offset, Instruction);
+            if(Exit.Stop)
+            {
+                break;
+            }
+            
+            Offset += Instruction.Size;
+        }
+        Exit.Offset = Offset;
+        
+        if((Offset < Chunk->End) && !Exit.Stop)
+        {
+            Exit = Main;
+        }
+        
+        Chunk->Candidates[CandidateIndex] = Exit;
+    }
+}
+
+static void PrintChunk(parallel_disasm *DisAsm, disasm_chunk *Chunk, b32 PrintText)
+{
+    instruction_clock_interval TimeAccum = Chunk->ClocksBefore;
+    instruction_clock_interval ChunkClocks = {};
+    
+    u32 Offset = Chunk->Entry;
+    while(Offset < Chunk->Exit.Offset)
+    {
+        instruction Instruction = DecodeFromImage(DisAsm, Offset);
+        Offset += Instruction.Size;
+        
+        if(PrintText)
+        {
+            PrintInstruction(Instruction, Chunk->Output);
+            if(DisAsm->SimFlags & SimFlag_ShowClocks)
+            {
+                fprintf(Chunk->Output, " ; ");
+                PrintEstimatedClocks(DisAsm->Timing, Instruction, DisAsm->SimFlags, &TimeAccum, Chunk->Output);
+            }
+            fprintf(Chunk->Output, "\n");
+        }
+        else
+        {
+            instruction_timing Timing = EstimateInstructionClocks(DisAsm->Timing, Instruction);
+            instruction_clock_interval Clocks = ExpectedClocksFrom(DisAsm->Timing, Instruction, Timing);
+            ChunkClocks.Min += Clocks.Min;
+            ChunkClocks.Max += Clocks.Max;
+        }
+    }
+    
+    Chunk->Clocks = ChunkClocks;
+}
+
+static void ParallelDisAsmThread(void *Param, u32 ThreadIndex)
+{
+    parallel_disasm *DisAsm = (parallel_disasm *)Param;
+    u8 *Boundaries = DisAsm->Boundaries + ThreadIndex*DisAsm->BoundaryStride;
+    
+    for(u32 ChunkIndex = ThreadIndex; ChunkIndex < DisAsm->ChunkCount; ChunkIndex += DisAsm->ThreadCount)
+    {
+        disasm_chunk *Chunk = DisAsm->Chunks + ChunkIndex;
+        switch(DisAsm->Phase)
+        {
+            case DisAsmPhase_Speculate: {SpeculateChunk(DisAsm, Chunk, Boundaries, (ChunkIndex == 0));} break;
+            case DisAsmPhase_SumClocks: {PrintChunk(DisAsm, Chunk, false);} break;
+            case DisAsmPhase_Print: {if(Chunk->Output) {PrintChunk(DisAsm, Chunk, true);}} break;
+        }
+    }
+}
+
+static void ParallelDisAsm8086(u32 ByteCount, u8 *Image, u32 ThreadCount, u32 SimFlags, timing_state Timing, FILE *Out)
+{
+    parallel_disasm DisAsm = {};
+    DisAsm.Image = Image;
+    DisAsm.ByteCount = ByteCount;
+    DisAsm.SimFlags = SimFlags;
+    DisAsm.Timing = Timing;
+    DisAsm.Timing.AssumeBranchTaken = true;
+    DisAsm.Table = Get8086InstructionTable();
+    DisAsm.ThreadCount = ThreadCount;
+    
+    assert(DisAsm.Table.MaxInstructionByteCount <= DISASM_CANDIDATE_COUNT);
+    
+    // NOTE: A few chunks per thread evens out chunks that take longer than others.
+    u32 ChunkSize = (u32)(((u64)ByteCount + 4*ThreadCount - 1) / (4*ThreadCount));
+    if(ChunkSize < DISASM_MIN_CHUNK_SIZE)
+    {
+        ChunkSize = DISASM_MIN_CHUNK_SIZE;
+    }
+    DisAsm.ChunkCount = (ByteCount + ChunkSize - 1) / ChunkSize;
+    DisAsm.BoundaryStride = (ChunkSize + 7) / 8;
+    DisAsm.Chunks = (disasm_chunk *)calloc(DisAsm.ChunkCount, sizeof(disasm_chunk));
+    DisAsm.Boundaries = (u8 *)malloc((size_t)ThreadCount*DisAsm.BoundaryStride);
+    if(!DisAsm.Chunks || !DisAsm.Boundaries)
+    {
+        fprintf(stderr, "ERROR: Unable to allocate parallel disassembly state.\n");
+        free(DisAsm.Chunks);
+        free(DisAsm.Boundaries);
+        return;
+    }
+    
+    for(u32 ChunkIndex = 0; ChunkIndex < DisAsm.ChunkCount; ++ChunkIndex)
+    {
+        disasm_chunk *Chunk = DisAsm.Chunks + ChunkIndex;
+        Chunk->Begin = ChunkIndex*ChunkSize;
+        Chunk->End = (ByteCount - Chunk->Begin) > ChunkSize ? (Chunk->Begin + ChunkSize) : ByteCount;
+    }
+    
+    DisAsm.Phase = DisAsmPhase_Speculate;
+    RunOnThreads(ThreadCount, ParallelDisAsmThread, &DisAsm);
+    
+    // NOTE: Stitch the true stream together. Anything after a chunk that stopped is not printed.
+    disasm_stop Stop = DisAsmStop_None;
+    u32 Entry = 0;
+    u32 PrintChunkCount = 0;
+    while((PrintChunkCount < DisAsm.ChunkCount) && !Stop)
+    {
+        disasm_chunk *Chunk = DisAsm.Chunks + PrintChunkCount++;
+        
+        u32 CandidateIndex = Entry - Chunk->Begin;
+        assert(CandidateIndex < DisAsm.Table.MaxInstructionByteCount);
+        
+        Chunk->Entry = Entry;
+        Chunk->Exit = Chunk->Candidates[CandidateIndex];
+        Entry = Chunk->Exit.Offset;
+        Stop = Chunk->Exit.Stop;
+    }
+    DisAsm.ChunkCount = PrintChunkCount;
+    
+    if(SimFlags & SimFlag_ShowClocks)
+    {
+        // NOTE: Clocks are printed as a running total, so each chunk needs the total of all the chunks before it.
+        DisAsm.Phase = DisAsmPhase_SumClocks;
+        RunOnThreads(ThreadCount, ParallelDisAsmThread, &DisAsm);
+        
+        instruction_clock_interval Total = {};
+        for(u32 ChunkIndex = 0; ChunkIndex < DisAsm.ChunkCount; ++ChunkIndex)
+        {
+            disasm_chunk *Chunk = DisAsm.Chunks + ChunkIndex;
+            Chunk->ClocksBefore = Total;
+            Total.Min += Chunk->Clocks.Min;
+            Total.Max += Chunk->Clocks.Max;
+        }
+    }
+    
+    b32 OutputValid = true;
+    for(u32 ChunkIndex = 0; ChunkIndex < DisAsm.ChunkCount; ++ChunkIndex)
+    {
+        DisAsm.Chunks[ChunkIndex].Output = tmpfile();
+        OutputValid = OutputValid && DisAsm.Chunks[ChunkIndex].Output;
+    }
+    
+    if(OutputValid)
+    {
+        DisAsm.Phase = DisAsmPhase_Print;
+        RunOnThreads(ThreadCount, ParallelDisAsmThread, &DisAsm);
+        
+        for(u32 ChunkIndex = 0; ChunkIndex < DisAsm.ChunkCount; ++ChunkIndex)
+        {
+            FILE *Output = DisAsm.Chunks[ChunkIndex].Output;
+            rewind(Output);
+            
+            char Buffer[64*1024];
+            size_t BytesRead;
+            while((BytesRead = fread(Buffer, 1, sizeof(Buffer), Output)) > 0)
+            {
+                fwrite(Buffer, 1, BytesRead, Out);
+            }
+        }
+        
+        if(Stop == DisAsmStop_Unrecognized)
+        {
+            fprintf(stderr, "ERROR: Unrecognized binary in instruction stream.\n");
+        }
+        else if(Stop == DisAsmStop_OutsideRegion)
+        {
+            fprintf(stderr, "ERROR: Instruction extends outside disassembly region\n");
+        }
+    }
+    else
+    {
+        fprintf(stderr, "ERROR: Unable to create temporary files for parallel disassembly.\n");
+    }
+    
+    for(u32 ChunkIndex = 0; ChunkIndex < DisAsm.ChunkCount; ++ChunkIndex)
+    {
+        if(DisAsm.Chunks[ChunkIndex].Output)
+        {
+            fclose(DisAsm.Chunks[ChunkIndex].Output);
+        }
+    }
+    
+    free(DisAsm.Chunks);
+    free(DisAsm.Boundaries);
+}
+
+static void AccumulateClocks(timing_state *Timing, instruction Instruction, exec_result Exec, instruction_clock_interval *Accum)
+{
+    UpdateTimingForExec(Timing, Exec);
+    instruction_clock_interval Clocks = ClocksForExec(Timing, Instruction, EstimateInstructionClocks(*Timing, Instruction));
+    Accum->Min += Clocks.Min;
+    Accum->Max += Clocks.Max;
+}
+
+static void PrintRunSummary(u64 InstructionCount, instruction_clock_interval Clocks, u64 OSElapsed, FILE *Out)
+{
+    // NOTE: This is all -quiet prints besides the final registers.
+    double Seconds = (double)OSElapsed / (double)GetOSTimerFreq();
+    
+    fprintf(Out, "\n");
+    fprintf(Out, "Instructions: %llu\n", (unsigned long long)InstructionCount);
+    if(Clocks.Min != Clocks.Max)
+    {
+        fprintf(Out, "Clocks: [%u,%u]\n", Clocks.Min, Clocks.Max);
+    }
+    else
+    {
+        fprintf(Out, "Clocks: %u\n", Clocks.Min);
+    }
+    fprintf(Out, "Time: %.4f seconds", Seconds);
+    if(Seconds > 0)
+    {
+        fprintf(Out, " (%.2f million instructions/second)", 1e-6*(double)InstructionCount / Seconds);
+    }
+    fprintf(Out, "\n");
+}
+
+static void Run8086(u32 OnePastLastByte, segmented_access MainMemory, u32 SimFlags, timing_state Timing, FILE *Out,
+                    trace_writer *Trace = 0, machine_snapshot *Snapshot = 0, u16 SnapshotCS = 0, u16 SnapshotIP = 0)
+{
+    instruction_table Table = Get8086InstructionTable();
+    register_state_8086 Registers = {};
+    instruction_clock_interval TimeAccum = {};
+    u64 InstructionCount = 0;
+    
+    // NOTE: If the snapshot has already been taken, the run starts from it. Otherwise, it gets
+    // taken right before the instruction at SnapshotCS:SnapshotIP executes for the first time.
+    if(Snapshot && Snapshot->Taken)
+    {
+        RestoreSnapshot(Snapshot, MainMemory, &Registers, &Timing, &TimeAccum, &InstructionCount);
+        OnePastLastByte = Snapshot->OnePastLastByte;
+        Snapshot = 0;
+    }
+    
+    // NOTE: Flags are only worked out when something reads them (see lazy_flags). Unless this is
+    // -quiet, every instruction gets printed or traced, so that's after every instruction anyway.
+    lazy_flags LazyFlags = {};
+    lazy_flags *Lazy = (SimFlags & SimFlag_EagerFlags) ? 0 : &LazyFlags;
+    
+    u64 OSStart = ReadOSTimer();
+    
+    // NOTE: Each instruction only needs to be decoded the first time it is executed. Writes to
+    // main memory are watched so that cached instructions get thrown out if their bytes change. If there
+    // isn't memory for the cache, everything still works, it just decodes every instruction every time.
+    decode_cache *Cache = (decode_cache *)calloc(1, sizeof(decode_cache));
+    if(Cache)
+    {
+        MainMemory.Watch = &Cache->Watch;
+    }
+    
+    // NOTE: When tracing, nothing is printed per instruction. The trace has everything needed to
+    // print it later (see sim86_trace.h).
+    trace_stop Stop = TraceStop_OutOfBounds;
+    u32 StopValue = 0;
+    if(Trace)
+    {
+        MainMemory.WriteLog = &Trace->WriteLog;
+    }
+    
+    execution_profile Profile = {};
+    b32 Profiling = false;
+    if(SimFlags & SimFlag_Profile)
+    {
+        Profiling = BeginProfile(&Profile, OnePastLastByte);
+        if(!Profiling)
+        {
+            fprintf(stderr, "ERROR: Unable to allocate space for a profile.\n");
+        }
+    }
+    
+    for(;;)
+    {
+        segmented_access At = MainMemory;
+        At.Mask = 0xffff;
+        At.SegmentBase = Registers.cs;
+        At.SegmentOffset = Registers.ip;
+        
+        if(GetAbsoluteAddressOf(At) < OnePastLastByte)
+        {
+            instruction Instruction = {};
+            if(!Cache || !GetCachedInstruction(Cache, At, &Instruction))
+            {
+                Instruction = DecodeAndCheck(Table, At, SimFlags);
+                if(Cache)
+                {
+                    CacheInstruction(Cache, At, Instruction);
+                }
+            }
+            
+            if(Instruction.Op)
+            {
+                if(Snapshot && (Registers.cs == SnapshotCS) && (Registers.ip == SnapshotIP))
+                {
+                    MaterializeFlags(&Registers, Lazy);
+                    if(!TakeSnapshot(Snapshot, &MainMemory, OnePastLastByte, &Registers, Timing, TimeAccum, InstructionCount))
+                    {
+                        fprintf(stderr, "ERROR: Unable to allocate space for a snapshot.\n");
+                    }
+                    Snapshot = 0;
+                }
+                
+                register_state_8086 PrevRegisters = Registers;
+                
+                if((SimFlags & SimFlag_StopOnRet) &&
+                   IsRet(Instruction.Op))
+                {
+                    fprintf(Out, "STOPONRET: Return encountered at address %u.\n", Instruction.Address);
+                    Stop = TraceStop_Return;
+                    StopValue = Instruction.Address;
+                    break;
+                }
+                
+                if(Trace)
+                {
+                    BeginTraceStep(Trace, At, Instruction, &Registers, TimeAccum);
+                }
+                
+                Registers.ip += Instruction.Size;
+                exec_result Exec = ExecInstruction(MainMemory, &Registers, Instruction, Lazy);
+                if(Cache)
+                {
+                    InvalidateWrittenInstructions(Cache);
+                }
+                
+                if(!Exec.Unimplemented)
+                {
+                    ++InstructionCount;
+                    if(Trace)
+                    {
+                        MaterializeFlags(&Registers, Lazy);
+                        EndTraceStep(Trace, MainMemory, Exec, &Registers);
+                    }
+                    
+                    instruction_clock_interval PrevTimeAccum = TimeAccum;
+                    if(Trace || (SimFlags & SimFlag_Quiet))
+                    {
+                        AccumulateClocks(&Timing, Instruction, Exec, &TimeAccum);
+                    }
+                    else
+                    {
+                        MaterializeFlags(&Registers, Lazy);
+                        PrintExecutedInstruction(Instruction, Exec, &PrevRegisters, &Registers, SimFlags, &Timing, &TimeAccum, Out);
+                        if(Profiling && !(SimFlags & SimFlag_ShowClocks))
+                        {
+                            AccumulateClocks(&Timing, Instruction, Exec, &TimeAccum);
+                        }
+                    }
+                    
+                    if(Profiling)
+                    {
+                        instruction_clock_interval Clocks = {TimeAccum.Min - PrevTimeAccum.Min, TimeAccum.Max - PrevTimeAccum.Max};
+                        u32 NextAddress = GetAbsoluteAddressOf(MainMemory.Mask, Registers.cs, Registers.ip, 0);
+                        ProfileStep(&Profile, GetAbsoluteAddressOf(At), Instruction, Exec, Clocks, NextAddress);
+                    }
+                }
+                else
+                {
+                    fprintf(Out, "ERROR: Unimplemented instruction (%s).\n", GetMnemonic(Instruction.Op));
+                    Stop = TraceStop_Unimplemented;
+                    StopValue = Instruction.Op;
+                    break;
+                }
+            }
+            else
+            {
+                fprintf(stderr, "ERROR: Unrecognized binary in instruction stream.\n");
+                Stop = TraceStop_DecodeError;
+                break;
+            }
+        }
+        else
+        {
+            break;
+        }
+    }
+    
+    free(Cache);
+    MaterializeFlags(&Registers, Lazy);
+    
+    if(Trace)
+    {
+        EndTrace(Trace, Stop, StopValue, &Registers);
+    }
+    
+    if(SimFlags & SimFlag_Quiet)
+    {
+        PrintRunSummary(InstructionCount, TimeAccum, ReadOSTimer() - OSStart, Out);
+    }
+    
+    PrintFinalRegisters(&Registers, Out);
+    
+    if(Profiling)
+    {
+        PrintProfile(&Profile, MainMemory, Out);
+        EndProfile(&Profile);
+    }
+}
+
+static void RunThreaded8086(u32 OnePastLastByte, segmented_access MainMemory, u32 SimFlags, timing_state Timing, FILE *Out)
+{
+    // NOTE: Same as Run8086, including the output, but runs on pre-decoded blocks (see sim86_threaded.cpp).
+    // If there isn't memory for the blocks, it just falls back to the regular interpreter.
+    threaded_machine *Machine = CreateThreadedMachine(MainMemory, OnePastLastByte, Timing, (SimFlags & SimFlag_StopOnRet));
+    if(!Machine)
+    {
+        Run8086(OnePastLastByte, MainMemory, SimFlags, Timing, Out);
+        return;
+    }
+    
+    if(SimFlags & SimFlag_EagerFlags)
+    {
+        Machine->Lazy = 0;
+    }
+    
+    instruction_clock_interval TimeAccum = {};
+    u64 OSStart = ReadOSTimer();
+    if(SimFlags & SimFlag_JIT)
+    {
+        // NOTE: Compiled blocks run many instructions at a time, so there is no per-instruction output.
+        if(!SIM86_JIT_SUPPORTED)
+        {
+            fprintf(stderr, "WARNING: The JIT only generates x86-64 code, running the threaded engine instead.\n");
+        }
+        else if(!EnableJIT(Machine))
+        {
+            fprintf(stderr, "WARNING: Unable to allocate executable memory, running without the JIT.\n");
+        }
+        RunJIT(Machine, (SimFlags & SimFlag_VerifyJIT));
+    }
+    else if(SimFlags & SimFlag_Quiet)
+    {
+        RunThreaded(Machine);
+    }
+    
+    while(!Machine->Stop)
+    {
+        threaded_block *Block = GetThreadedBlock(Machine);
+        if(Block)
+        {
+            // NOTE: Ops are run one at a time here, rather than with RunThreadedBlock, so that each one
+            // can be printed as it executes.
+            threaded_op *Op = Block->Ops;
+            threaded_op *End = Block->Ops + Block->OpCount;
+            while(Op && (Op < End))
+            {
+                register_state_8086 PrevRegisters = Machine->Registers;
+                Machine->Exec = {};
+                
+                threaded_op *Next = RunThreadedOp(Machine, Op);
+                MaterializeFlags(&Machine->Registers, Machine->Lazy);
+                if(Machine->Stop)
+                {
+                    break;
+                }
+                
+                PrintExecutedInstruction(UnpackInstruction(Op->Instruction), Machine->Exec, &PrevRegisters,
+                                         &Machine->Registers, SimFlags, &Timing, &TimeAccum, Out);
+                Op = Next;
+            }
+        }
+    }
+    
+    packed_instruction *StopInstruction = Machine->StopOp ? &Machine->StopOp->Instruction : 0;
+    switch(Machine->Stop)
+    {
+        case ThreadedStop_Return:
+        {
+            fprintf(Out, "STOPONRET: Return encountered at address %u.\n", StopInstruction->Address);
+        } break;
+        
+        case ThreadedStop_Unimplemented:
+        {
+            fprintf(Out, "ERROR: Unimplemented instruction (%s).\n", GetMnemonic((operation_type)StopInstruction->Op));
+        } break;
+        
+        case ThreadedStop_DecodeError:
+        {
+            fprintf(stderr, "ERROR: Unrecognized binary in instruction stream.\n");
+        } break;
+        
+        default: {} break;
+    }
+    
+    if(SimFlags & SimFlag_Quiet)
+    {
+        PrintRunSummary(Machine->InstructionCount, Machine->Clocks, ReadOSTimer() - OSStart, Out);
+    }
+    else if((SimFlags & SimFlag_JIT) && (SimFlags & SimFlag_ShowClocks))
+    {
+        instruction_clock_interval Clocks = Machine->Clocks;
+        if(Clocks.Min != Clocks.Max)
+        {
+            fprintf(Out, "\nClocks: [%u,%u]\n", Clocks.Min, Clocks.Max);
+        }
+        else
+        {
+            fprintf(Out, "\nClocks: %u\n", Clocks.Min);
+        }
+    }
+    
+    PrintFinalRegisters(&Machine->Registers, Out);
+    
+    FreeThreadedMachine(Machine);
+}
+
+static void RunLockstep8086(u32 OnePastLastByte, segmented_access MainMemory, u32 SimFlags, u32 LaneCount,
+                            char *LaneDataFileName, u32 LaneDataAddress, FILE *Out)
+{
+    // NOTE: Runs the program on LaneCount 8086s at once (see sim86_lockstep.h). With a lane data file,
+    // the file is split evenly between the lanes, and each lane gets its part at LaneDataAddress. Nothing is
+    // printed per instruction, just how fast it went and where each lane ended up.
+    lockstep_machine *Machine = CreateLockstepMachine(LaneCount, MainMemory, OnePastLastByte, (SimFlags & SimFlag_StopOnRet));
+    if(!Machine)
+    {
+        fprintf(stderr, "ERROR: Unable to allocate memory for %u lanes.\n", LaneCount);
+        return;
+    }
+    
+    Machine->EagerFlags = (SimFlags & SimFlag_EagerFlags);
+    
+    if(LaneDataFileName)
+    {
+        u32 ByteCount = 0;
+        u8 *Data = LoadPaddedImageFromFile(LaneDataFileName, 0, &ByteCount);
+        if(Data)
+        {
+            u32 RecordSize = ByteCount / Machine->LaneCount;
+            if(RecordSize == 0)
+            {
+                fprintf(stderr, "WARNING: %s is too small to give each of the %u lanes any data.\n", LaneDataFileName, Machine->LaneCount);
+            }
+            LoadLaneData(Machine, Data, RecordSize, LaneDataAddress);
+            free(Data);
+        }
+    }
+    
+    u64 OSStart = ReadOSTimer();
+    RunLockstep(Machine);
+    u64 OSElapsed = ReadOSTimer() - OSStart;
+    
+    char const *StopNames[LockstepStop_Count] = {"still running", "ran off the end", "hit an unrecognized instruction", "hit an unimplemented instruction", "returned"};
+    u32 StopCounts[LockstepStop_Count] = {};
+    for(u32 Lane = 0; Lane < Machine->LaneCount; ++Lane)
+    {
+        ++StopCounts[Machine->Stops[Lane] % LockstepStop_Count];
+    }
+    
+    fprintf(Out, "\nLanes: %u (", Machine->LaneCount);
+    char const *Separator = "";
+    for(u32 Stop = 0; Stop < LockstepStop_Count; ++Stop)
+    {
+        if(StopCounts[Stop])
+        {
+            fprintf(Out, "%s%u %s", Separator, StopCounts[Stop], StopNames[Stop]);
+            Separator = ", ";
+        }
+    }
+    fprintf(Out, ")\n");
+    
+    double Seconds = (double)OSElapsed / (double)GetOSTimerFreq();
+    u64 LaneInstructionCount = Machine->LaneInstructionCount;
+    fprintf(Out, "Steps: %llu\n", (unsigned long long)Machine->StepCount);
+    fprintf(Out, "Lane instructions: %llu (%llu run lane by lane)\n", (unsigned long long)LaneInstructionCount,
+            (unsigned long long)Machine->ScalarLaneInstructionCount);
+    fprintf(Out, "Time: %.4f seconds", Seconds);
+    if(Seconds > 0)
+    {
+        fprintf(Out, " (%.2f million lane instructions/second)", 1e-6*(double)LaneInstructionCount / Seconds);
+    }
+    fprintf(Out, "\n");
+    
+    // NOTE: Every other lane is printed as how it differs from lane 0, and not at all if it doesn't.
+    register_state_8086 FirstRegisters;
+    GetLaneRegisters(Machine, 0, &FirstRegisters);
+    PrintFinalRegisters(&FirstRegisters, Out);
+    for(u32 Lane = 1; Lane < Machine->LaneCount; ++Lane)
+    {
+        register_state_8086 Registers;
+        GetLaneRegisters(Machine, Lane, &Registers);
+        if(memcmp(&Registers, &FirstRegisters, sizeof(Registers)) != 0)
+        {
+            fprintf(Out, "lane %u: ", Lane);
+            PrintRegisterDifference(&FirstRegisters, &Registers, Out);
+            fprintf(Out, "\n");
+        }
+    }
+    
+    // NOTE: Lane 0's memory is what -dump gets.
+    memcpy(MainMemory.Memory, GetLaneMemory(Machine, 0).Memory, Machine->LaneMemorySize);
+    if(MainMemory.Dirty)
     {
-        SizePow2 = 0;
-        Memory = &FailedAllocationByte;
+        MarkPagesDirty(MainMemory.Dirty, 0, Machine->LaneMemorySize);
     }
     
-    segmented_access Result = FixedMemoryPow2(SizePow2, Memory);
-    return Result;
+    FreeLockstepMachine(Machine);
 }
 
-static void PrintEstimatedClocks(timing_state State, instruction Instruction, u32 SimFlags,
-                                 instruction_clock_interval *Accum)
+struct sim_file
 {
-    instruction_timing Timing = EstimateInstructionClocks(State, Instruction);
-    instruction_clock_interval Clocks = ExpectedClocksFrom(State, Instruction, Timing);
-    Accum->Min += Clocks.Min;
-    Accum->Max += Clocks.Max;
+    // NOTE: Everything about how to process one file, as the flags stood when it came up on the command line.
+    char *FileName;
+    b32 Execute;
+    b32 Restore;
+    u32 SimFlags;
+    timing_state Timing;
+    u32 ParallelThreadCount;
+    b32 MapInput;
     
-    if(Accum->Min != Accum->Max)
-    {
-        fprintf(stdout, "Clocks: +[%u,%u] = [%u,%u]", Clocks.Min, Clocks.Max, Accum->Min, Accum->Max);
-    }
-    else
+    u32 LaneCount;
+    char *LaneDataFileName;
+    u32 LaneDataAddress;
+    
+    u32 DumpIndex;
+    u32 TraceIndex;
+    
+    FILE *Output; // NOTE: Only used with -j, where the file's output waits here for the files before it
+};
+
+struct sim_batch
+{
+    sim_file *Files;
+    u32 FileCount;
+    u32 ThreadCount;
+    u32 MainMemPow2;
+};
+
+static void AssignOutputIndices(sim_file *File, u32 *DumpIndex, u32 *TraceIndex)
+{
+    // NOTE: Dump and trace files are numbered in the order their files came up on the command line.
+    // With both -dump and -dumpdelta, the full dump and the delta get the same number.
+    if(File->SimFlags & (SimFlag_DumpMemory|SimFlag_DumpDelta))
     {
-        fprintf(stdout, "Clocks: +%u = %u", Clocks.Min, Accum->Min);
+        File->DumpIndex = (*DumpIndex)++;
     }
     
-    if(SimFlags & SimFlag_ExplainClocks)
+    if(File->Execute && (File->SimFlags & SimFlag_Trace))
     {
-        ExplainTiming(Timing, Clocks, stdout);
+        File->TraceIndex = (*TraceIndex)++;
     }
 }
 
-static void DisAsm8086(u32 DisAsmByteCount, segmented_access DisAsmStart, u32 SimFlags, timing_state Timing)
+static void ProcessFile(sim_file *File, segmented_access MainMemory, u32 MainMemPow2,
+                        machine_snapshot *Snapshot, u16 SnapshotCS, u16 SnapshotIP, FILE *Out)
 {
-    segmented_access At = DisAsmStart;
+    char *FileName = File->FileName;
+    u32 SimFlags = File->SimFlags;
+    timing_state Timing = File->Timing;
+    u32 MainMemSize = (1 << MainMemPow2);
     
-    instruction_table Table = Get8086InstructionTable();
-
-    // NOTE(casey): When not simulating, assume branches are taken, since that is what most loop conditionals will do
-    // and that is what we would normally be timing.
-    Timing.AssumeBranchTaken = true;
-    instruction_clock_interval TimeAccum = {};
+    // NOTE: -restore runs the program the snapshot was taken in again, from where it was taken.
+    b32 Restore = File->Restore;
+    if(Restore)
+    {
+        FileName = Snapshot->Name;
+    }
     
-    u32 Count = DisAsmByteCount;
-    while(Count)
+    if(SimFlags & SimFlag_ShowClocks)
     {
-        instruction Instruction = DecodeInstruction(Table, At);
-        if(Instruction.Op)
+        PrintClockWarning(Out);
+    }
+    
+    if(!File->Execute && (File->MapInput || File->ParallelThreadCount))
+    {
+        // NOTE: These disassembly paths do not go through the 8086's memory. With -mmap they
+        // decode straight out of a mapping of the file, otherwise the parallel disassembler gets
+        // the whole file read into memory, so it is not limited to images that fit in 1mb.
+        mapped_file Mapped = {};
+        u32 ByteCount = 0;
+        u8 *Image = 0;
+        if(File->MapInput)
         {
-            if(Count >= Instruction.Size)
+            Mapped = MapFileForRead(FileName, DISASM_IMAGE_PADDING);
+            Image = Mapped.Data;
+            ByteCount = Mapped.ByteCount;
+            if(!Image)
             {
-                At = MoveBaseBy(At, Instruction.Size);
-                Count -= Instruction.Size;
+                fprintf(stderr, "ERROR: Unable to map %s.\n", FileName);
+            }
+        }
+        else
+        {
+            Image = LoadPaddedImageFromFile(FileName, DISASM_IMAGE_PADDING, &ByteCount);
+        }
+        
+        if(Image)
+        {
+            fprintf(Out, "; %s disassembly:\n", FileName);
+            fprintf(Out, "bits 16\n");
+            if(File->ParallelThreadCount && !(SimFlags & (SimFlag_Blocks|SimFlag_Loops)))
+            {
+                ParallelDisAsm8086(ByteCount, Image, File->ParallelThreadCount, SimFlags, Timing, Out);
             }
             else
             {
-                fprintf(stderr, "ERROR: Instruction extends outside disassembly region\n");
-                break;
+                // NOTE: The sequential disassembler sees the image the way the 8086 would,
+                // so, like LoadMemoryFromFile, only the first 1mb of it is disassembled.
+                if(ByteCount > MainMemSize)
+                {
+                    ByteCount = MainMemSize;
+                }
+                segmented_access ImageAccess = FixedMemoryPow2(MainMemPow2, Image);
+                if(SimFlags & SimFlag_Loops)
+                {
+                    AnalyzeLoops8086(ByteCount, ImageAccess, Out);
+                }
+                else if(SimFlags & SimFlag_Blocks)
+                {
+                    DisAsmBlocks8086(ByteCount, ImageAccess, SimFlags, Timing, Out);
+                }
+                else
+                {
+                    DisAsm8086(ByteCount, ImageAccess, SimFlags, Timing, Out);
+                }
+            }
+        }
+        
+        if(File->MapInput)
+        {
+            UnmapFile(&Mapped);
+        }
+        else
+        {
+            free(Image);
+        }
+    }
+    else
+    {
+        u32 BytesRead = 0;
+        if(!Restore)
+        {
+            BytesRead = LoadMemoryFromFile(FileName, MainMemory, 0);
+            if(MainMemory.Dirty)
+            {
+                MarkPagesDirty(MainMemory.Dirty, 0, BytesRead);
+            }
+        }
+        
+        if(File->Execute)
+        {
+            fprintf(Out, "--- %s execution ---\n", FileName);
+            
+            machine_snapshot *RunSnapshot = 0;
+            if(Snapshot && (Restore || !Snapshot->Taken))
+            {
+                RunSnapshot = Snapshot;
+                Snapshot->Name = FileName;
             }
             
-            PrintInstruction(Instruction, stdout);
-            if(SimFlags & SimFlag_ShowClocks)
+            if((SimFlags & (SimFlag_Trace|SimFlag_Profile)) || RunSnapshot || Timing.SimulateBIU)
+            {
+                // NOTE: Only the interpreter writes traces and profiles, takes snapshots and runs the BIU
+                // timing, so these override -lanes, -blocks and -jit. If the trace file can't be created, it just
+                // runs without one.
+                trace_writer Trace = {};
+                b32 Tracing = false;
+                if(SimFlags & SimFlag_Trace)
+                {
+                    char TraceFileName[256];
+                    sprintf(TraceFileName, "sim86_trace_%u.bin", File->TraceIndex);
+                    
+                    register_state_8086 StartRegisters = {};
+                    instruction_clock_interval StartClocks = {};
+                    timing_state StartTiming = Timing;
+                    if(Restore)
+                    {
+                        StartRegisters = Snapshot->Registers;
+                        StartClocks = Snapshot->Clocks;
+                        StartTiming = Snapshot->Timing;
+                    }
+                    
+                    Tracing = BeginTrace(&Trace, TraceFileName, FileName, SimFlags, StartTiming, &StartRegisters, StartClocks);
+                }
+                
+                Run8086(BytesRead, MainMemory, SimFlags, Timing, Out, Tracing ? &Trace : 0, RunSnapshot, SnapshotCS, SnapshotIP);
+            }
+            else if(File->LaneCount)
+            {
+                RunLockstep8086(BytesRead, MainMemory, SimFlags, File->LaneCount, File->LaneDataFileName, File->LaneDataAddress, Out);
+            }
+            else if(SimFlags & (SimFlag_Blocks|SimFlag_JIT))
+            {
+                RunThreaded8086(BytesRead, MainMemory, SimFlags, Timing, Out);
+            }
+            else
             {
-                printf(" ; ");
-                PrintEstimatedClocks(Timing, Instruction, SimFlags, &TimeAccum);
+                Run8086(BytesRead, MainMemory, SimFlags, Timing, Out);
             }
-            printf("\n");
         }
         else
         {
-            fprintf(stderr, "ERROR: Unrecognized binary in instruction stream.\n");
-            break;
+            fprintf(Out, "; %s disassembly:\n", FileName);
+            fprintf(Out, "bits 16\n");
+            if(SimFlags & SimFlag_Loops)
+            {
+                AnalyzeLoops8086(BytesRead, MainMemory, Out);
+            }
+            else if(SimFlags & SimFlag_Blocks)
+            {
+                DisAsmBlocks8086(BytesRead, MainMemory, SimFlags, Timing, Out);
+            }
+            else
+            {
+                DisAsm8086(BytesRead, MainMemory, SimFlags, Timing, Out);
+            }
+        }
+    }
+    
+    if(SimFlags & SimFlag_DumpMemory)
+    {
+        char DumpFileName[256];
+        sprintf(DumpFileName, "sim86_memory_%u.data", File->DumpIndex);
+        FILE *DumpFile = fopen(DumpFileName, "wb");
+        if(DumpFile)
+        {
+            fwrite(MainMemory.Memory, MainMemSize, 1, DumpFile);
+            fclose(DumpFile);
+        }
+    }
+    
+    if(SimFlags & SimFlag_DumpDelta)
+    {
+        // NOTE: With snapshots, the dirty pages are only the ones written since the snapshot, not since
+        // memory was cleared, so every page has to be checked.
+        char DeltaFileName[256];
+        sprintf(DeltaFileName, "sim86_memory_%u.delta", File->DumpIndex);
+        if(!WriteMemoryDelta(DeltaFileName, MainMemory, Snapshot ? 0 : MainMemory.Dirty))
+        {
+            fprintf(stderr, "ERROR: Unable to write %s.\n", DeltaFileName);
         }
     }
 }
 
-static b32 IsRet(operation_type Op)
-{
-    b32 Result = ((Op == Op_ret) ||
-                  (Op == Op_retf));
-    return Result;
-}
-
-static void Run8086(u32 OnePastLastByte, segmented_access MainMemory, u32 SimFlags, timing_state Timing)
+static void ProcessBatchThread(void *Param, u32 ThreadIndex)
 {
-    instruction_table Table = Get8086InstructionTable();
-    register_state_8086 Registers = {};
-    instruction_clock_interval TimeAccum = {};
+    sim_batch *Batch = (sim_batch *)Param;
     
-    for(;;)
+    // NOTE: Each thread has its own 8086, which is cleared before every file, so no file can see
+    // what another one left in memory, no matter which thread ran it. Only the pages the last file wrote
+    // need clearing, and they are also what -dumpdelta needs to look at.
+    dirty_pages Written = {};
+    segmented_access Memory = AllocateMemoryPow2(Batch->MainMemPow2);
+    Memory.Dirty = &Written;
+    if(IsValid(Memory))
     {
-        segmented_access At = MainMemory;
-        At.Mask = 0xffff;
-        At.SegmentBase = Registers.cs;
-        At.SegmentOffset = Registers.ip;
-        
-        if(GetAbsoluteAddressOf(At) < OnePastLastByte)
+        u32 PageCount = (GetHighestAddress(Memory) + 1) >> MEMORY_PAGE_SHIFT;
+        for(u32 FileIndex = ThreadIndex; FileIndex < Batch->FileCount; FileIndex += Batch->ThreadCount)
         {
-            instruction Instruction = DecodeInstruction(Table, At);
-            if(Instruction.Op)
+            sim_file *File = Batch->Files + FileIndex;
+            if(File->Output)
             {
-                register_state_8086 PrevRegisters = Registers;
-                
-                if((SimFlags & SimFlag_StopOnRet) &&
-                   IsRet(Instruction.Op))
+                for(u32 PageIndex = 0; PageIndex < PageCount; ++PageIndex)
                 {
-                    fprintf(stdout, "STOPONRET: Return encountered at address %u.\n", Instruction.Address);
-                    break;
-                }
-                
-                Registers.ip += Instruction.Size;
-                exec_result Exec = ExecInstruction(MainMemory, &Registers, Instruction);
-                
-                if(!Exec.Unimplemented)
-                {
-                    PrintInstruction(Instruction, stdout);
-                    printf(" ; ");
-                    if(SimFlags & SimFlag_ShowClocks)
-                    {
-                        UpdateTimingForExec(&Timing, Exec);
-                        PrintEstimatedClocks(Timing, Instruction, SimFlags, &TimeAccum);
-                        fprintf(stdout, " | ");
-                    }
-                    if(!(SimFlags & SimFlag_NoRegisterDiffs))
+                    if(IsPageDirty(&Written, PageIndex))
                     {
-                        PrintRegisterDifference(&PrevRegisters, &Registers, stdout);
+                        memset(Memory.Memory + (PageIndex << MEMORY_PAGE_SHIFT), 0, MEMORY_PAGE_SIZE);
                     }
-                    printf("\n");
-                }
-                else
-                {
-                    printf("ERROR: Unimplemented instruction (%s).\n", GetMnemonic(Instruction.Op));
-                    break;
                 }
+                ClearDirtyPages(&Written);
+                
+                ProcessFile(File, Memory, Batch->MainMemPow2, 0, 0, 0, File->Output);
             }
-            else
+        }
+        
+        FreeMemoryPow2(Memory);
+    }
+    else
+    {
+        fprintf(stderr, "ERROR: Unable to allocate main memory for a -j thread.\n");
+        
+        // NOTE: Not getting memory leaves this thread's files with no output, rather than running them elsewhere.
+        for(u32 FileIndex = ThreadIndex; FileIndex < Batch->FileCount; FileIndex += Batch->ThreadCount)
+        {
+            sim_file *File = Batch->Files + FileIndex;
+            if(File->Output)
             {
-                fprintf(stderr, "ERROR: Unrecognized binary in instruction stream.\n");
-                break;
+                fclose(File->Output);
+                File->Output = 0;
             }
         }
+    }
+}
+
+static void ProcessBatch(sim_file *Files, u32 FileCount, u32 ThreadCount, u32 MainMemPow2)
+{
+    sim_batch Batch = {};
+    Batch.Files = Files;
+    Batch.FileCount = FileCount;
+    Batch.ThreadCount = ThreadCount;
+    Batch.MainMemPow2 = MainMemPow2;
+    
+    u32 DumpIndex = 0;
+    u32 TraceIndex = 0;
+    for(u32 FileIndex = 0; FileIndex < FileCount; ++FileIndex)
+    {
+        sim_file *File = Files + FileIndex;
+        if(File->Restore)
+        {
+            // NOTE: Batches only run without -snapshot-at, so there is never anything to restore.
+            fprintf(stderr, "ERROR: -restore needs -exec and a snapshot that has been taken (see -snapshot-at).\n");
+        }
         else
         {
-            break;
+            AssignOutputIndices(File, &DumpIndex, &TraceIndex);
+            
+            File->Output = tmpfile();
+            if(!File->Output)
+            {
+                fprintf(stderr, "ERROR: Unable to create a temporary file for %s.\n", File->FileName);
+            }
         }
     }
     
-    printf("\n");
-    printf("Final registers:\n");
-    PrintRegisters(&Registers, stdout);
-    printf("\n");
+    RunOnThreads(ThreadCount, ProcessBatchThread, &Batch);
+    
+    // NOTE: Every file's output comes out in command-line order, so it is the same as running without -j.
+    for(u32 FileIndex = 0; FileIndex < FileCount; ++FileIndex)
+    {
+        FILE *Output = Files[FileIndex].Output;
+        if(Output)
+        {
+            rewind(Output);
+            
+            char Buffer[64*1024];
+            size_t BytesRead;
+            while((BytesRead = fread(Buffer, 1, sizeof(Buffer), Output)) > 0)
+            {
+                fwrite(Buffer, 1, BytesRead, stdout);
+            }
+            
+            fclose(Output);
+        }
+    }
 }
 
 int main(int ArgCount, char **Args)
 {
     b32 Execute = false;
-    u32 DumpIndex = 0;
     u32 SimFlags = 0;
+    u32 ParallelThreadCount = 0;
+    b32 MapInput = false;
+    u32 JobThreadCount = 0;
+    u32 LaneCount = 0;
+    char *LaneDataFileName = 0;
+    u32 LaneDataAddress = 0;
+    
+    b32 SnapshotRequested = false;
+    u16 SnapshotCS = 0;
+    u16 SnapshotIP = 0;
+    machine_snapshot Snapshot = {};
+    dirty_pages WrittenPages = {};
     
     timing_state Timing = {};
     
+    u32 FileCount = 0;
+    sim_file *Files = (sim_file *)calloc(ArgCount, sizeof(sim_file));
+    
     u32 MainMemPow2 = 20;
-    u32 MainMemSize = (1 << MainMemPow2);
     segmented_access MainMemory = AllocateMemoryPow2(MainMemPow2);
-    if(IsValid(MainMemory))
+    if(IsValid(MainMemory) && Files)
     {
         if(ArgCount > 1)
         {
@@ -272,55 +1442,211 @@ int main(int ArgCount, char **Args)
                 {
                     Timing.Assume8088 = true;
                 }
+                else if((strcmp(FileName, "-timing") == 0) && ((ArgIndex + 1) < ArgCount))
+                {
+                    // NOTE: -timing manual is the default. -timing biu only changes the clocks of executed
+                    // instructions, since disassembly has no queue to simulate.
+                    char *Model = Args[++ArgIndex];
+                    if(strcmp(Model, "biu") == 0)
+                    {
+                        Timing.SimulateBIU = true;
+                    }
+                    else if(strcmp(Model, "manual") == 0)
+                    {
+                        Timing.SimulateBIU = false;
+                    }
+                    else
+                    {
+                        fprintf(stderr, "ERROR: Unknown timing model %s (expected manual or biu).\n", Model);
+                    }
+                }
                 else if(strcmp(FileName, "-disasm") == 0)
                 {
                     Execute = false;
                 }
+                else if(strcmp(FileName, "-loops") == 0)
+                {
+                    // NOTE: -loops is a kind of disassembly, so it never runs anything.
+                    SimFlags |= SimFlag_Loops;
+                    Execute = false;
+                }
                 else if(strcmp(FileName, "-dump") == 0)
                 {
                     SimFlags |= SimFlag_DumpMemory;
                 }
+                else if(strcmp(FileName, "-dumpdelta") == 0)
+                {
+                    // NOTE: Memory is never cleared between files here, so this has every page written
+                    // since the program started, which is what -dumpdelta needs. -snapshot-at takes it over.
+                    SimFlags |= SimFlag_DumpDelta;
+                    if(!SnapshotRequested)
+                    {
+                        MainMemory.Dirty = &WrittenPages;
+                    }
+                }
                 else if(strcmp(FileName, "-stoponret") == 0)
                 {
                     SimFlags |= SimFlag_StopOnRet;
                 }
-                else
+                else if(strcmp(FileName, "-checkdecode") == 0)
+                {
+                    SimFlags |= SimFlag_CheckDecode;
+                }
+                else if(strcmp(FileName, "-blocks") == 0)
+                {
+                    SimFlags |= SimFlag_Blocks;
+                }
+                else if(strcmp(FileName, "-jit") == 0)
+                {
+                    SimFlags |= SimFlag_JIT;
+                }
+                else if(strcmp(FileName, "-jitverify") == 0)
+                {
+                    SimFlags |= SimFlag_JIT|SimFlag_VerifyJIT;
+                }
+                else if(strcmp(FileName, "-quiet") == 0)
+                {
+                    SimFlags |= SimFlag_Quiet;
+                }
+                else if(strcmp(FileName, "-trace") == 0)
+                {
+                    SimFlags |= SimFlag_Trace;
+                }
+                else if(strcmp(FileName, "-profile") == 0)
+                {
+                    SimFlags |= SimFlag_Profile;
+                }
+                else if((strcmp(FileName, "-snapshot-at") == 0) && ((ArgIndex + 1) < ArgCount))
+                {
+                    // NOTE: The address is cs:ip, or just ip with cs taken to be 0. From here on, every write
+                    // marks its page, so -restore knows what to put back.
+                    SnapshotRequested = true;
+                    char *End = 0;
+                    u32 Value = strtoul(Args[++ArgIndex], &End, 0);
+                    if(*End == ':')
+                    {
+                        SnapshotCS = (u16)Value;
+                        Value = strtoul(End + 1, 0, 0);
+                    }
+                    SnapshotIP = (u16)Value;
+                    MainMemory.Dirty = &Snapshot.Dirty;
+                }
+                else if((strcmp(FileName, "-restore") == 0) && !Execute)
+                {
+                    fprintf(stderr, "ERROR: -restore needs -exec and a snapshot that has been taken (see -snapshot-at).\n");
+                }
+                else if(strcmp(FileName, "-eagerflags") == 0)
+                {
+                    SimFlags |= SimFlag_EagerFlags;
+                }
+                else if(strcmp(FileName, "-mmap") == 0)
+                {
+                    MapInput = true;
+                }
+                else if((strcmp(FileName, "-parallel") == 0) && ((ArgIndex + 1) < ArgCount))
                 {
-                    if(SimFlags & SimFlag_ShowClocks)
+                    // NOTE: A thread count of 0 means one thread per processor.
+                    ParallelThreadCount = atoi(Args[++ArgIndex]);
+                    if(ParallelThreadCount == 0)
                     {
-                        fprintf(stdout,
-                                "\n"
-                                "WARNING: Clocks reported by this utility are strictly from the 8086 manual.\n"
-                                "They will be inaccurate, both because the manual clocks are estimates, and because\n"
-                                "some of the entries in the manual look highly suspicious and are probably typos.\n"
-                                "\n");
+                        ParallelThreadCount = GetProcessorCount();
                     }
                     
-                    u32 BytesRead = LoadMemoryFromFile(FileName, MainMemory, 0);
-                    if(Execute)
+                    if(ParallelThreadCount > MAX_THREAD_COUNT)
                     {
-                        printf("--- %s execution ---\n", FileName);
-                        Run8086(BytesRead, MainMemory, SimFlags, Timing);
+                        ParallelThreadCount = MAX_THREAD_COUNT;
                     }
-                    else
+                }
+                else if((strcmp(FileName, "-lanes") == 0) && ((ArgIndex + 1) < ArgCount))
+                {
+                    // NOTE: -lanes 0 goes back to running one 8086.
+                    LaneCount = atoi(Args[++ArgIndex]);
+                    if(LaneCount > LOCKSTEP_MAX_LANE_COUNT)
+                    {
+                        LaneCount = LOCKSTEP_MAX_LANE_COUNT;
+                    }
+                }
+                else if((strcmp(FileName, "-lanedata") == 0) && ((ArgIndex + 2) < ArgCount))
+                {
+                    LaneDataFileName = Args[++ArgIndex];
+                    LaneDataAddress = strtoul(Args[++ArgIndex], 0, 0);
+                }
+                else if((strcmp(FileName, "-j") == 0) && ((ArgIndex + 1) < ArgCount))
+                {
+                    /* NOTE: Unlike the other flags, -j applies to the whole command line, wherever it is.
+                       Each file then gets its own 8086 with cleared memory, where without -j every file after
+                       the first starts with whatever the files before it left there. A -dump or -dumpdelta of
+                       any file but the first would write those leftovers out, so then -j is ignored. Programs
+                       executed after the first file still run in parallel, and only differ from a run without
+                       -j if they read memory they never wrote, so for those -j just warns. */
+                    JobThreadCount = atoi(Args[++ArgIndex]);
+                    if(JobThreadCount == 0)
                     {
-                        printf("; %s disassembly:\n", FileName);
-                        printf("bits 16\n");
-                        DisAsm8086(BytesRead, MainMemory, SimFlags, Timing);
+                        JobThreadCount = GetProcessorCount();
                     }
                     
-                    if(SimFlags & SimFlag_DumpMemory)
+                    if(JobThreadCount > MAX_THREAD_COUNT)
                     {
-                        char DumpFileName[256];
-                        sprintf(DumpFileName, "sim86_memory_%u.data", DumpIndex);
-                        FILE *DumpFile = fopen(DumpFileName, "wb");
-                        if(DumpFile)
-                        {
-                            fwrite(MainMemory.Memory, MainMemSize, 1, DumpFile);
-                            fclose(DumpFile);
-                        }
-                        
-                        ++DumpIndex;
+                        JobThreadCount = MAX_THREAD_COUNT;
+                    }
+                }
+                else
+                {
+                    sim_file *File = Files + FileCount++;
+                    File->FileName = FileName;
+                    File->Execute = Execute;
+                    File->Restore = (strcmp(FileName, "-restore") == 0);
+                    File->SimFlags = SimFlags;
+                    File->Timing = Timing;
+                    File->ParallelThreadCount = ParallelThreadCount;
+                    File->MapInput = MapInput;
+                    File->LaneCount = LaneCount;
+                    File->LaneDataFileName = LaneDataFileName;
+                    File->LaneDataAddress = LaneDataAddress;
+                }
+            }
+            
+            if(JobThreadCount > FileCount)
+            {
+                JobThreadCount = FileCount;
+            }
+            
+            b32 DumpsAfterFirst = false;
+            b32 ExecutesAfterFirst = false;
+            for(u32 FileIndex = 1; FileIndex < FileCount; ++FileIndex)
+            {
+                sim_file *File = Files + FileIndex;
+                DumpsAfterFirst |= ((File->SimFlags & (SimFlag_DumpMemory|SimFlag_DumpDelta)) != 0);
+                ExecutesAfterFirst |= File->Execute;
+            }
+            
+            if((JobThreadCount > 1) && !SnapshotRequested && !DumpsAfterFirst)
+            {
+                if(ExecutesAfterFirst)
+                {
+                    fprintf(stderr, "WARNING: With -j, every program starts with cleared memory instead of what the files before it left, "
+                            "so one that reads memory it never wrote can run differently than without -j.\n");
+                }
+                
+                ProcessBatch(Files, FileCount, JobThreadCount, MainMemPow2);
+            }
+            else
+            {
+                // NOTE: Without -j, or with snapshots (which need the files to share one 8086), the files
+                // run one after the other in the same memory, so each one starts with what the last one left.
+                u32 DumpIndex = 0;
+                u32 TraceIndex = 0;
+                for(u32 FileIndex = 0; FileIndex < FileCount; ++FileIndex)
+                {
+                    sim_file *File = Files + FileIndex;
+                    if(File->Restore && !Snapshot.Taken)
+                    {
+                        fprintf(stderr, "ERROR: -restore needs -exec and a snapshot that has been taken (see -snapshot-at).\n");
+                    }
+                    else
+                    {
+                        AssignOutputIndices(File, &DumpIndex, &TraceIndex);
+                        ProcessFile(File, MainMemory, MainMemPow2, SnapshotRequested ? &Snapshot : 0, SnapshotCS, SnapshotIP, stdout);
                     }
                 }
             }
@@ -335,5 +1661,8 @@ int main(int ArgCount, char **Args)
         fprintf(stderr, "ERROR: Unable to allow main memory for 8086.\n");
     }
     
+    FreeSnapshot(&Snapshot);
+    free(Files);
+    
     return 0;
 }
@@ -0,0 +1,384 @@
+enum control_flow
+{
+    Flow_None,
+    Flow_Conditional,
+    Flow_Jump,
+    Flow_Call,
+    Flow_Return,
+    Flow_Halt,
+};
+
+enum block_address_flag
+{
+    BlockAddress_Leader = 0x1,
+    BlockAddress_Entry = 0x2,
+    BlockAddress_DecodeError = 0x4,
+    BlockAddress_Overlap = 0x8,
+};
+
+static control_flow GetControlFlow(operation_type Op)
+{
+    control_flow Result = Flow_None;
+    
+    switch(Op)
+    {
+        case Op_je: case Op_jl: case Op_jle: case Op_jb: case Op_jbe: case Op_jp: case Op_jo: case Op_js:
+        case Op_jne: case Op_jnl: case Op_jg: case Op_jnb: case Op_ja: case Op_jnp: case Op_jno: case Op_jns:
+        case Op_loop: case Op_loopz: case Op_loopnz: case Op_jcxz:
+        {
+            Result = Flow_Conditional;
+        } break;
+        
+        case Op_jmp: {Result = Flow_Jump;} break;
+        case Op_call: {Result = Flow_Call;} break;
+        
+        case Op_ret: case Op_retf: case Op_iret:
+        {
+            Result = Flow_Return;
+        } break;
+        
+        case Op_hlt: {Result = Flow_Halt;} break;
+        
+        default: {} break;
+    }
+    
+    return Result;
+}
+
+static b32 IsRet(operation_type Op)
+{
+    b32 Result = ((Op == Op_ret) ||
+                  (Op == Op_retf));
+    return Result;
+}
+
+static b32 GetDirectTarget(instruction Instruction, u32 BaseAddress, u32 *Target)
+{
+    // NOTE: Returns false for jumps and calls through registers or memory, since where those go
+    // can't be known without executing. Targets are relative to BaseAddress, like instruction addresses.
+    b32 Result = false;
+    
+    instruction_operand Operand = Instruction.Operands[0];
+    if((Operand.Type == Operand_Immediate) && (Operand.Immediate.Flags & Immediate_RelativeJumpDisplacement))
+    {
+        *Target = Instruction.Address + Instruction.Size + Operand.Immediate.Value;
+        Result = true;
+    }
+    else if((Operand.Type == Operand_Memory) && (Operand.Address.Flags & Address_ExplicitSegment))
+    {
+        *Target = ((Operand.Address.ExplicitSegment << 4) + (u16)Operand.Address.Displacement) - BaseAddress;
+        Result = true;
+    }
+    
+    return Result;
+}
+
+static segmented_access AtBlockAddress(segmented_access Memory, u32 Address)
+{
+    // NOTE: MoveBaseBy can only move by a 16-bit offset, and images can be bigger than one segment.
+    segmented_access Result = Memory;
+    Result.SegmentBase += (u16)(Address >> 4);
+    Result.SegmentOffset += (u16)(Address & 0xf);
+    return Result;
+}
+
+static u32 FindBlock(block_graph *Graph, u32 Address)
+{
+    u32 Result = BLOCK_NONE;
+    
+    u32 Low = 0;
+    u32 High = Graph->BlockCount;
+    while(Low < High)
+    {
+        u32 Mid = Low + (High - Low) / 2;
+        basic_block *Block = Graph->Blocks + Mid;
+        if(Address < Block->Address)
+        {
+            High = Mid;
+        }
+        else if(Address >= (Block->Address + Block->ByteCount))
+        {
+            Low = Mid + 1;
+        }
+        else
+        {
+            Result = Mid;
+            break;
+        }
+    }
+    
+    return Result;
+}
+
+static void AddEdge(block_graph *Graph, basic_block *Block, block_edge_kind Kind, u32 Address)
+{
+    block_edge *Edge = Block->Edges + Block->EdgeCount++;
+    Edge->Kind = Kind;
+    Edge->Address = Address;
+    Edge->Block = BLOCK_NONE;
+    
+    // NOTE: An edge only leads to a block if it goes to the block's first instruction.
+    u32 BlockIndex = FindBlock(Graph, Address);
+    if((BlockIndex != BLOCK_NONE) && (Graph->Blocks[BlockIndex].Address == Address))
+    {
+        Edge->Block = BlockIndex;
+    }
+}
+
+static block_graph BuildBlockGraph(instruction_table Table, segmented_access Memory, u32 ByteCount,
+                                   u32 EntryCount, u32 *Entries)
+{
+    /* NOTE: This is a recursive-descent disassembly. Starting from the entry points, it decodes
+       forward until control can't continue, pushing the targets of every jump and call it sees onto a work
+       queue. Each byte is decoded at most once: if a target turns out to be an instruction that was already
+       decoded, it just becomes the start of a block, and if it lands in the middle of one (or an instruction
+       would run into one), that path stops there and the block that led to it is flagged.
+
+       Once everything reachable has been decoded, the instructions are sorted into blocks in address order,
+       splitting wherever something jumps in and after every control transfer. */
+    
+    block_graph Result = {};
+    Result.ByteCount = ByteCount;
+    
+    u32 BaseAddress = GetAbsoluteAddressOf(Memory);
+    u32 *Owners = (u32 *)calloc(ByteCount + 1, sizeof(u32)); // NOTE: Index + 1 of the instruction covering each byte
+    u8 *AddressFlags = (u8 *)calloc(ByteCount + 1, sizeof(u8));
+    u32 *Work = (u32 *)malloc((ByteCount + EntryCount + 1)*sizeof(u32));
+    packed_instruction *Decoded = (packed_instruction *)malloc((ByteCount + 1)*sizeof(packed_instruction));
+    if(!Owners || !AddressFlags || !Work || !Decoded)
+    {
+        fprintf(stderr, "ERROR: Unable to allocate space for block analysis.\n");
+        free(Owners);
+        free(AddressFlags);
+        free(Work);
+        free(Decoded);
+        return Result;
+    }
+    
+    u32 WorkCount = 0;
+    for(u32 EntryIndex = 0; EntryIndex < EntryCount; ++EntryIndex)
+    {
+        if(Entries[EntryIndex] < ByteCount)
+        {
+            AddressFlags[Entries[EntryIndex]] |= BlockAddress_Entry;
+            Work[WorkCount++] = Entries[EntryIndex];
+        }
+    }
+    
+    u32 DecodedCount = 0;
+    while(WorkCount)
+    {
+        u32 Address = Work[--WorkCount];
+        AddressFlags[Address] |= BlockAddress_Leader;
+        
+        while(Address < ByteCount)
+        {
+            u32 Owner = Owners[Address];
+            if(Owner)
+            {
+                if(Decoded[Owner - 1].Address != Address)
+                {
+                    AddressFlags[Address] |= BlockAddress_Overlap;
+                }
+                break;
+            }
+            
+            instruction Instruction = DecodeInstruction(Table, AtBlockAddress(Memory, Address));
+            Instruction.Address = Address;
+            if(!Instruction.Op || (Instruction.Size > (ByteCount - Address)) ||
+               !PackInstruction(Instruction, Decoded + DecodedCount))
+            {
+                AddressFlags[Address] |= BlockAddress_DecodeError;
+                break;
+            }
+            
+            b32 Overlaps = false;
+            for(u32 ByteIndex = 1; ByteIndex < Instruction.Size; ++ByteIndex)
+            {
+                Overlaps |= (Owners[Address + ByteIndex] != 0);
+            }
+            
+            if(Overlaps)
+            {
+                AddressFlags[Address] |= BlockAddress_Overlap;
+                break;
+            }
+            
+            ++DecodedCount;
+            for(u32 ByteIndex = 0; ByteIndex < Instruction.Size; ++ByteIndex)
+            {
+                Owners[Address + ByteIndex] = DecodedCount;
+            }
+            
+            u32 Next = Address + Instruction.Size;
+            u32 Target = 0;
+            b32 HasTarget = GetDirectTarget(Instruction, BaseAddress, &Target);
+            if(HasTarget && (Target < ByteCount))
+            {
+                Work[WorkCount++] = Target;
+            }
+            
+            control_flow Flow = GetControlFlow(Instruction.Op);
+            if((Flow == Flow_Jump) || (Flow == Flow_Return) || (Flow == Flow_Halt))
+            {
+                break;
+            }
+            else if(Flow != Flow_None)
+            {
+                AddressFlags[Next] |= BlockAddress_Leader;
+            }
+            
+            Address = Next;
+        }
+        
+        // NOTE: Running off the end of the image is the same as running into bytes that don't decode.
+        if(Address >= ByteCount)
+        {
+            AddressFlags[ByteCount] |= BlockAddress_DecodeError;
+        }
+    }
+    
+    // NOTE: Walk the image in order to lay out the instructions and cut them into blocks.
+    Result.Instructions = (packed_instruction *)malloc((DecodedCount + 1)*sizeof(packed_instruction));
+    Result.Blocks = (basic_block *)malloc((DecodedCount + 1)*sizeof(basic_block));
+    if(Result.Instructions && Result.Blocks)
+    {
+        basic_block *Block = 0;
+        for(u32 Address = 0; Address < ByteCount;)
+        {
+            u32 Owner = Owners[Address];
+            if(Owner && (Decoded[Owner - 1].Address == Address))
+            {
+                packed_instruction Instruction = Decoded[Owner - 1];
+                if(!Block || (AddressFlags[Address] & BlockAddress_Leader) ||
+                   ((Block->Address + Block->ByteCount) != Address))
+                {
+                    Block = Result.Blocks + Result.BlockCount++;
+                    *Block = {};
+                    Block->Address = Address;
+                    Block->FirstInstruction = Result.InstructionCount;
+                    if(AddressFlags[Address] & BlockAddress_Entry)
+                    {
+                        Block->Flags |= Block_Entry;
+                    }
+                }
+                
+                Result.Instructions[Result.InstructionCount++] = Instruction;
+                ++Block->InstructionCount;
+                Block->ByteCount += GetPackedSize(Instruction);
+                
+                if(GetControlFlow((operation_type)Instruction.Op) != Flow_None)
+                {
+                    Block = 0;
+                }
+                
+                Address += GetPackedSize(Instruction);
+            }
+            else
+            {
+                Block = 0;
+                ++Address;
+            }
+        }
+        
+        // NOTE: With every block in place, the edges can be resolved to block indices.
+        for(u32 BlockIndex = 0; BlockIndex < Result.BlockCount; ++BlockIndex)
+        {
+            Block = Result.Blocks + BlockIndex;
+            instruction Last = UnpackInstruction(Result.Instructions[Block->FirstInstruction + Block->InstructionCount - 1]);
+            u32 Next = Block->Address + Block->ByteCount;
+            
+            u32 Target = 0;
+            b32 HasTarget = GetDirectTarget(Last, BaseAddress, &Target);
+            b32 FallsThrough = true;
+            switch(GetControlFlow(Last.Op))
+            {
+                case Flow_Conditional:
+                {
+                    AddEdge(&Result, Block, Edge_Taken, Target);
+                } break;
+                
+                case Flow_Jump:
+                {
+                    if(HasTarget)
+                    {
+                        AddEdge(&Result, Block, Edge_Taken, Target);
+                    }
+                    else
+                    {
+                        Block->Flags |= Block_IndirectExit;
+                    }
+                    FallsThrough = false;
+                } break;
+                
+                case Flow_Call:
+                {
+                    if(HasTarget)
+                    {
+                        AddEdge(&Result, Block, Edge_Call, Target);
+                    }
+                    else
+                    {
+                        Block->Flags |= Block_IndirectCall;
+                    }
+                } break;
+                
+                case Flow_Return:
+                {
+                    Block->Flags |= Block_IndirectExit;
+                    FallsThrough = false;
+                } break;
+                
+                case Flow_Halt:
+                {
+                    Block->Flags |= Block_Halt;
+                    FallsThrough = false;
+                } break;
+                
+                case Flow_None: {} break;
+            }
+            
+            if(FallsThrough)
+            {
+                AddEdge(&Result, Block, Edge_Fallthrough, Next);
+            }
+            
+            // NOTE: Flag blocks that lead somewhere the analysis had to give up on.
+            for(u32 EdgeIndex = 0; EdgeIndex < Block->EdgeCount; ++EdgeIndex)
+            {
+                u32 EdgeAddress = Block->Edges[EdgeIndex].Address;
+                if(EdgeAddress >= ByteCount)
+                {
+                    Block->Flags |= Block_DecodeError;
+                }
+                else if(AddressFlags[EdgeAddress] & BlockAddress_DecodeError)
+                {
+                    Block->Flags |= Block_DecodeError;
+                }
+                else if(AddressFlags[EdgeAddress] & BlockAddress_Overlap)
+                {
+                    Block->Flags |= Block_Overlap;
+                }
+            }
+        }
+    }
+    else
+    {
+        fprintf(stderr, "ERROR: Unable to allocate space for block analysis.\n");
+        FreeBlockGraph(&Result);
+    }
+    
+    free(Owners);
+    free(AddressFlags);
+    free(Work);
+    free(Decoded);
+    
+    return Result;
+}
+
+static void FreeBlockGraph(block_graph *Graph)
+{
+    free(Graph->Instructions);
+    free(Graph->Blocks);
+    *Graph = {};
+}
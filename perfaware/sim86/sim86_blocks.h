@@ -0,0 +1,55 @@
+#define BLOCK_NONE 0xffffffff
+
+enum block_edge_kind
+{
+    Edge_Fallthrough,
+    Edge_Taken,
+    Edge_Call,
+};
+
+struct block_edge
+{
+    block_edge_kind Kind;
+    u32 Address;
+    u32 Block; // NOTE: BLOCK_NONE if the target is outside the image, or is not the start of a decoded instruction
+};
+
+enum basic_block_flag
+{
+    Block_Entry = 0x1,
+    Block_IndirectExit = 0x2, // NOTE: Ends in a ret, iret or jmp whose target can't be known without executing
+    Block_IndirectCall = 0x4,
+    Block_Halt = 0x8,
+    Block_DecodeError = 0x10, // NOTE: Control would flow into bytes that don't decode, or past the end of the image
+    Block_Overlap = 0x20, // NOTE: Control would flow into the middle of an instruction that was already decoded
+};
+
+struct basic_block
+{
+    u32 Address;
+    u32 ByteCount;
+    
+    u32 FirstInstruction;
+    u32 InstructionCount;
+    
+    u32 Flags;
+    u32 EdgeCount;
+    block_edge Edges[2];
+};
+
+struct block_graph
+{
+    u32 ByteCount;
+    
+    // NOTE: Both of these are sorted by address, and each block's instructions are contiguous.
+    u32 InstructionCount;
+    packed_instruction *Instructions;
+    
+    u32 BlockCount;
+    basic_block *Blocks;
+};
+
+static block_graph BuildBlockGraph(instruction_table Table, segmented_access Memory, u32 ByteCount,
+                                   u32 EntryCount, u32 *Entries);
+static void FreeBlockGraph(block_graph *Graph);
+static u32 FindBlock(block_graph *Graph, u32 Address);
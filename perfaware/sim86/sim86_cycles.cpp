@@ -503,3 +503,163 @@ static instruction_clock_interval ExpectedClocksFrom(timing_state State, instruc
     
     return Result;
 }
+
+#define BIU_BUS_CYCLE_CLOCKS 4
+
+static void StartFetch(biu_queue *Queue, u64 At)
+{
+    Queue->Fetching = true;
+    Queue->FetchDoneAt = At + BIU_BUS_CYCLE_CLOCKS;
+}
+
+static void RunBIUUntil(biu_queue *Queue, u64 Time, u32 QueueSize, u32 FetchWidth)
+{
+    // NOTE: Lets the BIU prefetch on its own up to Time. Every call has to be for a Time at or after
+    // the last one, and the EU only takes bytes out of the queue at the latest Time.
+    for(;;)
+    {
+        if(Queue->Fetching)
+        {
+            if(Queue->FetchDoneAt > Time)
+            {
+                break;
+            }
+            
+            Queue->Fetching = false;
+            Queue->ByteCount += FetchWidth;
+            Queue->BusFreeAt = Queue->FetchDoneAt;
+        }
+        
+        if((Queue->ByteCount + FetchWidth) > QueueSize)
+        {
+            // NOTE: The queue is full, so the bus sits idle until the EU takes something out of it.
+            if(Queue->BusFreeAt < Time)
+            {
+                Queue->BusFreeAt = Time;
+            }
+            break;
+        }
+        
+        if(Queue->BusFreeAt >= Time)
+        {
+            break;
+        }
+        
+        StartFetch(Queue, Queue->BusFreeAt);
+    }
+}
+
+static u32 StepBIUQueue(biu_queue *Queue, u32 QueueSize, u32 FetchWidth, u32 InstructionSize,
+                        u32 ExecClocks, u32 BusClocks, b32 Flush)
+{
+    u64 Start = Queue->Clock;
+    
+    // NOTE: The EU can't start on an instruction until all of its bytes have come through the queue.
+    for(u32 ByteIndex = 0; ByteIndex < InstructionSize; ++ByteIndex)
+    {
+        RunBIUUntil(Queue, Queue->Clock, QueueSize, FetchWidth);
+        while(Queue->ByteCount == 0)
+        {
+            if(!Queue->Fetching)
+            {
+                StartFetch(Queue, (Queue->BusFreeAt > Queue->Clock) ? Queue->BusFreeAt : Queue->Clock);
+            }
+            
+            Queue->Clock = Queue->FetchDoneAt;
+            RunBIUUntil(Queue, Queue->Clock, QueueSize, FetchWidth);
+        }
+        
+        --Queue->ByteCount;
+    }
+    
+    u64 End = Queue->Clock + ExecClocks;
+    if(BusClocks)
+    {
+        // NOTE: The manual's clocks already include the operand transfers, which are taken to be at the
+        // end of the instruction. They can't start until a prefetch that is already on the bus has finished.
+        if(BusClocks > ExecClocks)
+        {
+            BusClocks = ExecClocks;
+        }
+        
+        u64 TransferAt = End - BusClocks;
+        RunBIUUntil(Queue, TransferAt, QueueSize, FetchWidth);
+        if(Queue->Fetching)
+        {
+            TransferAt = Queue->FetchDoneAt;
+            Queue->Fetching = false;
+            Queue->ByteCount += FetchWidth;
+        }
+        
+        End = TransferAt + BusClocks;
+        Queue->BusFreeAt = End;
+    }
+    
+    if(Flush)
+    {
+        // NOTE: A prefetch that is on the bus still has to finish, but its bytes are thrown away along
+        // with the rest of the queue, and fetching starts over from the new cs:ip.
+        RunBIUUntil(Queue, End, QueueSize, FetchWidth);
+        if(Queue->Fetching)
+        {
+            Queue->Fetching = false;
+            Queue->BusFreeAt = Queue->FetchDoneAt;
+        }
+        Queue->ByteCount = 0;
+    }
+    
+    Queue->Clock = End;
+    
+    u32 Result = (u32)(End - Start);
+    return Result;
+}
+
+static b32 FlushesQueue(instruction Instruction, b32 BranchTaken)
+{
+    b32 Result = BranchTaken;
+    
+    switch(Instruction.Op)
+    {
+        case Op_call:
+        case Op_jmp:
+        case Op_ret:
+        case Op_retf:
+        case Op_int:
+        case Op_int3:
+        case Op_iret:
+        {
+            Result = true;
+        } break;
+        
+        default: {} break;
+    }
+    
+    return Result;
+}
+
+static instruction_clock_interval ClocksForExec(timing_state *State, instruction Instruction, instruction_timing Timing)
+{
+    instruction_clock_interval Result = ExpectedClocksFrom(*State, Instruction, Timing);
+    
+    if(State->SimulateBIU)
+    {
+        // NOTE: The 8086 fetches a word at a time into a 6 byte queue, and the 8088 a byte at a time
+        // into a 4 byte queue. Word transfers that take two bus cycles (see ExpectedClocksFrom) keep the bus
+        // busy for both.
+        u32 QueueSize = State->Assume8088 ? 4 : 6;
+        u32 FetchWidth = State->Assume8088 ? 1 : 2;
+        
+        u32 BusClocks = BIU_BUS_CYCLE_CLOCKS*Timing.Transfers;
+        if((Instruction.Flags & Inst_Wide) && (State->Assume8088 || State->AssumeAddressUnanaligned))
+        {
+            BusClocks *= 2;
+        }
+        
+        b32 Flush = FlushesQueue(Instruction, State->AssumeBranchTaken);
+        
+        Result.Min = StepBIUQueue(&State->BIU[0], QueueSize, FetchWidth, Instruction.Size, Result.Min, BusClocks, Flush);
+        Result.Max = StepBIUQueue(&State->BIU[1], QueueSize, FetchWidth, Instruction.Size, Result.Max, BusClocks, Flush);
+    }
+    
+    return Result;
+}
@@ -23,6 +23,18 @@ struct instruction_timing
     u32 EAClocks;
 };
 
+/* NOTE: The bus interface unit (BIU) fetches instruction bytes into the prefetch queue whenever the
+   bus is free and there is room, while the execution unit (EU) takes them out of the queue and runs them.
+   Times are in clocks since the program started. */
+struct biu_queue
+{
+    u64 Clock; // NOTE: When the EU finished the last instruction
+    u64 BusFreeAt;
+    u64 FetchDoneAt;
+    u32 ByteCount;
+    b32 Fetching;
+};
+
 struct timing_state
 {
     b32 Assume8088;
@@ -30,8 +42,15 @@ struct timing_state
     b32 AssumeAddressUnanaligned;
     u32 AssumeRepCount;
     u32 AssumeShiftCount;
+    
+    // NOTE: With -timing biu, executed instructions are timed by running the prefetch queue alongside
+    // them instead of straight from the manual. BIU[0] runs with the manual's minimum clocks and BIU[1] with
+    // its maximum, so a range still comes out as a range.
+    b32 SimulateBIU;
+    biu_queue BIU[2];
 };
 
 static instruction_timing EstimateInstructionClocks(timing_state State, instruction Instruction);
 static void UpdateTimingForExec(timing_state *State, exec_result Exec);
 static instruction_clock_interval ExpectedClocksFrom(timing_state State, instruction Instruction, instruction_timing Timing);
+static instruction_clock_interval ClocksForExec(timing_state *State, instruction Instruction, instruction_timing Timing);
@@ -68,8 +68,166 @@ static u32 ParseDataValue(segmented_access *Access, b32 Exists, b32 Wide, b32 Si
     return Result;
 }
 
+struct decoded_fields
+{
+    b32 HasMOD;
+    b32 HasREG;
+    b32 HasSR;
+    b32 HasDisp;
+    b32 HasData;
+    b32 HasV;
+    
+    u32 D;
+    u32 S;
+    u32 W;
+    u32 V;
+    u32 Z;
+    u32 MOD;
+    u32 REG;
+    u32 RM;
+    u32 SR;
+    u32 Disp;
+    u32 Data;
+    
+    u32 DispAlwaysW;
+    u32 WMakesDataW;
+    u32 RMRegAlwaysW;
+    u32 RelJMPDisp;
+    u32 Far;
+};
+
+static instruction BuildInstruction(decode_context *Context, operation_type Op, decoded_fields Fields,
+                                    segmented_access At, u32 StartingAddress)
+{
+    // NOTE: At points just past the opcode bits here, so any displacement or data
+    // that follows them can be parsed directly.
+    instruction Dest = {};
+    
+    u32 Mod = Fields.MOD;
+    u32 RM = Fields.RM;
+    u32 W = Fields.W;
+    b32 S = Fields.S;
+    b32 D = Fields.D;
+    
+    b32 HasDirectAddress = ((Mod == 0b00) && (RM == 0b110));
+    Fields.HasDisp = ((Fields.HasDisp) || (Mod == 0b10) || (Mod == 0b01) || HasDirectAddress);
+    
+    b32 DisplacementIsW = ((Fields.DispAlwaysW) || (Mod == 0b10) || HasDirectAddress);
+    b32 DataIsW = ((Fields.WMakesDataW) && !S && W);
+    
+    Fields.Disp |= ParseDataValue(&At, Fields.HasDisp, DisplacementIsW, (!DisplacementIsW));
+    Fields.Data |= ParseDataValue(&At, Fields.HasData, DataIsW, S);
+    
+    Dest.Op = Op;
+    Dest.Flags = Context->AdditionalFlags;
+    Dest.Address = StartingAddress;
+    Dest.Size = GetAbsoluteAddressOf(At) - StartingAddress;
+    Dest.SegmentOverride = Context->DefaultSegment;
+    
+    if(W)
+    {
+        Dest.Flags |= Inst_Wide;
+    }
+    
+    if(Fields.Far)
+    {
+        Dest.Flags |= Inst_Far;
+    }
+    
+    if(Fields.Z)
+    {
+        Dest.Flags |= Inst_RepNE;
+    }
+    
+    u32 Disp = Fields.Disp;
+    s16 Displacement = (s16)Disp;
+    
+    instruction_operand *RegOperand = &Dest.Operands[D ? 0 : 1];
+    instruction_operand *ModOperand = &Dest.Operands[D ? 1 : 0];
+    
+    if(Fields.HasSR)
+    {
+        *RegOperand = RegisterOperand(Register_es + (Fields.SR & 0x3), 2);
+    }
+    
+    if(Fields.HasREG)
+    {
+        *RegOperand = GetRegOperand(Fields.REG, W);
+    }
+    
+    if(Fields.HasMOD)
+    {
+        if(Mod == 0b11)
+        {
+            *ModOperand = GetRegOperand(RM, W || (Fields.RMRegAlwaysW));
+        }
+        else
+        {
+            register_mapping_8086 IntelTerm0[8] = { Register_b,  Register_b, Register_bp, Register_bp, Register_si, Register_di, Register_bp, Register_b};
+            register_mapping_8086 IntelTerm1[8] = {Register_si, Register_di, Register_si, Register_di};
+            
+            u32 I = RM&0x7;
+            register_mapping_8086 Term0 = IntelTerm0[I];
+            register_mapping_8086 Term1 = IntelTerm1[I];
+            if((Mod == 0b00) && (RM == 0b110))
+            {
+                Term0 = {};
+                Term1 = {};
+            }
+            
+            *ModOperand = EffectiveAddressOperand(RegisterAccess(Term0, 0, 2), RegisterAccess(Term1, 0, 2), Displacement);
+        }
+    }
+    
+    if(Fields.HasData && Fields.HasDisp && !Fields.HasMOD)
+    {
+        Dest.Operands[0] = IntersegmentAddressOperand(Fields.Data, Fields.Disp);
+    }
+    else
+    {
+        //
+        // NOTE(casey): Because there are some strange opcodes that do things like have an immediate as
+        // a _destination_ ("out", for example), I define immediates and other "additional operands" to
+        // go in "whatever slot was not used by the reg and mod fields".
+        //
+        
+        instruction_operand *LastOperand = &Dest.Operands[0];
+        if(LastOperand->Type)
+        {
+            LastOperand = &Dest.Operands[1];
+        }
+        
+        if(Fields.RelJMPDisp)
+        {
+            *LastOperand = ImmediateOperand(Displacement, Immediate_RelativeJumpDisplacement);
+        }
+        else if(Fields.HasData)
+        {
+            *LastOperand = ImmediateOperand(Fields.Data);
+        }
+        else if(Fields.HasV)
+        {
+            if(Fields.V)
+            {
+                *LastOperand = RegisterOperand(Register_c, 1);
+            }
+            else
+            {
+                *LastOperand = ImmediateOperand(1);
+            }
+        }
+    }
+    
+    return Dest;
+}
+
 static instruction TryDecode(decode_context *Context, instruction_encoding *Inst, segmented_access At)
 {
+    /* NOTE: This is the original, interpreted decoder that walks the encoding's bit
+       descriptions one at a time. The specialized decoders below do the same thing with all
+       of the table lookups resolved at compile time, and this one is kept as the reference
+       they can be checked against (see Decode_Interpreted). */
+    
     instruction Dest = {};
     b32 Has[Bits_Count] = {};
     u32 Bits[Bits_Count] = {};
@@ -123,133 +281,345 @@ static instruction TryDecode(decode_context *Context, instruction_encoding *Inst
     
     if(Valid)
     {
-        u32 Mod = Bits[Bits_MOD];
-        u32 RM = Bits[Bits_RM];
-        u32 W = Bits[Bits_W];
-        b32 S = Bits[Bits_S];
-        b32 D = Bits[Bits_D];
-        
-        b32 HasDirectAddress = ((Mod == 0b00) && (RM == 0b110));
-        Has[Bits_Disp] = ((Has[Bits_Disp]) || (Mod == 0b10) || (Mod == 0b01) || HasDirectAddress);
-
-        b32 DisplacementIsW = ((Bits[Bits_DispAlwaysW]) || (Mod == 0b10) || HasDirectAddress);
-        b32 DataIsW = ((Bits[Bits_WMakesDataW]) && !S && W);
+        decoded_fields Fields = {};
+        Fields.HasMOD = Has[Bits_MOD];
+        Fields.HasREG = Has[Bits_REG];
+        Fields.HasSR = Has[Bits_SR];
+        Fields.HasDisp = Has[Bits_Disp];
+        Fields.HasData = Has[Bits_Data];
+        Fields.HasV = Has[Bits_V];
         
-        Bits[Bits_Disp] |= ParseDataValue(&At, Has[Bits_Disp], DisplacementIsW, (!DisplacementIsW));
-        Bits[Bits_Data] |= ParseDataValue(&At, Has[Bits_Data], DataIsW, S);
+        Fields.D = Bits[Bits_D];
+        Fields.S = Bits[Bits_S];
+        Fields.W = Bits[Bits_W];
+        Fields.V = Bits[Bits_V];
+        Fields.Z = Bits[Bits_Z];
+        Fields.MOD = Bits[Bits_MOD];
+        Fields.REG = Bits[Bits_REG];
+        Fields.RM = Bits[Bits_RM];
+        Fields.SR = Bits[Bits_SR];
+        Fields.Disp = Bits[Bits_Disp];
+        Fields.Data = Bits[Bits_Data];
         
-        Dest.Op = Inst->Op;
-        Dest.Flags = Context->AdditionalFlags;
-        Dest.Address = StartingAddress;
-        Dest.Size = GetAbsoluteAddressOf(At) - StartingAddress;
-        Dest.SegmentOverride = Context->DefaultSegment;
+        Fields.DispAlwaysW = Bits[Bits_DispAlwaysW];
+        Fields.WMakesDataW = Bits[Bits_WMakesDataW];
+        Fields.RMRegAlwaysW = Bits[Bits_RMRegAlwaysW];
+        Fields.RelJMPDisp = Bits[Bits_RelJMPDisp];
+        Fields.Far = Bits[Bits_Far];
         
-        if(W)
-        {
-            Dest.Flags |= Inst_Wide;
-        }
+        Dest = BuildInstruction(Context, Inst->Op, Fields, At, (u32)StartingAddress);
+    }
+    
+    return Dest;
+}
 
-        if(Bits[Bits_Far])
-        {
-            Dest.Flags |= Inst_Far;
-        }
-        
-        if(Bits[Bits_Z])
-        {
-            Dest.Flags |= Inst_RepNE;
-        }
-        
-        u32 Disp = Bits[Bits_Disp];
-        s16 Displacement = (s16)Disp;
-        
-        instruction_operand *RegOperand = &Dest.Operands[D ? 0 : 1];
-        instruction_operand *ModOperand = &Dest.Operands[D ? 1 : 0];
-        
-        if(Has[Bits_SR])
-        {
-            *RegOperand = RegisterOperand(Register_es + (Bits[Bits_SR] & 0x3), 2);
-        }
-        
-        if(Has[Bits_REG])
+struct encoding_bit_field
+{
+    u32 PieceCount;
+    u8 ByteIndex[2];
+    u8 ByteShift[2];
+    u8 BitCount[2];
+    u8 FieldShift[2];
+};
+
+struct encoding_format
+{
+    b32 Valid;
+    operation_type Op;
+    
+    u32 ByteCount;
+    u8 LiteralMask[2];
+    u8 LiteralValue[2];
+    
+    b32 Has[Bits_Count];
+    u32 Implicit[Bits_Count];
+    encoding_bit_field Fields[Bits_Count];
+};
+
+static constexpr encoding_format GetEncodingFormat(instruction_encoding Inst)
+{
+    /* NOTE: This does the same walk over the bit descriptions that TryDecode does, except that it
+       runs at compile time and records _where_ each field lives instead of reading it. The result is a
+       flat description that the specialized decoders can use with every branch and shift known up front. */
+    
+    encoding_format Result = {};
+    Result.Valid = true;
+    Result.Op = Inst.Op;
+    
+    u32 BitIndex = 0;
+    for(u32 BitsIndex = 0; BitsIndex < ArrayCount(Inst.Bits); ++BitsIndex)
+    {
+        instruction_bits TestBits = Inst.Bits[BitsIndex];
+        if(TestBits.Usage == Bits_End)
         {
-            *RegOperand = GetRegOperand(Bits[Bits_REG], W);
+            break;
         }
         
-        if(Has[Bits_MOD])
+        if(TestBits.BitCount != 0)
         {
-            if(Mod == 0b11)
+            u32 ByteIndex = BitIndex / 8;
+            u32 BitInByte = BitIndex % 8;
+            if((ByteIndex >= ArrayCount(Result.LiteralMask)) || ((BitInByte + TestBits.BitCount) > 8))
+            {
+                Result.Valid = false;
+                break;
+            }
+            
+            u32 ByteShift = 8 - BitInByte - TestBits.BitCount;
+            if(TestBits.Usage == Bits_Literal)
             {
-                *ModOperand = GetRegOperand(RM, W || (Bits[Bits_RMRegAlwaysW]));
+                Result.LiteralMask[ByteIndex] |= (u8)(((1u << TestBits.BitCount) - 1) << ByteShift);
+                Result.LiteralValue[ByteIndex] |= (u8)(TestBits.Value << ByteShift);
             }
             else
             {
-                register_mapping_8086 IntelTerm0[8] = { Register_b,  Register_b, Register_bp, Register_bp, Register_si, Register_di, Register_bp, Register_b};
-                register_mapping_8086 IntelTerm1[8] = {Register_si, Register_di, Register_si, Register_di};
-                
-                u32 I = RM&0x7;
-                register_mapping_8086 Term0 = IntelTerm0[I];
-                register_mapping_8086 Term1 = IntelTerm1[I];
-                if((Mod == 0b00) && (RM == 0b110))
+                encoding_bit_field *Field = &Result.Fields[TestBits.Usage];
+                if(Field->PieceCount >= ArrayCount(Field->ByteIndex))
                 {
-                    Term0 = {};
-                    Term1 = {};
+                    Result.Valid = false;
+                    break;
                 }
                 
-                *ModOperand = EffectiveAddressOperand(RegisterAccess(Term0, 0, 2), RegisterAccess(Term1, 0, 2), Displacement);
+                u32 Piece = Field->PieceCount++;
+                Field->ByteIndex[Piece] = (u8)ByteIndex;
+                Field->ByteShift[Piece] = (u8)ByteShift;
+                Field->BitCount[Piece] = TestBits.BitCount;
+                Field->FieldShift[Piece] = TestBits.Shift;
+                Result.Has[TestBits.Usage] = true;
             }
+            
+            BitIndex += TestBits.BitCount;
+        }
+        else if(TestBits.Usage != Bits_Literal)
+        {
+            Result.Implicit[TestBits.Usage] |= (TestBits.Value << TestBits.Shift);
+            Result.Has[TestBits.Usage] = true;
         }
+    }
+    
+    Result.ByteCount = (BitIndex + 7) / 8;
+    
+    return Result;
+}
+
+static u32 ExtractField(encoding_format const &Format, u32 Usage, u8 const *Bytes)
+{
+    encoding_bit_field const &Field = Format.Fields[Usage];
+    
+    u32 Result = Format.Implicit[Usage];
+    for(u32 Piece = 0; Piece < Field.PieceCount; ++Piece)
+    {
+        u32 ReadBits = (Bytes[Field.ByteIndex[Piece]] >> Field.ByteShift[Piece]) & ~(0xff << Field.BitCount[Piece]);
+        Result |= (ReadBits << Field.FieldShift[Piece]);
+    }
+    
+    return Result;
+}
+
+template<u32 EncodingIndex>
+static instruction TryDecodeSpecialized(decode_context *Context, segmented_access At)
+{
+    static constexpr encoding_format Format = GetEncodingFormat(ConstInstructionTable8086[EncodingIndex]);
+    static_assert(Format.Valid, "Instruction table entry cannot be expressed as a two-byte encoding format");
+    
+    instruction Dest = {};
+    
+    u32 StartingAddress = GetAbsoluteAddressOf(At);
+    
+    u8 Bytes[2] = {};
+    Bytes[0] = *AccessMemory(At, 0);
+    if(Format.ByteCount > 1)
+    {
+        Bytes[1] = *AccessMemory(At, 1);
+    }
+    
+    if(((Bytes[0] & Format.LiteralMask[0]) == Format.LiteralValue[0]) &&
+       ((Bytes[1] & Format.LiteralMask[1]) == Format.LiteralValue[1]))
+    {
+        At.SegmentOffset += Format.ByteCount;
+        
+        decoded_fields Fields = {};
+        Fields.HasMOD = Format.Has[Bits_MOD];
+        Fields.HasREG = Format.Has[Bits_REG];
+        Fields.HasSR = Format.Has[Bits_SR];
+        Fields.HasDisp = Format.Has[Bits_Disp];
+        Fields.HasData = Format.Has[Bits_Data];
+        Fields.HasV = Format.Has[Bits_V];
+        
+        Fields.D = ExtractField(Format, Bits_D, Bytes);
+        Fields.S = ExtractField(Format, Bits_S, Bytes);
+        Fields.W = ExtractField(Format, Bits_W, Bytes);
+        Fields.V = ExtractField(Format, Bits_V, Bytes);
+        Fields.Z = ExtractField(Format, Bits_Z, Bytes);
+        Fields.MOD = ExtractField(Format, Bits_MOD, Bytes);
+        Fields.REG = ExtractField(Format, Bits_REG, Bytes);
+        Fields.RM = ExtractField(Format, Bits_RM, Bytes);
+        Fields.SR = ExtractField(Format, Bits_SR, Bytes);
+        Fields.Disp = ExtractField(Format, Bits_Disp, Bytes);
+        Fields.Data = ExtractField(Format, Bits_Data, Bytes);
+        
+        Fields.DispAlwaysW = Format.Implicit[Bits_DispAlwaysW];
+        Fields.WMakesDataW = Format.Implicit[Bits_WMakesDataW];
+        Fields.RMRegAlwaysW = Format.Implicit[Bits_RMRegAlwaysW];
+        Fields.RelJMPDisp = Format.Implicit[Bits_RelJMPDisp];
+        Fields.Far = Format.Implicit[Bits_Far];
         
-        if(Has[Bits_Data] && Has[Bits_Disp] && !Has[Bits_MOD])
+        Dest = BuildInstruction(Context, Format.Op, Fields, At, StartingAddress);
+    }
+    
+    return Dest;
+}
+
+typedef instruction specialized_decoder(decode_context *Context, segmented_access At);
+
+// NOTE: One specialized decoder per table entry, in table order, so that the encoding
+// indices in the dispatch can be used to look them up directly.
+static u32 const SpecializedDecoderCounterBase = __COUNTER__ + 1;
+static specialized_decoder *SpecializedDecoders8086[] =
+{
+#define INST(Mnemonic, ...) &TryDecodeSpecialized<__COUNTER__ - SpecializedDecoderCounterBase>,
+#include "sim86_instruction_table.inl"
+};
+static_assert(ArrayCount(SpecializedDecoders8086) == ArrayCount(InstructionTable8086), "Specialized decoders do not match the instruction table");
+
+struct encoding_literal_bits
+{
+    u8 Mask[2];
+    u8 Value[2];
+};
+
+static encoding_literal_bits GetLiteralBits(instruction_encoding *Inst)
+{
+    // NOTE: This pulls out the "required" bit values for the first two bytes of an encoding,
+    // which is all that is needed to tell which encodings could possibly match a given opcode byte.
+    encoding_literal_bits Result = {};
+    
+    u32 BitIndex = 0;
+    for(u32 BitsIndex = 0; BitsIndex < ArrayCount(Inst->Bits); ++BitsIndex)
+    {
+        instruction_bits TestBits = Inst->Bits[BitsIndex];
+        if(TestBits.Usage == Bits_End)
         {
-            Dest.Operands[0] = IntersegmentAddressOperand(Bits[Bits_Data], Bits[Bits_Disp]);
+            break;
         }
-        else
+        
+        if(TestBits.BitCount != 0)
         {
-            //
-            // NOTE(casey): Because there are some strange opcodes that do things like have an immediate as
-            // a _destination_ ("out", for example), I define immediates and other "additional operands" to
-            // go in "whatever slot was not used by the reg and mod fields".
-            //
-            
-            instruction_operand *LastOperand = &Dest.Operands[0];
-            if(LastOperand->Type)
+            u32 ByteIndex = BitIndex / 8;
+            u32 Shift = 8 - (BitIndex % 8) - TestBits.BitCount;
+            if((TestBits.Usage == Bits_Literal) && (ByteIndex < ArrayCount(Result.Mask)))
             {
-                LastOperand = &Dest.Operands[1];
+                Result.Mask[ByteIndex] |= (u8)(((1u << TestBits.BitCount) - 1) << Shift);
+                Result.Value[ByteIndex] |= (u8)(TestBits.Value << Shift);
             }
             
-            if(Bits[Bits_RelJMPDisp])
-            {
-                *LastOperand = ImmediateOperand(Displacement, Immediate_RelativeJumpDisplacement);
-            }
-            else if(Has[Bits_Data])
-            {
-                *LastOperand = ImmediateOperand(Bits[Bits_Data]);
-            }
-            else if(Has[Bits_V])
+            BitIndex += TestBits.BitCount;
+        }
+    }
+    
+    return Result;
+}
+
+static b32 AreEqual(opcode_candidates A, opcode_candidates B)
+{
+    b32 Result = (A.Count == B.Count);
+    for(u32 Index = 0; Result && (Index < A.Count); ++Index)
+    {
+        Result = (A.EncodingIndex[Index] == B.EncodingIndex[Index]);
+    }
+    
+    return Result;
+}
+
+static instruction_dispatch BuildInstructionDispatch(instruction_table Table)
+{
+    instruction_dispatch Result = {};
+    instruction_dispatch *Dispatch = &Result;
+    
+    b32 Valid = (Table.EncodingCount <= 256);
+    for(u32 EncodingIndex = 0; Valid && (EncodingIndex < Table.EncodingCount); ++EncodingIndex)
+    {
+        encoding_literal_bits Literal = GetLiteralBits(&Table.Encodings[EncodingIndex]);
+        for(u32 FirstByte = 0; Valid && (FirstByte < 256); ++FirstByte)
+        {
+            if((FirstByte & Literal.Mask[0]) == Literal.Value[0])
             {
-                if(Bits[Bits_V])
+                for(u32 REG = 0; REG < 8; ++REG)
                 {
-                    *LastOperand = RegisterOperand(Register_c, 1);
+                    u32 REGMask = Literal.Mask[1] & 0x38;
+                    if(((REG << 3) & REGMask) == (Literal.Value[1] & REGMask))
+                    {
+                        // NOTE: Candidates are appended in table order, so the first match
+                        // is always the same one the linear scan over the whole table would find.
+                        opcode_candidates *Candidates = &Dispatch->Candidates[FirstByte][REG];
+                        if(Candidates->Count < ArrayCount(Candidates->EncodingIndex))
+                        {
+                            Candidates->EncodingIndex[Candidates->Count++] = (u8)EncodingIndex;
+                        }
+                        else
+                        {
+                            Valid = false;
+                        }
+                    }
                 }
-                else
+            }
+        }
+    }
+    
+    // NOTE: If the table ever gets an opcode byte with more encodings than fit in a candidate
+    // list, we just don't use the dispatch at all, and the decoder falls back to the linear scan.
+    if(Valid)
+    {
+        for(u32 FirstByte = 0; FirstByte < 256; ++FirstByte)
+        {
+            for(u32 REG = 1; REG < 8; ++REG)
+            {
+                if(!AreEqual(Dispatch->Candidates[FirstByte][0], Dispatch->Candidates[FirstByte][REG]))
                 {
-                    *LastOperand = ImmediateOperand(1);
+                    Dispatch->SplitOnREG[FirstByte] = true;
                 }
             }
         }
+        
+        Dispatch->Encodings = Table.Encodings;
     }
     
-    return Dest;
+    return Result;
 }
 
-static instruction DecodeInstruction(instruction_table Table, segmented_access At)
+static instruction TryDecodeFromTable(decode_context *Context, instruction_table Table, segmented_access At, decode_path Path)
 {
-    /* TODO(casey): Hmm. It seems like this is a very inefficient way to parse
-       instructions, isn't it? For every instruction, we check every entry in the
-       table until we find a match. Is this bad design? Or did the person who wrote
-       it know what they were doing, and has a plan for how it can be optimized
-       later? Only time will tell... :) */
+    instruction Result = {};
+    
+    // NOTE: The dispatch and the specialized decoders are both generated from the 8086 table,
+    // so they are only used when that is the table we were given.
+    instruction_dispatch *Dispatch = &InstructionDispatch8086;
+    if((Path == Decode_Specialized) &&
+       (Dispatch->Encodings == Table.Encodings) &&
+       (Table.Encodings == InstructionTable8086))
+    {
+        u8 FirstByte = *AccessMemory(At);
+        u32 REG = Dispatch->SplitOnREG[FirstByte] ? ((*AccessMemory(At, 1) >> 3) & 0x7) : 0;
+        
+        opcode_candidates *Candidates = &Dispatch->Candidates[FirstByte][REG];
+        for(u32 Index = 0; !Result.Op && (Index < Candidates->Count); ++Index)
+        {
+            Result = SpecializedDecoders8086[Candidates->EncodingIndex[Index]](Context, At);
+        }
+    }
+    else
+    {
+        for(u32 Index = 0; !Result.Op && (Index < Table.EncodingCount); ++Index)
+        {
+            Result = TryDecode(Context, &Table.Encodings[Index], At);
+        }
+    }
     
+    return Result;
+}
+
+static instruction DecodeInstruction(instruction_table Table, segmented_access At, decode_path Path)
+{
     decode_context Context = {};
     instruction Result = {};
     
@@ -257,17 +627,11 @@ static instruction DecodeInstruction(instruction_table Table, segmented_access A
     u32 TotalSize = 0;
     while(TotalSize < Table.MaxInstructionByteCount)
     {
-        Result = {};
-        for(u32 Index = 0; Index < Table.EncodingCount; ++Index)
+        Result = TryDecodeFromTable(&Context, Table, At, Path);
+        if(Result.Op)
         {
-            instruction_encoding Inst = Table.Encodings[Index];
-            Result = TryDecode(&Context, &Inst, At);
-            if(Result.Op)
-            {
-                At.SegmentOffset += Result.Size;
-                TotalSize += Result.Size;
-                break;
-            }
+            At.SegmentOffset += Result.Size;
+            TotalSize += Result.Size;
         }
         
         if(Result.Op == Op_lock)
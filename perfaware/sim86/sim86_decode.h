@@ -32,4 +32,30 @@ enum register_mapping_8086
     Register_count,
 };
 
-static instruction DecodeInstruction(instruction_table Table, segmented_access At);
+struct opcode_candidates
+{
+    u8 Count;
+    u8 EncodingIndex[3];
+};
+
+struct instruction_dispatch
+{
+    // NOTE: The encoding array this dispatch was built from, so the decoder can tell
+    // whether it actually applies to the table it was handed.
+    instruction_encoding *Encodings;
+    
+    // NOTE: For first bytes that are shared by several encodings (like 0x80 or 0xff),
+    // the REG field of the following ModRM byte selects the candidates. Otherwise, only
+    // the [0] entry is used.
+    b32 SplitOnREG[256];
+    opcode_candidates Candidates[256][8];
+};
+
+enum decode_path
+{
+    Decode_Specialized,
+    Decode_Interpreted, // NOTE: Walks every table entry bit-by-bit, as the reference for the specialized path
+};
+
+static instruction_dispatch BuildInstructionDispatch(instruction_table Table);
+static instruction DecodeInstruction(instruction_table Table, segmented_access At, decode_path Path = Decode_Specialized);
@@ -0,0 +1,360 @@
+/* NOTE: This is a standalone benchmark for DecodeInstruction. It times a linear
+   decode of three kinds of input:
+
+   - Each file given on the command line (usually the part1 listings), on its own
+   - A stream of random instructions, made by decoding random bytes and keeping only
+     the ones that decoded, so every byte of it is valid 8086 code
+   - One large image made by concatenating all the files over and over
+
+   Every corpus is decoded Repeat times, and the minimum and mean are reported, since the
+   minimum is what you want to compare when checking whether a decoder change made things
+   faster. The interpreted decode path is an order of magnitude slower, so it is only timed
+   when asked for with -interpreted.
+
+   Usage: sim86_decode_bench [-repeat N] [-random bytes] [-image bytes] [-interpreted] file...
+*/
+
+#include "sim86.h"
+
+typedef double f64;
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "sim86_instruction.h"
+#include "sim86_instruction_table.h"
+#include "sim86_memory.h"
+#include "sim86_decode.h"
+
+#include "sim86_instruction.cpp"
+#include "sim86_instruction_table.cpp"
+#include "sim86_memory.cpp"
+#include "sim86_decode.cpp"
+
+#include "../part2/listing_0074_platform_metrics.cpp"
+
+// NOTE: Enough zeroes after every corpus that the decoder can always read past the end of it.
+#define CORPUS_PADDING 64
+
+struct corpus
+{
+    char const *Name;
+    u8 *Data;
+    u32 ByteCount;
+};
+
+struct decode_stats
+{
+    u64 MinTime;
+    u64 TotalTime;
+    u32 RunCount;
+    
+    u64 InstructionCount;
+    u64 ByteCount;
+};
+
+static u8 *AllocateCorpus(u32 ByteCount)
+{
+    u8 *Result = (u8 *)calloc(1, (size_t)ByteCount + CORPUS_PADDING);
+    if(!Result)
+    {
+        fprintf(stderr, "ERROR: Unable to allocate %u bytes.\n", ByteCount);
+        exit(1);
+    }
+    
+    return Result;
+}
+
+static corpus LoadCorpus(char *FileName)
+{
+    corpus Result = {};
+    Result.Name = FileName;
+    
+    FILE *File = fopen(FileName, "rb");
+    if(File)
+    {
+        fseek(File, 0, SEEK_END);
+        long Size = ftell(File);
+        fseek(File, 0, SEEK_SET);
+        
+        if(Size > 0)
+        {
+            Result.Data = AllocateCorpus((u32)Size);
+            Result.ByteCount = (u32)fread(Result.Data, 1, (size_t)Size, File);
+        }
+        
+        fclose(File);
+    }
+    else
+    {
+        fprintf(stderr, "ERROR: Unable to open %s.\n", FileName);
+    }
+    
+    return Result;
+}
+
+static u32 RandomU32(u64 *Series)
+{
+    // NOTE: xorshift64*, which is plenty for making up instruction bytes
+    u64 X = *Series;
+    X ^= X >> 12;
+    X ^= X << 25;
+    X ^= X >> 27;
+    *Series = X;
+    
+    u32 Result = (u32)((X * 0x2545F4914F6CDD1Dull) >> 32);
+    return Result;
+}
+
+static corpus MakeRandomCorpus(instruction_table Table, u32 TargetByteCount)
+{
+    corpus Result = {};
+    Result.Name = "random valid instructions";
+    Result.Data = AllocateCorpus(TargetByteCount);
+    
+    u8 Candidate[16 + CORPUS_PADDING] = {};
+    u64 Series = 0x9E3779B97F4A7C15ull;
+    while(Result.ByteCount < TargetByteCount)
+    {
+        for(u32 Index = 0; Index < 16; ++Index)
+        {
+            Candidate[Index] = (u8)RandomU32(&Series);
+        }
+        
+        instruction Instruction = DecodeInstruction(Table, FixedMemoryPow2(20, Candidate));
+        if(Instruction.Op && (Instruction.Size <= (TargetByteCount - Result.ByteCount)))
+        {
+            memcpy(Result.Data + Result.ByteCount, Candidate, Instruction.Size);
+            Result.ByteCount += Instruction.Size;
+        }
+        else if(Instruction.Op)
+        {
+            break;
+        }
+    }
+    
+    return Result;
+}
+
+static corpus MakeConcatenatedCorpus(u32 CorpusCount, corpus *Corpora, u32 TargetByteCount)
+{
+    corpus Result = {};
+    Result.Name = "concatenated image";
+    Result.Data = AllocateCorpus(TargetByteCount);
+    
+    b32 AnyBytes = true;
+    while(AnyBytes && (Result.ByteCount < TargetByteCount))
+    {
+        AnyBytes = false;
+        for(u32 CorpusIndex = 0; CorpusIndex < CorpusCount; ++CorpusIndex)
+        {
+            corpus *Source = Corpora + CorpusIndex;
+            u32 CopyCount = Source->ByteCount;
+            if(CopyCount > (TargetByteCount - Result.ByteCount))
+            {
+                CopyCount = TargetByteCount - Result.ByteCount;
+            }
+            
+            memcpy(Result.Data + Result.ByteCount, Source->Data, CopyCount);
+            Result.ByteCount += CopyCount;
+            AnyBytes = AnyBytes || (CopyCount > 0);
+        }
+    }
+    
+    return Result;
+}
+
+static u32 DecodeCorpus(instruction_table Table, corpus *Corpus, decode_path Path)
+{
+    // NOTE: Bytes that don't decode are skipped one at a time, the same way a disassembler
+    // trying to resynchronize would. The image is walked by moving the memory pointer rather than
+    // the segment, so images of any size can be decoded.
+    u32 Result = 0;
+    
+    u32 Offset = 0;
+    while(Offset < Corpus->ByteCount)
+    {
+        segmented_access At = FixedMemoryPow2(20, Corpus->Data + Offset);
+        instruction Instruction = DecodeInstruction(Table, At, Path);
+        if(Instruction.Op)
+        {
+            Offset += Instruction.Size;
+            ++Result;
+        }
+        else
+        {
+            ++Offset;
+        }
+    }
+    
+    return Result;
+}
+
+static decode_stats BenchmarkCorpus(instruction_table Table, corpus *Corpus, decode_path Path, u32 RepeatCount)
+{
+    decode_stats Result = {};
+    Result.MinTime = ~0ull;
+    Result.ByteCount = Corpus->ByteCount;
+    
+    for(u32 Repeat = 0; Repeat < RepeatCount; ++Repeat)
+    {
+        u64 Start = ReadCPUTimer();
+        u32 InstructionCount = DecodeCorpus(Table, Corpus, Path);
+        u64 Elapsed = ReadCPUTimer() - Start;
+        
+        Result.InstructionCount = InstructionCount;
+        Result.TotalTime += Elapsed;
+        ++Result.RunCount;
+        if(Result.MinTime > Elapsed)
+        {
+            Result.MinTime = Elapsed;
+        }
+    }
+    
+    return Result;
+}
+
+static void PrintStats(char const *Label, decode_stats Stats, u64 CPUFreq)
+{
+    if(Stats.RunCount && Stats.InstructionCount)
+    {
+        f64 MeanTime = (f64)Stats.TotalTime / (f64)Stats.RunCount;
+        f64 Times[2] = {(f64)Stats.MinTime, MeanTime};
+        char const *Names[2] = {"min", "mean"};
+        
+        for(u32 Index = 0; Index < ArrayCount(Times); ++Index)
+        {
+            f64 Seconds = Times[Index] / (f64)CPUFreq;
+            if(Seconds > 0.0)
+            {
+                printf("  %-12s %4s: %10.3fms %9.2f Minst/s %9.2f MB/s %8.2f cycles/inst\n", Label, Names[Index],
+                       1000.0*Seconds, ((f64)Stats.InstructionCount / Seconds) / 1000000.0,
+                       ((f64)Stats.ByteCount / Seconds) / (1024.0*1024.0),
+                       Times[Index] / (f64)Stats.InstructionCount);
+            }
+        }
+    }
+}
+
+static decode_stats BenchmarkAndPrint(instruction_table Table, corpus *Corpus, u32 RepeatCount, u64 CPUFreq,
+                                      b32 IncludeInterpreted)
+{
+    decode_stats Specialized = BenchmarkCorpus(Table, Corpus, Decode_Specialized, RepeatCount);
+    
+    printf("%s: %u bytes, %llu instructions\n", Corpus->Name, Corpus->ByteCount,
+           (unsigned long long)Specialized.InstructionCount);
+    PrintStats("specialized", Specialized, CPUFreq);
+    
+    if(IncludeInterpreted)
+    {
+        decode_stats Interpreted = BenchmarkCorpus(Table, Corpus, Decode_Interpreted, RepeatCount);
+        PrintStats("interpreted", Interpreted, CPUFreq);
+        
+        if(Specialized.InstructionCount != Interpreted.InstructionCount)
+        {
+            fprintf(stderr, "ERROR: Decode paths disagree on the instruction count for %s.\n", Corpus->Name);
+        }
+    }
+    
+    return Specialized;
+}
+
+int main(int ArgCount, char **Args)
+{
+    u32 RepeatCount = 10;
+    u32 RandomByteCount = 4*1024*1024;
+    u32 ImageByteCount = 32*1024*1024;
+    b32 IncludeInterpreted = false;
+    
+    u32 FirstFile = 1;
+    for(; FirstFile < (u32)ArgCount; ++FirstFile)
+    {
+        char *Arg = Args[FirstFile];
+        b32 HasValue = ((FirstFile + 1) < (u32)ArgCount);
+        if(HasValue && (strcmp(Arg, "-repeat") == 0))
+        {
+            RepeatCount = (u32)atoi(Args[++FirstFile]);
+        }
+        else if(HasValue && (strcmp(Arg, "-random") == 0))
+        {
+            RandomByteCount = (u32)atoi(Args[++FirstFile]);
+        }
+        else if(HasValue && (strcmp(Arg, "-image") == 0))
+        {
+            ImageByteCount = (u32)atoi(Args[++FirstFile]);
+        }
+        else if(strcmp(Arg, "-interpreted") == 0)
+        {
+            IncludeInterpreted = true;
+        }
+        else
+        {
+            break;
+        }
+    }
+    
+    if(!RepeatCount)
+    {
+        fprintf(stderr, "USAGE: %s [-repeat N] [-random bytes] [-image bytes] [-interpreted] [8086 machine code file] ...\n", Args[0]);
+        return 1;
+    }
+    
+    instruction_table Table = Get8086InstructionTable();
+    u64 CPUFreq = EstimateCPUTimerFreq();
+    printf("CPU timer: %llu Hz estimated, %u repeats\n\n", (unsigned long long)CPUFreq, RepeatCount);
+    
+    u32 FileCount = ArgCount - FirstFile;
+    corpus *Files = (corpus *)calloc(FileCount + 1, sizeof(corpus));
+    
+    decode_stats FileTotal = {};
+    u32 FileRunCount = 0;
+    for(u32 FileIndex = 0; FileIndex < FileCount; ++FileIndex)
+    {
+        corpus *File = Files + FileIndex;
+        *File = LoadCorpus(Args[FirstFile + FileIndex]);
+        if(File->ByteCount)
+        {
+            decode_stats Stats = BenchmarkAndPrint(Table, File, RepeatCount, CPUFreq, IncludeInterpreted);
+            FileTotal.MinTime += Stats.MinTime;
+            FileTotal.TotalTime += Stats.TotalTime;
+            FileTotal.InstructionCount += Stats.InstructionCount;
+            FileTotal.ByteCount += Stats.ByteCount;
+            ++FileRunCount;
+        }
+    }
+    
+    if(FileRunCount)
+    {
+        // NOTE: Sum of the per-file minimums and means, which is what decoding the whole set of files once costs.
+        FileTotal.RunCount = RepeatCount;
+        printf("all files: %llu bytes, %llu instructions\n", (unsigned long long)FileTotal.ByteCount,
+               (unsigned long long)FileTotal.InstructionCount);
+        PrintStats("specialized", FileTotal, CPUFreq);
+    }
+    
+    if(RandomByteCount)
+    {
+        corpus Random = MakeRandomCorpus(Table, RandomByteCount);
+        BenchmarkAndPrint(Table, &Random, RepeatCount, CPUFreq, IncludeInterpreted);
+        free(Random.Data);
+    }
+    
+    if(ImageByteCount && FileRunCount)
+    {
+        corpus Image = MakeConcatenatedCorpus(FileCount, Files, ImageByteCount);
+        BenchmarkAndPrint(Table, &Image, RepeatCount, CPUFreq, IncludeInterpreted);
+        free(Image.Data);
+    }
+    
+    for(u32 FileIndex = 0; FileIndex < FileCount; ++FileIndex)
+    {
+        free(Files[FileIndex].Data);
+    }
+    free(Files);
+    
+    return 0;
+}
@@ -0,0 +1,88 @@
+static packed_instruction *GetCacheEntry(decode_cache *Cache, u32 AbsAddr)
+{
+    packed_instruction *Result = &Cache->Entries[AbsAddr % ArrayCount(Cache->Entries)];
+    return Result;
+}
+
+static b32 GetCachedInstruction(decode_cache *Cache, segmented_access At, instruction *Dest)
+{
+    u32 AbsAddr = GetAbsoluteAddressOf(At);
+    packed_instruction *Entry = GetCacheEntry(Cache, AbsAddr);
+    
+    b32 Result = (Entry->Op && (Entry->Address == AbsAddr));
+    if(Result)
+    {
+        *Dest = UnpackInstruction(*Entry);
+    }
+    
+    return Result;
+}
+
+static void CacheInstruction(decode_cache *Cache, segmented_access At, instruction Instruction)
+{
+    // NOTE: Only instructions whose bytes are contiguous in memory are cached, since
+    // invalidation assumes the bytes run from Address to Address + Size. The only ones that aren't
+    // are the (very rare) instructions that wrap around the end of the address space.
+    u32 AbsAddr = GetAbsoluteAddressOf(At);
+    packed_instruction Packed = {};
+    if(Instruction.Op &&
+       (Instruction.Address == AbsAddr) &&
+       (GetAbsoluteAddressOf(At, (u16)(Instruction.Size - 1)) == (AbsAddr + Instruction.Size - 1)) &&
+       PackInstruction(Instruction, &Packed))
+    {
+        // NOTE: Bytes of an evicted instruction are left watched, because another cached
+        // instruction may share them. That only costs a wasted check if they get written.
+        *GetCacheEntry(Cache, AbsAddr) = Packed;
+        for(u32 ByteIndex = 0; ByteIndex < Instruction.Size; ++ByteIndex)
+        {
+            SetWatch(&Cache->Watch, AbsAddr + ByteIndex, true);
+        }
+    }
+}
+
+static void InvalidateInstructionsAt(decode_cache *Cache, u32 WrittenAddr)
+{
+    // NOTE: An instruction can be at most 15 bytes long, so only instructions starting in
+    // the 15 bytes up to and including the written byte could possibly contain it.
+    for(u32 Back = 0; (Back < 15) && (Back <= WrittenAddr); ++Back)
+    {
+        u32 StartAddr = WrittenAddr - Back;
+        packed_instruction *Entry = GetCacheEntry(Cache, StartAddr);
+        if(Entry->Op && (Entry->Address == StartAddr) && (Back < GetPackedSize(*Entry)))
+        {
+            *Entry = {};
+        }
+    }
+    
+    // NOTE: Every cached instruction containing the written byte is gone now, so it no longer
+    // needs to be watched. The other bytes of those instructions may still belong to instructions that
+    // overlap them, so they are left alone.
+    SetWatch(&Cache->Watch, WrittenAddr, false);
+}
+
+static void InvalidateWrittenInstructions(decode_cache *Cache)
+{
+    memory_watch *Watch = &Cache->Watch;
+    if(Watch->Overflowed)
+    {
+        for(u32 EntryIndex = 0; EntryIndex < ArrayCount(Cache->Entries); ++EntryIndex)
+        {
+            Cache->Entries[EntryIndex] = {};
+        }
+        
+        for(u32 ByteIndex = 0; ByteIndex < ArrayCount(Watch->Bits); ++ByteIndex)
+        {
+            Watch->Bits[ByteIndex] = 0;
+        }
+    }
+    else
+    {
+        for(u32 HitIndex = 0; HitIndex < Watch->HitCount; ++HitIndex)
+        {
+            InvalidateInstructionsAt(Cache, Watch->Hits[HitIndex]);
+        }
+    }
+    
+    Watch->Overflowed = false;
+    Watch->HitCount = 0;
+}
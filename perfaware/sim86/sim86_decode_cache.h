@@ -0,0 +1,17 @@
+#define DECODE_CACHE_ENTRY_COUNT 4096
+
+struct decode_cache
+{
+    // NOTE: The bytes of every cached instruction are watched, so that any write to them
+    // (ie., self-modifying code) can knock the instruction back out of the cache.
+    memory_watch Watch;
+    
+    // NOTE: Direct-mapped by absolute address. An entry is empty if its Op is Op_None,
+    // and it holds the instruction at a given address only if its Address matches. Entries are
+    // stored packed so the whole cache stays small.
+    packed_instruction Entries[DECODE_CACHE_ENTRY_COUNT];
+};
+
+static b32 GetCachedInstruction(decode_cache *Cache, segmented_access At, instruction *Dest);
+static void CacheInstruction(decode_cache *Cache, segmented_access At, instruction Instruction);
+static void InvalidateWrittenInstructions(decode_cache *Cache);
@@ -0,0 +1,18 @@
+/* NOTE: A memory delta is a -dump that only has the pages that aren't all zero, for when a run only
+   touched a little of the 1mb. Rebuilding the full dump is just starting from all zeroes and copying the
+   pages back in (see sim86_delta_rebuild.cpp).
+
+   The file is a memory_delta_header, followed by the u32 index of each page in the file, in increasing
+   order, followed by the pages themselves, each MEMORY_PAGE_SIZE bytes, in the same order. */
+
+#define MEMORY_DELTA_MAGIC 0x44363853 // NOTE: "S86D"
+#define MEMORY_DELTA_VERSION 1
+
+struct memory_delta_header
+{
+    u32 Magic;
+    u32 Version;
+    u32 MemorySize;
+    u32 PageSize;
+    u32 PageCount;
+};
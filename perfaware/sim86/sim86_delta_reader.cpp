@@ -0,0 +1,51 @@
+static u32 GetMemoryDeltaSize(u8 *Delta, u32 DeltaSize)
+{
+    u32 Result = 0;
+    
+    memory_delta_header Header = {};
+    if(DeltaSize >= sizeof(Header))
+    {
+        memcpy(&Header, Delta, sizeof(Header));
+        
+        u32 PageCount = Header.MemorySize >> MEMORY_PAGE_SHIFT;
+        if((Header.Magic == MEMORY_DELTA_MAGIC) &&
+           (Header.Version == MEMORY_DELTA_VERSION) &&
+           (Header.PageSize == MEMORY_PAGE_SIZE) &&
+           (Header.MemorySize <= (1 << 20)) &&
+           (Header.PageCount <= PageCount) &&
+           (((DeltaSize - sizeof(Header)) / (sizeof(u32) + MEMORY_PAGE_SIZE)) >= Header.PageCount))
+        {
+            // NOTE: Every page index has to be in range, or applying the delta would write outside the memory.
+            b32 Valid = true;
+            for(u32 Index = 0; Index < Header.PageCount; ++Index)
+            {
+                u32 PageIndex;
+                memcpy(&PageIndex, Delta + sizeof(Header) + Index*sizeof(u32), sizeof(PageIndex));
+                Valid = Valid && (PageIndex < PageCount);
+            }
+            
+            if(Valid)
+            {
+                Result = Header.MemorySize;
+            }
+        }
+    }
+    
+    return Result;
+}
+
+static void ApplyMemoryDelta(u8 *Delta, u8 *Memory)
+{
+    // NOTE: The delta has to have been checked with GetMemoryDeltaSize, and Memory has to be that big.
+    memory_delta_header Header;
+    memcpy(&Header, Delta, sizeof(Header));
+    
+    u8 *Indices = Delta + sizeof(Header);
+    u8 *Pages = Indices + Header.PageCount*sizeof(u32);
+    for(u32 Index = 0; Index < Header.PageCount; ++Index)
+    {
+        u32 PageIndex;
+        memcpy(&PageIndex, Indices + Index*sizeof(u32), sizeof(PageIndex));
+        memcpy(Memory + (PageIndex << MEMORY_PAGE_SHIFT), Pages + Index*MEMORY_PAGE_SIZE, MEMORY_PAGE_SIZE);
+    }
+}
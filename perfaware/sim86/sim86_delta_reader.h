@@ -0,0 +1,6 @@
+/* NOTE: Only sim86_delta_rebuild.cpp reads deltas back, so this is kept apart from WriteMemoryDelta, which is
+   all the simulator itself needs. The format is in sim86_delta.h. */
+
+// NOTE: Returns the size of the memory the delta was written from, or 0 if it isn't a valid delta.
+static u32 GetMemoryDeltaSize(u8 *Delta, u32 DeltaSize);
+static void ApplyMemoryDelta(u8 *Delta, u8 *Memory);
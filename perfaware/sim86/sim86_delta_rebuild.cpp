@@ -0,0 +1,101 @@
+/* NOTE: This turns memory deltas written by sim86 -dumpdelta back into the full memory images that
+   -dump would have written. Each sim86_memory_N.delta is rebuilt as sim86_memory_N.data next to it (any
+   other name just gets .data added to the end).
+
+   Usage: sim86_delta_rebuild delta...
+*/
+
+#include "sim86.h"
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "sim86_instruction.h"
+#include "sim86_memory.h"
+#include "sim86_delta.h"
+#include "sim86_delta_reader.h"
+#include "sim86_platform.h"
+
+#include "sim86_memory.cpp"
+#include "sim86_delta_reader.cpp"
+#include "sim86_platform.cpp"
+
+static b32 RebuildFromDelta(char *DeltaFileName)
+{
+    b32 Result = false;
+    
+    mapped_file Mapped = MapFileForRead(DeltaFileName, 0);
+    if(Mapped.Data)
+    {
+        u32 MemorySize = GetMemoryDeltaSize(Mapped.Data, Mapped.ByteCount);
+        u8 *Memory = MemorySize ? (u8 *)calloc(1, MemorySize) : 0;
+        if(Memory)
+        {
+            ApplyMemoryDelta(Mapped.Data, Memory);
+            
+            char DataFileName[1024];
+            size_t NameLength = strlen(DeltaFileName);
+            if((NameLength >= 6) && (strcmp(DeltaFileName + NameLength - 6, ".delta") == 0))
+            {
+                NameLength -= 6;
+            }
+            snprintf(DataFileName, sizeof(DataFileName), "%.*s.data", (int)NameLength, DeltaFileName);
+            
+            FILE *DataFile = fopen(DataFileName, "wb");
+            if(DataFile)
+            {
+                Result = (fwrite(Memory, MemorySize, 1, DataFile) == 1);
+                fclose(DataFile);
+            }
+            
+            if(!Result)
+            {
+                fprintf(stderr, "ERROR: Unable to write %s.\n", DataFileName);
+            }
+            
+            free(Memory);
+        }
+        else if(!MemorySize)
+        {
+            fprintf(stderr, "ERROR: %s is not a sim86 memory delta.\n", DeltaFileName);
+        }
+        else
+        {
+            fprintf(stderr, "ERROR: Unable to allocate memory to rebuild %s.\n", DeltaFileName);
+        }
+        
+        UnmapFile(&Mapped);
+    }
+    else
+    {
+        fprintf(stderr, "ERROR: Unable to map %s.\n", DeltaFileName);
+    }
+    
+    return Result;
+}
+
+int main(int ArgCount, char **Args)
+{
+    int Result = 0;
+    
+    if(ArgCount > 1)
+    {
+        for(int ArgIndex = 1; ArgIndex < ArgCount; ++ArgIndex)
+        {
+            if(!RebuildFromDelta(Args[ArgIndex]))
+            {
+                Result = 1;
+            }
+        }
+    }
+    else
+    {
+        fprintf(stderr, "USAGE: %s [sim86 memory delta file] ...\n", Args[0]);
+    }
+    
+    return Result;
+}
@@ -0,0 +1,54 @@
+static b32 IsZeroPage(u8 *Page)
+{
+    u64 Bits = 0;
+    for(u32 Offset = 0; Offset < MEMORY_PAGE_SIZE; Offset += sizeof(u64))
+    {
+        u64 Chunk;
+        memcpy(&Chunk, Page + Offset, sizeof(Chunk));
+        Bits |= Chunk;
+    }
+    
+    b32 Result = (Bits == 0);
+    return Result;
+}
+
+static b32 WriteMemoryDelta(char *FileName, segmented_access Memory, dirty_pages *Written)
+{
+    u32 MemorySize = GetHighestAddress(Memory) + 1;
+    u32 PageCount = MemorySize >> MEMORY_PAGE_SHIFT;
+    
+    u32 Pages[MEMORY_PAGE_COUNT];
+    u32 DeltaPageCount = 0;
+    for(u32 PageIndex = 0; PageIndex < PageCount; ++PageIndex)
+    {
+        if((!Written || IsPageDirty(Written, PageIndex)) &&
+           !IsZeroPage(Memory.Memory + (PageIndex << MEMORY_PAGE_SHIFT)))
+        {
+            Pages[DeltaPageCount++] = PageIndex;
+        }
+    }
+    
+    FILE *File = fopen(FileName, "wb");
+    b32 Result = (File != 0);
+    if(File)
+    {
+        memory_delta_header Header = {};
+        Header.Magic = MEMORY_DELTA_MAGIC;
+        Header.Version = MEMORY_DELTA_VERSION;
+        Header.MemorySize = MemorySize;
+        Header.PageSize = MEMORY_PAGE_SIZE;
+        Header.PageCount = DeltaPageCount;
+        
+        fwrite(&Header, sizeof(Header), 1, File);
+        fwrite(Pages, sizeof(Pages[0]), DeltaPageCount, File);
+        for(u32 Index = 0; Index < DeltaPageCount; ++Index)
+        {
+            fwrite(Memory.Memory + (Pages[Index] << MEMORY_PAGE_SHIFT), MEMORY_PAGE_SIZE, 1, File);
+        }
+        
+        Result = (ferror(File) == 0);
+        fclose(File);
+    }
+    
+    return Result;
+}
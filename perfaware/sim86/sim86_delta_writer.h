@@ -0,0 +1,6 @@
+/* NOTE: Only the simulator writes deltas (for -dumpdelta), so this is kept apart from the reading in
+   sim86_delta_reader.h, which is all sim86_delta_rebuild.cpp needs. The format is in sim86_delta.h. */
+
+/* NOTE: If Written is given, it has to have every page that was written since the memory was all
+   zeroes, and only those pages are looked at. Otherwise, every page is checked for anything nonzero. */
+static b32 WriteMemoryDelta(char *FileName, segmented_access Memory, dirty_pages *Written);
@@ -57,6 +57,7 @@ static u16 GetRegisterValueU16(register_state_8086 *Registers, u32 Index)
 static void WriteU8(segmented_access Memory, u16 Offset, u8 Value)
 {
     *AccessMemory(Memory, Offset) = Value;
+    NoteWrite(Memory, Offset);
 }
 
 static u8 ReadU8(segmented_access Memory, u16 Offset)
@@ -67,13 +68,34 @@ static u8 ReadU8(segmented_access Memory, u16 Offset)
 
 static void WriteU16(segmented_access Memory, u16 Offset, u16 Value)
 {
-    WriteU8(Memory, Offset + 0, (Value & 0xff));
-    WriteU8(Memory, Offset + 1, ((Value >> 8) & 0xff));
+    u8 *Word = AccessContiguousMemory(Memory, Offset, 2);
+    if(Word)
+    {
+        memcpy(Word, &Value, sizeof(Value));
+        NoteWrite(Memory, Offset + 0);
+        NoteWrite(Memory, Offset + 1);
+    }
+    else
+    {
+        WriteU8(Memory, Offset + 0, (Value & 0xff));
+        WriteU8(Memory, Offset + 1, ((Value >> 8) & 0xff));
+    }
 }
 
 static u16 ReadU16(segmented_access Memory, u16 Offset)
 {
-    u16 Result = (u16)ReadU8(Memory, Offset) | ((u16)ReadU8(Memory, Offset + 1) << 8);
+    u16 Result = 0;
+    
+    u8 *Word = AccessContiguousMemory(Memory, Offset, 2);
+    if(Word)
+    {
+        memcpy(&Result, Word, sizeof(Result));
+    }
+    else
+    {
+        Result = (u16)ReadU8(Memory, Offset) | ((u16)ReadU8(Memory, Offset + 1) << 8);
+    }
+    
     return Result;
 }
 
@@ -89,6 +111,12 @@ static void WriteN(segmented_access Memory, u16 Offset, u16 Value, u32 Count)
     }
 }
 
+static u16 ReadN(segmented_access Memory, u16 Offset, u32 Count)
+{
+    u16 Result = (Count == 1) ? ReadU8(Memory, Offset) : ReadU16(Memory, Offset);
+    return Result;
+}
+
 static void Push(segmented_access Memory, register_state_8086 *Registers, u16 Value)
 {
     segmented_access StackSegment = SegmentFromRegister(Memory, Registers->ss);
@@ -178,25 +206,95 @@ static void UpdateLogFlags(register_state_8086 *Registers, u16 MaskedResult, u32
     UpdateCommonFlags(Registers, MaskedResult, WWidth);
 }
 
-static void WriteLogOpResult(register_state_8086 *Registers, segmented_access Dest, u16 UnmaskedResult, u32 WWidth)
+static void MaterializeFlags(register_state_8086 *Registers, lazy_flags *Lazy)
+{
+    if(Lazy && Lazy->Op)
+    {
+        u32 WWidth = Lazy->WWidth;
+        u32 V0 = Lazy->V0;
+        u32 V1 = Lazy->V1;
+        u32 R = Lazy->R;
+        u32 SignBit = SignBitFor(WWidth);
+        u16 MaskedResult = R & WidthMaskFor(WWidth);
+        
+        switch(Lazy->Op)
+        {
+            case LazyFlags_Add:
+            {
+                b32 OF = (~(V0 ^ V1) & (V0 ^ R)) & SignBit;
+                b32 AF = ((V0 & 0xf) + (V1 & 0xf)) & 0x10;
+                UpdateArithFlags(Registers, R, MaskedResult, WWidth, OF, AF);
+            } break;
+            
+            case LazyFlags_Sub:
+            {
+                b32 OF = ((V0 ^ V1) & (V0 ^ R)) & SignBit;
+                b32 AF = ((V0 & 0xf) - (V1 & 0xf)) & 0x10;
+                UpdateArithFlags(Registers, R, MaskedResult, WWidth, OF, AF);
+            } break;
+            
+            case LazyFlags_Arith:
+            {
+                UpdateArithFlags(Registers, R, MaskedResult, WWidth);
+            } break;
+            
+            case LazyFlags_Log:
+            {
+                UpdateLogFlags(Registers, (u16)R, WWidth);
+            } break;
+            
+            case LazyFlags_None: {} break;
+        }
+        
+        Lazy->Op = LazyFlags_None;
+    }
+}
+
+static void SetFlagsFrom(register_state_8086 *Registers, lazy_flags *Lazy, lazy_flags_op Op, u32 WWidth, u32 V0, u32 V1, u32 R)
+{
+    // NOTE: Eager flags are just lazy flags that get materialized right away, so both always come out the same.
+    lazy_flags Pending = {Op, WWidth, V0, V1, R};
+    if(Lazy)
+    {
+        *Lazy = Pending;
+    }
+    else
+    {
+        MaterializeFlags(Registers, &Pending);
+    }
+}
+
+static void WriteLogOpResult(register_state_8086 *Registers, segmented_access Dest, u16 UnmaskedResult, u32 WWidth,
+                             lazy_flags *Lazy)
 {
     u16 MaskedResult = UnmaskedResult & WidthMaskFor(WWidth);
-    UpdateLogFlags(Registers, MaskedResult, WWidth);
+    SetFlagsFrom(Registers, Lazy, LazyFlags_Log, WWidth, 0, 0, MaskedResult);
     WriteN(Dest, 0, MaskedResult, WWidth);
 }
 
 static void WriteArithOpResult(register_state_8086 *Registers, segmented_access Dest, u32 UnmaskedResult, u32 WWidth,
-                               b32 OF = false, b32 AF = false)
+                               lazy_flags *Lazy)
 {
-    /* TODO(casey): I didn't like how this came out. Unlike the other writeback functions, AFAICT this one required
-       me to pass in OF and AF since they get computed differently. I assume this is because I don't quite "get" how
-       the ALU is supposed to work, and actually it is simpler than that if you know the right approach.
-    */
-    
-    u16 MaskedResult = UnmaskedResult & WidthMaskFor(WWidth);
-    UpdateArithFlags(Registers, UnmaskedResult, MaskedResult, WWidth, OF, AF);
-    
-    WriteN(Dest, 0, MaskedResult, WWidth);
+    // NOTE: add, sub and cmp compute OF and AF, so they have their own versions of this below.
+    SetFlagsFrom(Registers, Lazy, LazyFlags_Arith, WWidth, 0, 0, UnmaskedResult);
+    WriteN(Dest, 0, UnmaskedResult & WidthMaskFor(WWidth), WWidth);
+}
+
+static u16 AddAndUpdateFlags(register_state_8086 *Registers, u32 V0, u32 V1, u32 WWidth, lazy_flags *Lazy)
+{
+    u32 Mask = WidthMaskFor(WWidth);
+    u32 R = (V0 & Mask) + (V1 & Mask);
+    SetFlagsFrom(Registers, Lazy, LazyFlags_Add, WWidth, V0, V1, R);
+    return R & Mask;
+}
+
+static u16 SubAndUpdateFlags(register_state_8086 *Registers, u32 V0, u32 V1, u32 WWidth, lazy_flags *Lazy)
+{
+    // NOTE: This is also cmp, which just doesn't write the result back.
+    u32 WidthMask = WidthMaskFor(WWidth);
+    u32 R = (V0 & WidthMask) - (V1 & WidthMask);
+    SetFlagsFrom(Registers, Lazy, LazyFlags_Sub, WWidth, V0, V1, R);
+    return R & WidthMask;
 }
 
 static void WriteShiftOpResult(register_state_8086 *Registers, segmented_access Dest, u32 PriorValue, u32 UnmaskedResultS1, u32 WWidth)
@@ -236,6 +334,45 @@ static void ConditionalJump(exec_result *Result, register_state_8086 *Registers,
     Result->BranchTaken = ShouldJump;
 }
 
+static b32 EvaluateJumpCondition(register_state_8086 *Registers, operation_type Op)
+{
+    // NOTE: For loop, loopz and loopnz, this also does the decrement of cx.
+    b32 CF = Registers->flags & Flag_CF;
+    b32 PF = Registers->flags & Flag_PF;
+    b32 ZF = Registers->flags & Flag_ZF;
+    b32 SF = Registers->flags & Flag_SF;
+    b32 OF = Registers->flags & Flag_OF;
+    
+    b32 Result = false;
+    switch(Op)
+    {
+        case Op_je: {Result = (ZF == 1);} break;
+        case Op_jl: {Result = ((SF ^ OF) == 1);} break;
+        case Op_jle: {Result = (((SF ^ OF) | ZF) == 1);} break;
+        case Op_jb: {Result = (CF == 1);} break;
+        case Op_jbe: {Result = ((CF | ZF) == 1);} break;
+        case Op_jp: {Result = (PF == 1);} break;
+        case Op_jo: {Result = (OF == 1);} break;
+        case Op_js: {Result = (SF == 1);} break;
+        case Op_jne: {Result = (ZF == 0);} break;
+        case Op_jnl: {Result = ((SF ^ OF) == 0);} break;
+        case Op_jg: {Result = (((SF & OF) | ZF) == 0);} break;
+        case Op_jnb: {Result = (CF == 0);} break;
+        case Op_ja: {Result = ((CF | ZF) == 0);} break;
+        case Op_jnp: {Result = (PF == 0);} break;
+        case Op_jno: {Result = (OF == 0);} break;
+        case Op_jns: {Result = (SF == 0);} break;
+        case Op_loop: {Result = (--Registers->cx != 0);} break;
+        case Op_loopz: {Result = ((--Registers->cx != 0) && (ZF == 1));} break;
+        case Op_loopnz: {Result = ((--Registers->cx != 0) && (ZF == 0));} break;
+        case Op_jcxz: {Result = (Registers->cx != 0);} break;
+        
+        default: {} break;
+    }
+    
+    return Result;
+}
+
 static segmented_access DetermineSegmentAccess(segmented_access Memory, instruction Instruction, register_state_8086 *Registers,
                                                u16 DefaultSegRegValue)
 {
@@ -284,6 +421,9 @@ static operand_access AccessOperand(segmented_access Memory, register_state_8086
                 u16 SegReg = (Source.Address.Terms[0].Register.Index == Register_bp) ? Registers->ss : Registers->ds;
                 
                 Result.Op.Memory = Memory.Memory;
+                Result.Op.Watch = Memory.Watch;
+                Result.Op.WriteLog = Memory.WriteLog;
+                Result.Op.Dirty = Memory.Dirty;
                 Result.Op.SegmentBase = DetermineSegmentAccess(Memory, Instruction, Registers, SegReg).SegmentBase;
                 for(u32 TermIndex = 0; TermIndex < ArrayCount(Source.Address.Terms); ++TermIndex)
                 {
@@ -305,23 +445,366 @@ static operand_access AccessOperand(segmented_access Memory, register_state_8086
     return Result;
 }
 
-static exec_result ExecInstruction(segmented_access Memory, register_state_8086 *Registers, instruction Instruction)
+struct string_operands
+{
+    segmented_access Source; // NOTE: ds:si, or si in the override segment
+    segmented_access Dest; // NOTE: Always es:di
+    u32 WWidth;
+    s32 Delta; // NOTE: Negative when DF is set
+};
+
+static b32 StringUsesSource(operation_type Op)
+{
+    b32 Result = ((Op == Op_movs) || (Op == Op_cmps) || (Op == Op_lods));
+    return Result;
+}
+
+static b32 StringUsesDest(operation_type Op)
+{
+    b32 Result = ((Op == Op_movs) || (Op == Op_cmps) || (Op == Op_scas) || (Op == Op_stos));
+    return Result;
+}
+
+static u16 ExecStringStep(register_state_8086 *Registers, operation_type Op, string_operands *String, lazy_flags *Lazy)
+{
+    // NOTE: Does one iteration. For cmps and scas, this returns the masked result of the compare, so
+    // rep can tell whether to keep going.
+    u32 WWidth = String->WWidth;
+    u16 Result = 0;
+    
+    switch(Op)
+    {
+        case Op_movs:
+        {
+            WriteN(String->Dest, Registers->di, ReadN(String->Source, Registers->si, WWidth), WWidth);
+        } break;
+        
+        case Op_cmps:
+        {
+            Result = SubAndUpdateFlags(Registers, ReadN(String->Source, Registers->si, WWidth),
+                                       ReadN(String->Dest, Registers->di, WWidth), WWidth, Lazy);
+        } break;
+        
+        case Op_scas:
+        {
+            Result = SubAndUpdateFlags(Registers, Registers->ax, ReadN(String->Dest, Registers->di, WWidth), WWidth, Lazy);
+        } break;
+        
+        case Op_lods:
+        {
+            u16 Value = ReadN(String->Source, Registers->si, WWidth);
+            if(WWidth == 2)
+            {
+                Registers->ax = Value;
+            }
+            else
+            {
+                Registers->al = (u8)Value;
+            }
+        } break;
+        
+        case Op_stos:
+        {
+            WriteN(String->Dest, Registers->di, Registers->ax, WWidth);
+        } break;
+        
+        default: {} break;
+    }
+    
+    if(StringUsesSource(Op))
+    {
+        Registers->si += String->Delta;
+    }
+    
+    if(StringUsesDest(Op))
+    {
+        Registers->di += String->Delta;
+    }
+    
+    return Result;
+}
+
+static b32 GetStringRange(segmented_access Segment, u16 Offset, u32 Count, s32 Delta, u32 *LowOffset, u32 *LowAddress)
+{
+    // NOTE: Returns where the lowest byte of Count elements starting at Offset is, both as an offset in
+    // the segment and as an absolute address, as long as they are all in one contiguous piece of host memory
+    // (see AccessContiguousMemory). With mirrored memory, that piece can run past the end of memory.
+    u32 WWidth = (Delta < 0) ? -Delta : Delta;
+    u32 Bytes = Count*WWidth;
+    
+    b32 Result = false;
+    if(Delta > 0)
+    {
+        *LowOffset = Offset;
+        Result = ((Offset + Bytes) <= 0x10000);
+    }
+    else
+    {
+        *LowOffset = Offset + WWidth - Bytes;
+        Result = (((Offset + WWidth) >= Bytes) && ((Offset + WWidth) <= 0x10000));
+    }
+    
+    if(Result)
+    {
+        *LowAddress = GetAbsoluteAddressOf(Segment, (u16)*LowOffset);
+        Result = (AccessContiguousMemory(Segment, (u16)*LowOffset, Bytes) != 0);
+    }
+    
+    return Result;
+}
+
+static u32 FindFirstDifference(u8 *A, u8 *B, u32 Count)
+{
+    // NOTE: Compares 8 bytes at a time until something differs, then finds the byte that did.
+    u32 Result = 0;
+    while((Result + 8) <= Count)
+    {
+        u64 ValueA, ValueB;
+        memcpy(&ValueA, A + Result, sizeof(ValueA));
+        memcpy(&ValueB, B + Result, sizeof(ValueB));
+        if(ValueA != ValueB)
+        {
+            break;
+        }
+        Result += 8;
+    }
+    
+    while((Result < Count) && (A[Result] == B[Result]))
+    {
+        ++Result;
+    }
+    
+    return Result;
+}
+
+static u32 FindFirstByte(u8 *A, u32 Count, u8 Value, b32 Equal)
+{
+    // NOTE: Finds the first byte that is (or, if Equal is false, isn't) Value. The search for equal bytes
+    // is just memchr, and the other one goes 8 bytes at a time like FindFirstDifference.
+    u32 Result = Count;
+    if(Equal)
+    {
+        u8 *Found = (u8 *)memchr(A, Value, Count);
+        if(Found)
+        {
+            Result = (u32)(Found - A);
+        }
+    }
+    else
+    {
+        u64 Pattern = 0x0101010101010101ull*Value;
+        Result = 0;
+        while((Result + 8) <= Count)
+        {
+            u64 Chunk;
+            memcpy(&Chunk, A + Result, sizeof(Chunk));
+            if(Chunk != Pattern)
+            {
+                break;
+            }
+            Result += 8;
+        }
+        
+        while((Result < Count) && (A[Result] == Value))
+        {
+            ++Result;
+        }
+    }
+    
+    return Result;
+}
+
+static u32 SkipStringElements(register_state_8086 *Registers, operation_type Op, string_operands *String, b32 RepWhileZero)
+{
+    // NOTE: Does as many of the iterations of a rep as possible in bulk on the host, and returns how
+    // many it did. That is every iteration for movs and stos, all but the last for lods (since only the last
+    // one's value stays in the register), and for cmps and scas, every one before the one that ends the rep.
+    // The rest are left to ExecStringStep, which also means cmps and scas get their flags from it. Anything
+    // that wraps, overlaps in a way memmove wouldn't reproduce, or just doesn't have a fast path here is
+    // left to it entirely.
+    u32 Count = Registers->cx;
+    u32 WWidth = String->WWidth;
+    s32 Delta = String->Delta;
+    u32 Bytes = Count*WWidth;
+    u8 *Memory = String->Dest.Memory;
+    
+    u32 SourceOffset = 0;
+    u32 SourceLow = 0;
+    u32 DestOffset = 0;
+    u32 DestLow = 0;
+    b32 Contiguous = ((!StringUsesSource(Op) || GetStringRange(String->Source, Registers->si, Count, Delta, &SourceOffset, &SourceLow)) &&
+                      (!StringUsesDest(Op) || GetStringRange(String->Dest, Registers->di, Count, Delta, &DestOffset, &DestLow)));
+    
+    u32 Result = 0;
+    // NOTE: If one range runs past the end of memory into the mirror, and the other is near the start
+    // of memory, the other one is moved up into the mirror too. That way the two overlap on the host exactly
+    // when they overlap in the 8086's memory, which the movs check below and memmove both depend on.
+    u32 MemorySize = GetHighestAddress(String->Dest) + 1;
+    if(((SourceLow + Bytes) > MemorySize) && (DestLow < Bytes))
+    {
+        DestLow += MemorySize;
+    }
+    else if(((DestLow + Bytes) > MemorySize) && (SourceLow < Bytes))
+    {
+        SourceLow += MemorySize;
+    }
+    
+    if(Contiguous && Count)
+    {
+        switch(Op)
+        {
+            case Op_movs:
+            {
+                // NOTE: Copying one element at a time only matches memmove if the copy never reads
+                // something it already wrote, which is when it moves away from the destination.
+                b32 Overlaps = ((DestLow < (SourceLow + Bytes)) && (SourceLow < (DestLow + Bytes)));
+                if(!Overlaps || ((Delta > 0) ? (DestLow <= SourceLow) : (DestLow >= SourceLow)))
+                {
+                    memmove(Memory + DestLow, Memory + SourceLow, Bytes);
+                    NoteWrites(String->Dest, (u16)DestOffset, Bytes);
+                    Result = Count;
+                }
+            } break;
+            
+            case Op_stos:
+            {
+                if((WWidth == 1) || (Registers->al == Registers->ah))
+                {
+                    memset(Memory + DestLow, Registers->al, Bytes);
+                }
+                else
+                {
+                    for(u32 Index = 0; Index < Bytes; Index += 2)
+                    {
+                        Memory[DestLow + Index + 0] = Registers->al;
+                        Memory[DestLow + Index + 1] = Registers->ah;
+                    }
+                }
+                NoteWrites(String->Dest, (u16)DestOffset, Bytes);
+                Result = Count;
+            } break;
+            
+            case Op_lods:
+            {
+                Result = Count - 1;
+            } break;
+            
+            case Op_cmps:
+            {
+                if((Delta > 0) && RepWhileZero)
+                {
+                    Result = FindFirstDifference(Memory + SourceLow, Memory + DestLow, Bytes) / WWidth;
+                }
+            } break;
+            
+            case Op_scas:
+            {
+                if((Delta > 0) && (WWidth == 1))
+                {
+                    Result = FindFirstByte(Memory + DestLow, Bytes, Registers->al, !RepWhileZero);
+                }
+            } break;
+            
+            default: {} break;
+        }
+        
+        // NOTE: If cmps or scas never found the element that ends the rep, the last one still has to
+        // be done by ExecStringStep to get the flags.
+        if(((Op == Op_cmps) || (Op == Op_scas)) && (Result == Count))
+        {
+            --Result;
+        }
+    }
+    
+    Registers->cx -= Result;
+    if(StringUsesSource(Op))
+    {
+        Registers->si += Result*Delta;
+    }
+    if(StringUsesDest(Op))
+    {
+        Registers->di += Result*Delta;
+    }
+    
+    return Result;
+}
+
+static u32 ExecString(segmented_access Memory, register_state_8086 *Registers, instruction Instruction, lazy_flags *Lazy)
+{
+    // NOTE: Returns how many times a rep went around, for the clock estimate (0 without a rep).
+    operation_type Op = Instruction.Op;
+    
+    string_operands String = {};
+    String.Source = DetermineSegmentAccess(Memory, Instruction, Registers, Registers->ds);
+    String.Dest = SegmentFromRegister(Memory, Registers->es);
+    String.WWidth = (Instruction.Flags & Inst_Wide) ? 2 : 1;
+    String.Delta = (Registers->flags & Flag_DF) ? -(s32)String.WWidth : (s32)String.WWidth;
+    
+    u32 Result = 0;
+    if(Instruction.Flags & Inst_Rep)
+    {
+        // NOTE: Inst_RepNE is really the prefix's Z bit, which is set for rep/repe/repz (f3) and clear
+        // for repne/repnz (f2). It only matters for cmps and scas.
+        b32 IsCompare = ((Op == Op_cmps) || (Op == Op_scas));
+        b32 RepWhileZero = ((Instruction.Flags & Inst_RepNE) != 0);
+        
+        Result = SkipStringElements(Registers, Op, &String, RepWhileZero);
+        while(Registers->cx)
+        {
+            u16 Compare = ExecStringStep(Registers, Op, &String, Lazy);
+            --Registers->cx;
+            ++Result;
+            
+            if(IsCompare && ((Compare == 0) != RepWhileZero))
+            {
+                break;
+            }
+        }
+    }
+    else
+    {
+        ExecStringStep(Registers, Op, &String, Lazy);
+    }
+    
+    return Result;
+}
+
+static b32 LeavesFlagsToLazy(operation_type Op)
+{
+    // NOTE: True for instructions that never look at the flags, and either leave them alone or replace all
+    // of the arithmetic flags at once, so any pending lazy flags don't have to be computed before running them.
+    b32 Result = false;
+    
+    switch(Op)
+    {
+        case Op_mov: case Op_push: case Op_pop: case Op_xchg: case Op_xlat: case Op_lea: case Op_lds: case Op_les:
+        case Op_in: case Op_out: case Op_cbw: case Op_cwd: case Op_not: case Op_call: case Op_jmp: case Op_ret: case Op_retf:
+        case Op_hlt: case Op_wait: case Op_esc: case Op_rep: case Op_lock: case Op_segment: case Op_None:
+        case Op_add: case Op_sub: case Op_cmp: case Op_inc: case Op_dec: case Op_neg: case Op_mul: case Op_imul: case Op_idiv:
+        case Op_and: case Op_test: case Op_or: case Op_xor:
+        {
+            Result = true;
+        } break;
+        
+        default: {} break;
+    }
+    
+    return Result;
+}
+
+static exec_result ExecInstruction(segmented_access Memory, register_state_8086 *Registers, instruction Instruction,
+                                   lazy_flags *Lazy)
 {
     exec_result Result = {};
     
+    if(!LeavesFlagsToLazy(Instruction.Op))
+    {
+        MaterializeFlags(Registers, Lazy);
+    }
+    
     u32 WWidth = (Instruction.Flags & Inst_Wide) ? 2 : 1;
     b32 IsFar = (Instruction.Flags & Inst_Far);
     
-    b32 CF = Registers->flags & Flag_CF;
-    b32 PF = Registers->flags & Flag_PF;
-    b32 AF = Registers->flags & Flag_AF;
-    b32 ZF = Registers->flags & Flag_ZF;
-    b32 SF = Registers->flags & Flag_SF;
-    b32 OF = Registers->flags & Flag_OF;
-    b32 IF = Registers->flags & Flag_IF;
-    b32 DF = Registers->flags & Flag_DF;
-    b32 TF = Registers->flags & Flag_TF;
-    
     segmented_access DefaultSegment = DetermineSegmentAccess(Memory, Instruction, Registers, Registers->ds);
     
     u32 IgnoredBytes = 0;
@@ -416,12 +899,7 @@ static exec_result ExecInstruction(segmented_access Memory, register_state_8086
         
         case Op_add:
         {
-            u32 SignBit = SignBitFor(WWidth);
-            u32 Mask = WidthMaskFor(WWidth);
-            u32 R = (V0 & Mask) + (V1 & Mask);
-            b32 OF = (~(V0 ^ V1) & (V0 ^ R)) & SignBit;
-            b32 AF = ((V0 & 0xf) + (V1 & 0xf)) & 0x10;
-            WriteArithOpResult(Registers, Op0, R, WWidth, OF, AF);
+            WriteN(Op0, 0, AddAndUpdateFlags(Registers, V0, V1, WWidth, Lazy), WWidth);
         } break;
         
         case Op_adc:
@@ -432,7 +910,7 @@ static exec_result ExecInstruction(segmented_access Memory, register_state_8086
         case Op_inc:
         {
             u32 R = V0 + 1;
-            WriteArithOpResult(Registers, Op0, R, WWidth);
+            WriteArithOpResult(Registers, Op0, R, WWidth, Lazy);
         } break;
         
         case Op_aaa:
@@ -447,12 +925,7 @@ static exec_result ExecInstruction(segmented_access Memory, register_state_8086
         
         case Op_sub:
         {
-            u32 SignBit = SignBitFor(WWidth);
-            u32 WidthMask = WidthMaskFor(WWidth);
-            u32 R = (V0 & WidthMask) - (V1 & WidthMask);
-            b32 OF = ((V0 ^ V1) & (V0 ^ R)) & SignBit;
-            b32 AF = ((V0 & 0xf) - (V1 & 0xf)) & 0x10;
-            WriteArithOpResult(Registers, Op0, R, WWidth, OF, AF);
+            WriteN(Op0, 0, SubAndUpdateFlags(Registers, V0, V1, WWidth, Lazy), WWidth);
         } break;
         
         case Op_sbb:
@@ -463,23 +936,18 @@ static exec_result ExecInstruction(segmented_access Memory, register_state_8086
         case Op_dec:
         {
             u32 R = V0 - 1;
-            WriteArithOpResult(Registers, Op0, R, WWidth);
+            WriteArithOpResult(Registers, Op0, R, WWidth, Lazy);
         } break;
         
         case Op_neg:
         {
             u32 R = -V0;
-            WriteArithOpResult(Registers, Op0, R, WWidth);
+            WriteArithOpResult(Registers, Op0, R, WWidth, Lazy);
         } break;
         
         case Op_cmp:
         {
-            u32 SignBit = SignBitFor(WWidth);
-            u32 WidthMask = WidthMaskFor(WWidth);
-            u32 R = (V0 & WidthMask) - (V1 & WidthMask);
-            b32 OF = ((V0 ^ V1) & (V0 ^ R)) & SignBit;
-            b32 AF = ((V0 & 0xf) - (V1 & 0xf)) & 0x10;
-            UpdateArithFlags(Registers, R, R & WidthMaskFor(WWidth), WWidth, OF, AF);
+            SubAndUpdateFlags(Registers, V0, V1, WWidth, Lazy);
         } break;
         
         case Op_aas:
@@ -495,7 +963,7 @@ static exec_result ExecInstruction(segmented_access Memory, register_state_8086
         case Op_mul:
         {
             u32 R = V0*V1;
-            WriteArithOpResult(Registers, Op0, R, WWidth);
+            WriteArithOpResult(Registers, Op0, R, WWidth, Lazy);
         } break;
         
         case Op_imul:
@@ -505,7 +973,7 @@ static exec_result ExecInstruction(segmented_access Memory, register_state_8086
             {
                 R = (s32)(s8)V0 * (s32)(s8)V1;
             }
-            WriteArithOpResult(Registers, Op0, R, WWidth);
+            WriteArithOpResult(Registers, Op0, R, WWidth, Lazy);
         } break;
         
         case Op_aam:
@@ -522,7 +990,7 @@ static exec_result ExecInstruction(segmented_access Memory, register_state_8086
             else
             {
                 u32 R = V0/V1;
-                WriteArithOpResult(Registers, Op0, R, WWidth);
+                WriteArithOpResult(Registers, Op0, R, WWidth, Lazy);
             }
         } break;
         
@@ -533,7 +1001,7 @@ static exec_result ExecInstruction(segmented_access Memory, register_state_8086
             {
                 R = (s32)(s8)V0 / (s32)(s8)V1;
             }
-            WriteArithOpResult(Registers, Op0, R, WWidth);
+            WriteArithOpResult(Registers, Op0, R, WWidth, Lazy);
         } break;
         
         case Op_aad:
@@ -597,22 +1065,22 @@ static exec_result ExecInstruction(segmented_access Memory, register_state_8086
         
         case Op_and:
         {
-            WriteLogOpResult(Registers, Op0, V0 & V1, WWidth);
+            WriteLogOpResult(Registers, Op0, V0 & V1, WWidth, Lazy);
         } break;
         
         case Op_test:
         {
-            UpdateLogFlags(Registers, V0 & V1, WWidth);
+            SetFlagsFrom(Registers, Lazy, LazyFlags_Log, WWidth, 0, 0, (u16)(V0 & V1));
         } break;
         
         case Op_or:
         {
-            WriteLogOpResult(Registers, Op0, V0 | V1, WWidth);
+            WriteLogOpResult(Registers, Op0, V0 | V1, WWidth, Lazy);
         } break;
         
         case Op_xor:
         {
-            WriteLogOpResult(Registers, Op0, V0 ^ V1, WWidth);
+            WriteLogOpResult(Registers, Op0, V0 ^ V1, WWidth, Lazy);
         } break;
         
         case Op_movs:
@@ -621,8 +1089,7 @@ static exec_result ExecInstruction(segmented_access Memory, register_state_8086
         case Op_lods:
         case Op_stos:
         {
-            Result.RepCount = Registers->cx;
-            Result.Unimplemented = true;
+            Result.RepCount = ExecString(Memory, Registers, Instruction, Lazy);
         } break;
         
         case Op_call:
@@ -662,103 +1129,27 @@ static exec_result ExecInstruction(segmented_access Memory, register_state_8086
         } break;
         
         case Op_je:
-        {
-            ConditionalJump(&Result, Registers, V0, ZF == 1);
-        } break;
-        
         case Op_jl:
-        {
-            ConditionalJump(&Result, Registers, V0, (SF ^ OF) == 1);
-        } break;
-        
         case Op_jle:
-        {
-            ConditionalJump(&Result, Registers, V0, ((SF ^ OF) | ZF) == 1);
-        } break;
-        
         case Op_jb:
-        {
-            ConditionalJump(&Result, Registers, V0, CF == 1);
-        } break;
-        
         case Op_jbe:
-        {
-            ConditionalJump(&Result, Registers, V0, (CF | ZF) == 1);
-        } break;
-        
         case Op_jp:
-        {
-            ConditionalJump(&Result, Registers, V0, PF == 1);
-        } break;
-        
         case Op_jo:
-        {
-            ConditionalJump(&Result, Registers, V0, OF == 1);
-        } break;
-        
         case Op_js:
-        {
-            ConditionalJump(&Result, Registers, V0, SF == 1);
-        } break;
-        
         case Op_jne:
-        {
-            ConditionalJump(&Result, Registers, V0, ZF == 0);
-        } break;
-        
         case Op_jnl:
-        {
-            ConditionalJump(&Result, Registers, V0, (SF ^ OF) == 0);
-        } break;
-        
         case Op_jg:
-        {
-            ConditionalJump(&Result, Registers, V0, ((SF & OF) | ZF) == 0);
-        } break;
-        
         case Op_jnb:
-        {
-            ConditionalJump(&Result, Registers, V0, CF == 0);
-        } break;
-        
         case Op_ja:
-        {
-            ConditionalJump(&Result, Registers, V0, (CF | ZF) == 0);
-        } break;
-        
         case Op_jnp:
-        {
-            ConditionalJump(&Result, Registers, V0, PF == 0);
-        } break;
-        
         case Op_jno:
-        {
-            ConditionalJump(&Result, Registers, V0, OF == 0);
-        } break;
-        
         case Op_jns:
-        {
-            ConditionalJump(&Result, Registers, V0, SF == 0);
-        } break;
-        
         case Op_loop:
-        {
-            ConditionalJump(&Result, Registers, V0, --Registers->cx != 0);
-        } break;
-        
         case Op_loopz:
-        {
-            ConditionalJump(&Result, Registers, V0, (--Registers->cx != 0) && (ZF == 1));
-        } break;
-        
         case Op_loopnz:
-        {
-            ConditionalJump(&Result, Registers, V0, (--Registers->cx != 0) && (ZF == 0));
-        } break;
-        
         case Op_jcxz:
         {
-            ConditionalJump(&Result, Registers, V0, Registers->cx != 0);
+            ConditionalJump(&Result, Registers, V0, EvaluateJumpCondition(Registers, Instruction.Op));
         } break;
         
         case Op_int:
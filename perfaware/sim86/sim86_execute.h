@@ -76,4 +76,29 @@ struct operand_access
     b32 AddressIsUnaligned;
 };
 
-static exec_result ExecInstruction(segmented_access Memory, register_state_8086 *Registers, instruction Instruction);
+enum lazy_flags_op
+{
+    LazyFlags_None,
+    LazyFlags_Add,
+    LazyFlags_Sub, // NOTE: sub and cmp
+    LazyFlags_Arith, // NOTE: Everything else that goes through UpdateArithFlags (inc, dec, neg, mul, div, ...), which clears OF and AF
+    LazyFlags_Log,
+};
+
+struct lazy_flags
+{
+    // NOTE: The last operation that set the arithmetic flags, if they haven't been computed yet. R is the
+    // unmasked result, except for LazyFlags_Log, where it is exactly what gets passed to UpdateLogFlags.
+    lazy_flags_op Op;
+    u32 WWidth;
+    u32 V0;
+    u32 V1;
+    u32 R;
+};
+
+/* NOTE: If Lazy is passed, instructions that replace all of the arithmetic flags just record themselves in it,
+   and the flags are only computed when something needs them. Anything outside ExecInstruction that looks at
+   Registers->flags has to call MaterializeFlags first. If Lazy is 0, the flags are always computed right away. */
+static exec_result ExecInstruction(segmented_access Memory, register_state_8086 *Registers, instruction Instruction,
+                                   lazy_flags *Lazy = 0);
+static void MaterializeFlags(register_state_8086 *Registers, lazy_flags *Lazy);
@@ -82,3 +82,155 @@ static instruction_operand ImmediateOperand(u32 Value, u32 Flags = 0)
     
     return Result;
 }
+
+static_assert(sizeof(packed_instruction) == 16, "packed_instruction is supposed to be exactly 16 bytes");
+
+static b32 PackOperand(instruction_operand Operand, u32 *Payload, u32 *Info)
+{
+    b32 Result = true;
+    
+    *Payload = 0;
+    *Info = Operand.Type;
+    
+    switch(Operand.Type)
+    {
+        case Operand_None:
+        {
+        } break;
+        
+        case Operand_Register:
+        {
+            register_access Reg = Operand.Register;
+            Result = ((Reg.Index <= 0xff) && (Reg.Offset <= 0xff) && (Reg.Count <= 0xff));
+            *Payload = Reg.Index | (Reg.Offset << 8) | (Reg.Count << 16);
+        } break;
+        
+        case Operand_Memory:
+        {
+            effective_address_expression Address = Operand.Address;
+            effective_address_term T0 = Address.Terms[0];
+            effective_address_term T1 = Address.Terms[1];
+            if(Address.Flags == Address_ExplicitSegment)
+            {
+                Result = ((Address.ExplicitSegment <= 0xffff) &&
+                          (Address.Displacement >= 0) && (Address.Displacement <= 0xffff) &&
+                          !T0.Register.Index && !T0.Register.Offset && !T0.Register.Count && !T0.Scale &&
+                          !T1.Register.Index && !T1.Register.Offset && !T1.Register.Count && !T1.Scale);
+                *Payload = (u32)Address.Displacement | (Address.ExplicitSegment << 16);
+                *Info |= PackedOperand_Flag;
+            }
+            else
+            {
+                // NOTE: This is the only form of effective address the 8086 decoder produces
+                Result = ((Address.Flags == 0) && (Address.ExplicitSegment == 0) &&
+                          (Address.Displacement >= -32768) && (Address.Displacement <= 32767) &&
+                          (T0.Register.Index <= 0xf) && (T0.Register.Offset == 0) && (T0.Register.Count == 2) && (T0.Scale == 1) &&
+                          (T1.Register.Index <= 0xf) && (T1.Register.Offset == 0) && (T1.Register.Count == 2) && (T1.Scale == 1));
+                *Payload = T0.Register.Index | (T1.Register.Index << 4) | ((u32)(u16)Address.Displacement << 16);
+            }
+        } break;
+        
+        case Operand_Immediate:
+        {
+            immediate Immediate = Operand.Immediate;
+            Result = ((Immediate.Flags & ~Immediate_RelativeJumpDisplacement) == 0);
+            *Payload = (u32)Immediate.Value;
+            *Info |= (Immediate.Flags & Immediate_RelativeJumpDisplacement) ? PackedOperand_Flag : 0;
+        } break;
+        
+        default:
+        {
+            Result = false;
+        } break;
+    }
+    
+    return Result;
+}
+
+static instruction_operand UnpackOperand(u32 Payload, u32 Info)
+{
+    instruction_operand Result = {};
+    
+    switch(Info & PackedOperand_TypeMask)
+    {
+        case Operand_Register:
+        {
+            Result = RegisterOperand(Payload & 0xff, (Payload >> 16) & 0xff);
+            Result.Register.Offset = (Payload >> 8) & 0xff;
+        } break;
+        
+        case Operand_Memory:
+        {
+            if(Info & PackedOperand_Flag)
+            {
+                Result = IntersegmentAddressOperand(Payload >> 16, Payload & 0xffff);
+            }
+            else
+            {
+                Result = EffectiveAddressOperand(RegisterAccess(Payload & 0xf, 0, 2), RegisterAccess((Payload >> 4) & 0xf, 0, 2),
+                                                 (s16)(Payload >> 16));
+            }
+        } break;
+        
+        case Operand_Immediate:
+        {
+            Result = ImmediateOperand(Payload, (Info & PackedOperand_Flag) ? Immediate_RelativeJumpDisplacement : 0);
+        } break;
+    }
+    
+    return Result;
+}
+
+static b32 PackInstruction(instruction Instruction, packed_instruction *Dest)
+{
+    packed_instruction Packed = {};
+    
+    b32 Result = ((Instruction.Op <= 0xff) &&
+                  (Instruction.Flags <= 0xff) &&
+                  (Instruction.Size <= 0xf) &&
+                  (Instruction.SegmentOverride <= 0xf));
+    
+    Packed.Address = Instruction.Address;
+    Packed.Op = (u8)Instruction.Op;
+    Packed.Flags = (u8)Instruction.Flags;
+    Packed.SizeAndSegmentOverride = (u8)(Instruction.Size | (Instruction.SegmentOverride << 4));
+    
+    for(u32 OperandIndex = 0; Result && (OperandIndex < ArrayCount(Instruction.Operands)); ++OperandIndex)
+    {
+        u32 Info = 0;
+        Result = PackOperand(Instruction.Operands[OperandIndex], &Packed.Operands[OperandIndex], &Info);
+        Packed.OperandInfo |= (u8)(Info << (4*OperandIndex));
+    }
+    
+    if(Result)
+    {
+        *Dest = Packed;
+    }
+    
+    return Result;
+}
+
+static u32 GetPackedSize(packed_instruction Packed)
+{
+    u32 Result = Packed.SizeAndSegmentOverride & 0xf;
+    return Result;
+}
+
+static instruction UnpackInstruction(packed_instruction Packed)
+{
+    instruction Result = {};
+    
+    Result.Address = Packed.Address;
+    Result.Size = GetPackedSize(Packed);
+    Result.Op = (operation_type)Packed.Op;
+    Result.Flags = Packed.Flags;
+    Result.SegmentOverride = Packed.SizeAndSegmentOverride >> 4;
+    
+    for(u32 OperandIndex = 0; OperandIndex < ArrayCount(Result.Operands); ++OperandIndex)
+    {
+        u32 Info = (Packed.OperandInfo >> (4*OperandIndex)) & 0xf;
+        Result.Operands[OperandIndex] = UnpackOperand(Packed.Operands[OperandIndex], Info);
+    }
+    
+    return Result;
+}
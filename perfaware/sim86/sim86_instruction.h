@@ -20,6 +20,7 @@ typedef struct effective_address_expression effective_address_expression;
 typedef struct immediate immediate;
 typedef struct instruction_operand instruction_operand;
 typedef struct instruction instruction;
+typedef struct packed_instruction packed_instruction;
 
 typedef enum operation_type : u32
 {
@@ -107,3 +108,28 @@ struct instruction
     
     register_index SegmentOverride;
 };
+
+enum packed_operand_flag
+{
+    PackedOperand_TypeMask = 0x3,
+    PackedOperand_Flag = 0x4, // NOTE: Immediate_RelativeJumpDisplacement for immediates, Address_ExplicitSegment for memory
+};
+struct packed_instruction
+{
+    /* NOTE: This is a lossless 16-byte version of "instruction", for when large numbers of them
+       need to be stored. Every instruction the decoder produces can be packed, and unpacking produces
+       exactly the same bytes as the original. Each operand payload is:
+       
+       Register: Index | (Offset << 8) | (Count << 16)
+       Memory: Term0 index | (Term1 index << 4) | (16-bit displacement << 16), or for explicit segments,
+               (16-bit displacement) | (segment << 16)
+       Immediate: Value
+    */
+    
+    u32 Address;
+    u8 Op;
+    u8 Flags;
+    u8 SizeAndSegmentOverride; // NOTE: Size in the low 4 bits, SegmentOverride in the high 4 bits
+    u8 OperandInfo; // NOTE: 4 bits of packed_operand_flag per operand, operand 0 in the low bits
+    u32 Operands[2];
+};
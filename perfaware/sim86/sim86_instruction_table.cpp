@@ -15,6 +15,13 @@ static instruction_encoding InstructionTable8086[] =
 #include "sim86_instruction_table.inl"
 };
 
+// NOTE: The same table again, but usable at compile time, so the decoder can
+// generate a specialized decode routine for every entry.
+static constexpr instruction_encoding ConstInstructionTable8086[] =
+{
+#include "sim86_instruction_table.inl"
+};
+
 static instruction_table Get8086InstructionTable()
 {
     instruction_table Result = {};
@@ -25,3 +32,7 @@ static instruction_table Get8086InstructionTable()
     
     return Result;
 }
+
+// NOTE: The dispatch is derived entirely from the table, and is built by its static initializer, before main
+// runs (or before the shared library finishes loading). So it is there before any thread can decode.
+static instruction_dispatch InstructionDispatch8086 = BuildInstructionDispatch(Get8086InstructionTable());
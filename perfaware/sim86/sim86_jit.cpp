@@ -0,0 +1,573 @@
+/* NOTE: This translates hot threaded blocks (see sim86_threaded.cpp) into x86-64 code. Only some of the
+   ops that the threaded engine gave specialized handlers can be translated - register and immediate moves
+   and arithmetic, and the conditional jumps - so a block is compiled up to its first op that isn't one of those,
+   and the rest of it keeps running through its handlers (which for most instructions means ExecInstruction).
+
+   While compiled code runs, the 8086's general registers live in the host registers with the same encoding
+   (so the 8-bit registers work too), except sp, which lives in r8w, since rsp is the host's stack. The 8086
+   flags are kept in r11d, and r10 points at the register_state_8086. The arithmetic itself is done with the
+   host's own add/sub/cmp, whose flags come out exactly the way UpdateArithFlags computes them, and they are
+   merged into r11d after each op. inc and dec are done as add/sub of 1 and then have OF and AF cleared,
+   because that is what ExecInstruction does for them.
+
+   If the last compiled op is a jump back to the start of the block, the generated code loops by itself
+   without returning, so tight loops never leave the generated code until they are done. */
+
+#if SIM86_JIT_SUPPORTED
+
+#define JIT_HOST_R8 8
+
+// NOTE: The host registers used for each 8086 register, indexed by register_index.
+static u8 JITHostRegister16[] = {0xff, 0, 3, 1, 2, JIT_HOST_R8, 5, 6, 7};
+static u8 JITHostRegister8[] = {0xff, 0, 3, 1, 2};
+
+// NOTE: OF, SF, ZF, AF, PF and CF are in the same bits of the 8086 flags and the host's RFLAGS.
+#define JIT_ARITH_FLAGS (Flag_OF | Flag_SF | Flag_ZF | Flag_AF | Flag_PF | Flag_CF)
+#define JIT_INC_DEC_FLAGS (Flag_SF | Flag_ZF | Flag_PF | Flag_CF)
+
+struct jit_emitter
+{
+    u8 *At;
+    u8 *End;
+    b32 Overflowed;
+};
+
+struct jit_condition
+{
+    b32 Never;
+    b32 DecrementCX; // NOTE: loop, loopz and loopnz decrement cx and are not taken if it hits 0
+    b32 NeedCX; // NOTE: Not taken if cx is 0 (this is jcxz, as ExecInstruction implements it)
+    u32 Mask;
+    u32 Expect;
+};
+
+static void EmitU8(jit_emitter *Emitter, u32 Value)
+{
+    if(Emitter->At < Emitter->End)
+    {
+        *Emitter->At++ = (u8)Value;
+    }
+    else
+    {
+        Emitter->Overflowed = true;
+    }
+}
+
+static void EmitU16(jit_emitter *Emitter, u32 Value)
+{
+    EmitU8(Emitter, Value);
+    EmitU8(Emitter, Value >> 8);
+}
+
+static void EmitU32(jit_emitter *Emitter, u32 Value)
+{
+    EmitU16(Emitter, Value);
+    EmitU16(Emitter, Value >> 16);
+}
+
+static u8 *EmitJump(jit_emitter *Emitter, u32 Opcode)
+{
+    // NOTE: Opcode is either 0xe9 (jmp) or the second byte of a two-byte jcc. Returns where the rel32 goes.
+    if(Opcode != 0xe9)
+    {
+        EmitU8(Emitter, 0x0f);
+    }
+    EmitU8(Emitter, Opcode);
+    
+    u8 *Result = Emitter->At;
+    EmitU32(Emitter, 0);
+    return Result;
+}
+
+static void PatchJump(jit_emitter *Emitter, u8 *Rel32, u8 *Target)
+{
+    if(!Emitter->Overflowed)
+    {
+        s32 Displacement = (s32)(Target - (Rel32 + 4));
+        memcpy(Rel32, &Displacement, sizeof(Displacement));
+    }
+}
+
+static u8 GetHostRegister(register_access Access)
+{
+    u8 Result = (Access.Count == 2) ? JITHostRegister16[Access.Index] : (JITHostRegister8[Access.Index] + 4*Access.Offset);
+    return Result;
+}
+
+static void EmitPrefixes(jit_emitter *Emitter, b32 Wide, u32 RegField, u32 RMField)
+{
+    if(Wide)
+    {
+        EmitU8(Emitter, 0x66);
+    }
+    
+    u32 REX = 0x40 | ((RegField & 8) ? 0x4 : 0) | ((RMField & 8) ? 0x1 : 0);
+    if(REX != 0x40)
+    {
+        EmitU8(Emitter, REX);
+    }
+}
+
+static void EmitRegisterOp(jit_emitter *Emitter, u32 Opcode8, b32 Wide, u32 Dest, u32 Source)
+{
+    // NOTE: The "op r/m, reg" forms, where the 16-bit opcode is always the 8-bit one plus 1.
+    EmitPrefixes(Emitter, Wide, Source, Dest);
+    EmitU8(Emitter, Wide ? (Opcode8 + 1) : Opcode8);
+    EmitU8(Emitter, 0xc0 | ((Source & 7) << 3) | (Dest & 7));
+}
+
+static void EmitImmediateOp(jit_emitter *Emitter, u32 Digit, b32 Wide, u32 Dest, u32 Immediate)
+{
+    EmitPrefixes(Emitter, Wide, 0, Dest);
+    EmitU8(Emitter, Wide ? 0x81 : 0x80);
+    EmitU8(Emitter, 0xc0 | (Digit << 3) | (Dest & 7));
+    if(Wide)
+    {
+        EmitU16(Emitter, Immediate);
+    }
+    else
+    {
+        EmitU8(Emitter, Immediate);
+    }
+}
+
+static void EmitMovImmediate(jit_emitter *Emitter, b32 Wide, u32 Dest, u32 Immediate)
+{
+    EmitPrefixes(Emitter, Wide, 0, Dest);
+    if(Wide)
+    {
+        EmitU8(Emitter, 0xb8 + (Dest & 7));
+        EmitU16(Emitter, Immediate);
+    }
+    else
+    {
+        EmitU8(Emitter, 0xb0 + (Dest & 7));
+        EmitU8(Emitter, Immediate);
+    }
+}
+
+static void EmitRegisterMemory(jit_emitter *Emitter, u32 Opcode, u32 HostRegister, u32 RegisterIndex)
+{
+    // NOTE: Opcode 0x8b loads the 16-bit host register from [r10 + offset of the 8086 register], 0x89 stores it.
+    EmitPrefixes(Emitter, true, HostRegister, 8 + 2);
+    EmitU8(Emitter, Opcode);
+    EmitU8(Emitter, 0x40 | ((HostRegister & 7) << 3) | 2);
+    EmitU8(Emitter, 2*RegisterIndex);
+}
+
+static void EmitSetIP(jit_emitter *Emitter, u16 IP)
+{
+    // NOTE: mov word [r10 + ip], IP
+    EmitU8(Emitter, 0x66);
+    EmitU8(Emitter, 0x41);
+    EmitU8(Emitter, 0xc7);
+    EmitU8(Emitter, 0x42);
+    EmitU8(Emitter, 2*Register_ip);
+    EmitU16(Emitter, IP);
+}
+
+static void EmitCaptureFlags(jit_emitter *Emitter, u32 Keep)
+{
+    EmitU8(Emitter, 0x9c); // NOTE: pushfq
+    EmitU8(Emitter, 0x41); EmitU8(Emitter, 0x59); // NOTE: pop r9
+    EmitU8(Emitter, 0x41); EmitU8(Emitter, 0x81); EmitU8(Emitter, 0xe1); EmitU32(Emitter, Keep); // NOTE: and r9d, Keep
+    EmitU8(Emitter, 0x41); EmitU8(Emitter, 0x81); EmitU8(Emitter, 0xe3); EmitU32(Emitter, ~JIT_ARITH_FLAGS); // NOTE: and r11d, ~JIT_ARITH_FLAGS
+    EmitU8(Emitter, 0x45); EmitU8(Emitter, 0x09); EmitU8(Emitter, 0xcb); // NOTE: or r11d, r9d
+}
+
+static void EmitAddClocks(jit_emitter *Emitter, u32 ClocksOffset, instruction_clock_interval Clocks)
+{
+    // NOTE: add dword [r10 + ClocksOffset], Clocks (for both Min and Max)
+    u32 Values[2] = {Clocks.Min, Clocks.Max};
+    for(u32 Index = 0; Index < ArrayCount(Values); ++Index)
+    {
+        if(Values[Index])
+        {
+            EmitU8(Emitter, 0x41);
+            EmitU8(Emitter, 0x81);
+            EmitU8(Emitter, 0x82);
+            EmitU32(Emitter, ClocksOffset + 4*Index);
+            EmitU32(Emitter, Values[Index]);
+        }
+    }
+}
+
+static void EmitAddInstructionCount(jit_emitter *Emitter, u32 CountOffset, u32 Count)
+{
+    // NOTE: add qword [r10 + CountOffset], Count
+    EmitU8(Emitter, 0x49);
+    EmitU8(Emitter, 0x81);
+    EmitU8(Emitter, 0x82);
+    EmitU32(Emitter, CountOffset);
+    EmitU32(Emitter, Count);
+}
+
+static jit_condition GetJITCondition(operation_type Op)
+{
+    // NOTE: These have to take exactly the same branches as EvaluateJumpCondition. Since it compares
+    // the flag bits themselves (not 0 or 1) against 1, the conditions that test a flag being set only work
+    // for CF, which is bit 0. All of the others are never taken.
+    jit_condition Result = {};
+    
+    switch(Op)
+    {
+        case Op_je: case Op_jl: case Op_jle: case Op_jp: case Op_jo: case Op_js:
+        {
+            Result.Never = true;
+        } break;
+        
+        case Op_jb: {Result.Mask = Flag_CF; Result.Expect = Flag_CF;} break;
+        case Op_jbe: {Result.Mask = Flag_CF|Flag_ZF; Result.Expect = Flag_CF;} break;
+        case Op_jne: {Result.Mask = Flag_ZF;} break;
+        case Op_jnl: {Result.Mask = Flag_SF|Flag_OF;} break;
+        case Op_jg: {Result.Mask = Flag_ZF;} break;
+        case Op_jnb: {Result.Mask = Flag_CF;} break;
+        case Op_ja: {Result.Mask = Flag_CF|Flag_ZF;} break;
+        case Op_jnp: {Result.Mask = Flag_PF;} break;
+        case Op_jno: {Result.Mask = Flag_OF;} break;
+        case Op_jns: {Result.Mask = Flag_SF;} break;
+        
+        case Op_loop: {Result.DecrementCX = true;} break;
+        case Op_loopz: {Result.DecrementCX = true; Result.Never = true;} break;
+        case Op_loopnz: {Result.DecrementCX = true; Result.Mask = Flag_ZF;} break;
+        case Op_jcxz: {Result.NeedCX = true;} break;
+        
+        default: {} break;
+    }
+    
+    return Result;
+}
+
+static b32 IsCompilable(threaded_op *Op)
+{
+    // NOTE: Memory forms and the logical ops have specialized handlers too, but the JIT only does
+    // register and immediate operands, and not the logical ops, since the host leaves AF undefined for them.
+    b32 Result = false;
+    if((Op->Handler != ThreadedGeneric) &&
+       (Op->Handler != ThreadedStopOnRet) &&
+       (Op->Handler != ThreadedExit))
+    {
+        instruction Instruction = UnpackInstruction(Op->Instruction);
+        operand_type SourceType = Instruction.Operands[1].Type;
+        switch(Instruction.Op)
+        {
+            case Op_mov: case Op_add: case Op_sub: case Op_cmp:
+            {
+                Result = ((Instruction.Operands[0].Type == Operand_Register) && (SourceType != Operand_Memory));
+            } break;
+            
+            case Op_inc: case Op_dec:
+            {
+                Result = (Instruction.Operands[0].Type == Operand_Register);
+            } break;
+            
+            default:
+            {
+                Result = (GetControlFlow(Instruction.Op) == Flow_Conditional);
+            } break;
+        }
+    }
+    return Result;
+}
+
+static void EmitJITOp(jit_emitter *Emitter, instruction Instruction, threaded_op *Op)
+{
+    b32 Wide = (Instruction.Flags & Inst_Wide);
+    u32 Dest = GetHostRegister(Instruction.Operands[0].Register);
+    instruction_operand Source = Instruction.Operands[1];
+    b32 FromImmediate = (Source.Type == Operand_Immediate);
+    u32 SourceRegister = FromImmediate ? 0 : GetHostRegister(Source.Register);
+    
+    switch(Instruction.Op)
+    {
+        case Op_mov:
+        {
+            if(FromImmediate)
+            {
+                EmitMovImmediate(Emitter, Wide, Dest, Op->Immediate);
+            }
+            else
+            {
+                EmitRegisterOp(Emitter, 0x88, Wide, Dest, SourceRegister);
+            }
+        } break;
+        
+        case Op_add:
+        case Op_sub:
+        case Op_cmp:
+        {
+            u32 Opcode8 = (Instruction.Op == Op_add) ? 0x00 : (Instruction.Op == Op_sub) ? 0x28 : 0x38;
+            if(FromImmediate)
+            {
+                EmitImmediateOp(Emitter, Opcode8 >> 3, Wide, Dest, Op->Immediate);
+            }
+            else
+            {
+                EmitRegisterOp(Emitter, Opcode8, Wide, Dest, SourceRegister);
+            }
+            EmitCaptureFlags(Emitter, JIT_ARITH_FLAGS);
+        } break;
+        
+        case Op_inc:
+        case Op_dec:
+        {
+            EmitImmediateOp(Emitter, (Instruction.Op == Op_inc) ? 0 : 5, Wide, Dest, 1);
+            EmitCaptureFlags(Emitter, JIT_INC_DEC_FLAGS);
+        } break;
+        
+        default:
+        {
+            assert(!"Op has a specialized handler the JIT doesn't know about");
+        } break;
+    }
+}
+
+static b32 CompileJITBlock(threaded_machine *Machine, threaded_block *Block)
+{
+    u32 OpCount = 0;
+    while((OpCount < Block->OpCount) && IsCompilable(Block->Ops + OpCount))
+    {
+        ++OpCount;
+    }
+    
+    jit_code *Code = &Machine->Code;
+    jit_emitter Emitter = {Code->Memory + Code->Used, Code->Memory + Code->Size};
+    jit_emitter *E = &Emitter;
+    u8 *Start = E->At;
+    u32 ClocksOffset = (u32)((u8 *)&Machine->Clocks - (u8 *)&Machine->Registers);
+    u32 CountOffset = (u32)((u8 *)&Machine->InstructionCount - (u8 *)&Machine->Registers);
+    
+    if(OpCount)
+    {
+        // NOTE: Save the callee-saved registers that get used (rsi and rdi are callee-saved on
+        // Windows), and move the argument to r10.
+        EmitU8(E, 0x53); EmitU8(E, 0x55); EmitU8(E, 0x56); EmitU8(E, 0x57);
+#if _WIN32
+        EmitU8(E, 0x49); EmitU8(E, 0x89); EmitU8(E, 0xca); // NOTE: mov r10, rcx
+#else
+        EmitU8(E, 0x49); EmitU8(E, 0x89); EmitU8(E, 0xfa); // NOTE: mov r10, rdi
+#endif
+        
+        for(u32 Index = Register_a; Index <= Register_di; ++Index)
+        {
+            EmitRegisterMemory(E, 0x8b, JITHostRegister16[Index], Index);
+        }
+        EmitU8(E, 0x45); EmitU8(E, 0x0f); EmitU8(E, 0xb7); EmitU8(E, 0x5a); EmitU8(E, 2*Register_flags); // NOTE: movzx r11d, word [r10 + flags]
+        
+        u8 *Top = E->At;
+        instruction_clock_interval StraightClocks = {};
+        threaded_op *Last = Block->Ops + OpCount - 1;
+        instruction LastInstruction = UnpackInstruction(Last->Instruction);
+        b32 EndsInJump = (GetControlFlow(LastInstruction.Op) == Flow_Conditional);
+        
+        for(u32 OpIndex = 0; OpIndex < (EndsInJump ? (OpCount - 1) : OpCount); ++OpIndex)
+        {
+            threaded_op *Op = Block->Ops + OpIndex;
+            EmitJITOp(E, UnpackInstruction(Op->Instruction), Op);
+            StraightClocks.Min += Op->Clocks[0].Min;
+            StraightClocks.Max += Op->Clocks[0].Max;
+        }
+        EmitAddClocks(E, ClocksOffset, StraightClocks);
+        EmitAddInstructionCount(E, CountOffset, OpCount); // NOTE: The jump, if there is one, runs every time too
+        
+        u8 *ExitPatch = 0;
+        if(EndsInJump)
+        {
+            jit_condition Condition = GetJITCondition(LastInstruction.Op);
+            u8 *NotTakenPatches[2] = {};
+            u32 NotTakenCount = 0;
+            
+            if(Condition.DecrementCX)
+            {
+                EmitU8(E, 0x66); EmitU8(E, 0xff); EmitU8(E, 0xc9); // NOTE: dec cx
+                NotTakenPatches[NotTakenCount++] = EmitJump(E, 0x84); // NOTE: jz
+            }
+            
+            if(Condition.NeedCX)
+            {
+                EmitU8(E, 0x66); EmitU8(E, 0x85); EmitU8(E, 0xc9); // NOTE: test cx, cx
+                NotTakenPatches[NotTakenCount++] = EmitJump(E, 0x84); // NOTE: jz
+            }
+            
+            if(Condition.Never)
+            {
+                NotTakenPatches[NotTakenCount++] = EmitJump(E, 0xe9);
+            }
+            else if(Condition.Mask)
+            {
+                EmitU8(E, 0x45); EmitU8(E, 0x89); EmitU8(E, 0xd9); // NOTE: mov r9d, r11d
+                EmitU8(E, 0x41); EmitU8(E, 0x81); EmitU8(E, 0xe1); EmitU32(E, Condition.Mask); // NOTE: and r9d, Mask
+                EmitU8(E, 0x41); EmitU8(E, 0x81); EmitU8(E, 0xf9); EmitU32(E, Condition.Expect); // NOTE: cmp r9d, Expect
+                NotTakenPatches[NotTakenCount++] = EmitJump(E, 0x85); // NOTE: jne
+            }
+            
+            // NOTE: Taken
+            u16 Target = (u16)(Last->NextIP + (s8)Last->Immediate);
+            EmitAddClocks(E, ClocksOffset, Last->Clocks[1]);
+            if(Target == Block->IP)
+            {
+                PatchJump(E, EmitJump(E, 0xe9), Top);
+            }
+            else
+            {
+                EmitSetIP(E, Target);
+                ExitPatch = EmitJump(E, 0xe9);
+            }
+            
+            // NOTE: Not taken
+            for(u32 PatchIndex = 0; PatchIndex < NotTakenCount; ++PatchIndex)
+            {
+                PatchJump(E, NotTakenPatches[PatchIndex], E->At);
+            }
+            EmitAddClocks(E, ClocksOffset, Last->Clocks[0]);
+        }
+        EmitSetIP(E, Last->NextIP);
+        
+        if(ExitPatch)
+        {
+            PatchJump(E, ExitPatch, E->At);
+        }
+        
+        for(u32 Index = Register_a; Index <= Register_di; ++Index)
+        {
+            EmitRegisterMemory(E, 0x89, JITHostRegister16[Index], Index);
+        }
+        EmitU8(E, 0x66); EmitU8(E, 0x45); EmitU8(E, 0x89); EmitU8(E, 0x5a); EmitU8(E, 2*Register_flags); // NOTE: mov [r10 + flags], r11w
+        
+        EmitU8(E, 0x5f); EmitU8(E, 0x5e); EmitU8(E, 0x5d); EmitU8(E, 0x5b);
+        EmitU8(E, 0xc3);
+    }
+    
+    b32 Result = (OpCount && !E->Overflowed);
+    if(Result)
+    {
+        Code->Used += (u32)(E->At - Start);
+        Block->Compiled = (jit_block_function *)Start;
+        Block->CompiledOpCount = OpCount;
+    }
+    
+    return Result;
+}
+
+static void RunCompiledOpsThreaded(threaded_machine *Machine, threaded_block *Block)
+{
+    // NOTE: This does what the compiled code for a block is supposed to do, using the handlers: run
+    // the compiled ops, and go around again for as long as the last one jumps back to the start of the block.
+    threaded_op *End = Block->Ops + Block->CompiledOpCount;
+    for(;;)
+    {
+        threaded_op *Op = Block->Ops;
+        while(Op && (Op < End))
+        {
+            Op = Op->Handler(Machine, Op);
+        }
+        
+        if(Op || (Machine->Registers.ip != Block->IP))
+        {
+            break;
+        }
+    }
+}
+
+static void VerifyJITBlock(threaded_machine *Machine, threaded_block *Block)
+{
+    // NOTE: Both ways of running the block start from materialized flags, and the threaded one has to
+    // finish with them materialized too, or the comparison would be meaningless.
+    register_state_8086 StartRegisters = Machine->Registers;
+    instruction_clock_interval StartClocks = Machine->Clocks;
+    u64 StartInstructionCount = Machine->InstructionCount;
+    
+    Block->Compiled(&Machine->Registers);
+    register_state_8086 JITRegisters = Machine->Registers;
+    instruction_clock_interval JITClocks = Machine->Clocks;
+    u64 JITInstructionCount = Machine->InstructionCount;
+    
+    Machine->Registers = StartRegisters;
+    Machine->Clocks = StartClocks;
+    Machine->InstructionCount = StartInstructionCount;
+    RunCompiledOpsThreaded(Machine, Block);
+    MaterializeFlags(&Machine->Registers, Machine->Lazy);
+    
+    if((memcmp(&JITRegisters, &Machine->Registers, sizeof(JITRegisters)) != 0) ||
+       (JITClocks.Min != Machine->Clocks.Min) || (JITClocks.Max != Machine->Clocks.Max) ||
+       (JITInstructionCount != Machine->InstructionCount))
+    {
+        // NOTE: The threaded result is the one that's kept, and the block isn't run compiled again.
+        fprintf(stderr, "ERROR: JIT block at %04x:%04x does not match the threaded engine. Threaded -> JIT:",
+                Block->CS, Block->IP);
+        PrintRegisterDifference(&Machine->Registers, &JITRegisters, stderr);
+        fprintf(stderr, " clocks:[%u,%u]->[%u,%u] instructions:%llu->%llu\n", Machine->Clocks.Min, Machine->Clocks.Max,
+                JITClocks.Min, JITClocks.Max, (unsigned long long)Machine->InstructionCount, (unsigned long long)JITInstructionCount);
+        Block->Compiled = 0;
+        Block->CompiledOpCount = 0;
+    }
+}
+
+static b32 EnableJIT(threaded_machine *Machine)
+{
+    jit_code *Code = &Machine->Code;
+    if(!Code->Memory)
+    {
+        Code->Memory = AllocateExecutableMemory(JIT_CODE_SIZE);
+        Code->Size = Code->Memory ? JIT_CODE_SIZE : 0;
+        Code->Used = 0;
+    }
+    
+    b32 Result = (Code->Memory != 0);
+    return Result;
+}
+
+static void RunJIT(threaded_machine *Machine, b32 Verify)
+{
+    // NOTE: When verifying, blocks are compiled the first time they run, so that as much code as
+    // possible gets checked.
+    u32 Threshold = Verify ? 1 : JIT_THRESHOLD;
+    while(!Machine->Stop)
+    {
+        threaded_block *Block = GetThreadedBlock(Machine);
+        if(Block)
+        {
+            if(Machine->Code.Memory && !Block->Compiled && (++Block->ExecCount == Threshold))
+            {
+                CompileJITBlock(Machine, Block);
+            }
+            
+            threaded_op *Op = Block->Ops;
+            if(Block->Compiled)
+            {
+                // NOTE: Compiled code works on the real flags register.
+                MaterializeFlags(&Machine->Registers, Machine->Lazy);
+                Op = Block->Ops + Block->CompiledOpCount;
+                if(Verify)
+                {
+                    VerifyJITBlock(Machine, Block);
+                }
+                else
+                {
+                    Block->Compiled(&Machine->Registers);
+                }
+            }
+            
+            while(Op)
+            {
+                Op = Op->Handler(Machine, Op);
+            }
+        }
+    }
+    
+    MaterializeFlags(&Machine->Registers, Machine->Lazy);
+}
+
+#else
+
+static b32 EnableJIT(threaded_machine *Machine)
+{
+    return false;
+}
+
+static void RunJIT(threaded_machine *Machine, b32 Verify)
+{
+    RunThreaded(Machine);
+}
+
+#endif
@@ -0,0 +1,26 @@
+// NOTE: The JIT only generates x86-64 code. On any other host, -jit runs the threaded engine instead.
+#if defined(__x86_64__) || defined(_M_X64)
+#define SIM86_JIT_SUPPORTED 1
+#else
+#define SIM86_JIT_SUPPORTED 0
+#endif
+
+// NOTE: A block is translated once it has been run this many times.
+#define JIT_THRESHOLD 16
+#define JIT_CODE_SIZE (4*1024*1024)
+
+// NOTE: Generated code takes a pointer to the registers of the threaded_machine it was compiled for.
+typedef void jit_block_function(register_state_8086 *Registers);
+
+struct jit_code
+{
+    u8 *Memory; // NOTE: 0 unless the JIT is enabled
+    u32 Size;
+    u32 Used;
+};
+
+struct threaded_machine;
+struct threaded_block;
+
+static b32 EnableJIT(threaded_machine *Machine);
+static void RunJIT(threaded_machine *Machine, b32 Verify);
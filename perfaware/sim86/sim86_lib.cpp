@@ -12,17 +12,27 @@
 
 #define assert(...)
 
+#include <stdlib.h>
+#include <string.h>
+
 #include "sim86.h"
 
 #include "sim86_instruction.h"
 #include "sim86_instruction_table.h"
+#include "sim86_machine.h"
 #include "sim86_memory.h"
 #include "sim86_decode.h"
+#include "sim86_decode_cache.h"
+#include "sim86_execute.h"
+#include "sim86_cycles.h"
 
 #include "sim86_instruction.cpp"
 #include "sim86_instruction_table.cpp"
 #include "sim86_memory.cpp"
 #include "sim86_decode.cpp"
+#include "sim86_decode_cache.cpp"
+#include "sim86_execute.cpp"
+#include "sim86_cycles.cpp"
 #include "sim86_text_table.cpp"
 
 extern "C" u32 Sim86_GetVersion(void)
@@ -31,15 +41,13 @@ extern "C" u32 Sim86_GetVersion(void)
     return Result;
 }
 
-extern "C" void Sim86_Decode8086Instruction(u32 SourceSize, u8 *Source, instruction *Dest)
+static instruction DecodeFromBuffer(instruction_table Table, u32 SourceSize, u8 *Source)
 {
-    instruction_table Table = Get8086InstructionTable();
-    
     // NOTE(casey): The 8086 decoder requires the ability to read up to 15 bytes (the maximum
-    // allowable instruction size)
+    // allowable instruction size), and it addresses them through a 16-byte window.
     assert(Table.MaxInstructionByteCount == 15);
     u8 GuardBuffer[16] = {};
-    if(SourceSize < Table.MaxInstructionByteCount)
+    if(SourceSize < sizeof(GuardBuffer))
     {
         // NOTE(casey): I replaced the memcpy here with a manual copy to make it easier for
         // people compiling on things like WebAssembly who do not want to use Emscripten.
@@ -52,7 +60,76 @@ extern "C" void Sim86_Decode8086Instruction(u32 SourceSize, u8 *Source, instruct
     }
     
     segmented_access At = FixedMemoryPow2(4, Source);
-    *Dest = DecodeInstruction(Table, At);
+    instruction Result = DecodeInstruction(Table, At);
+    return Result;
+}
+
+extern "C" void Sim86_Decode8086Instruction(u32 SourceSize, u8 *Source, instruction *Dest)
+{
+    instruction_table Table = Get8086InstructionTable();
+    *Dest = DecodeFromBuffer(Table, SourceSize, Source);
+}
+
+static u32 DecodeBlock(u32 SourceSize, u8 *Source, u32 MaxCount, instruction *Dest, packed_instruction *PackedDest, u32 *OutCount)
+{
+    instruction_table Table = Get8086InstructionTable();
+    
+    u32 Offset = 0;
+    u32 Count = 0;
+    while((Offset < SourceSize) && (Count < MaxCount))
+    {
+        u32 Remaining = SourceSize - Offset;
+        instruction Instruction = DecodeFromBuffer(Table, Remaining, Source + Offset);
+        Instruction.Address = Offset;
+        if(Instruction.Op && (Instruction.Size <= Remaining) &&
+           (!PackedDest || PackInstruction(Instruction, &PackedDest[Count])))
+        {
+            if(Dest)
+            {
+                Dest[Count] = Instruction;
+            }
+            
+            ++Count;
+            Offset += Instruction.Size;
+        }
+        else
+        {
+            break;
+        }
+    }
+    
+    if(OutCount)
+    {
+        *OutCount = Count;
+    }
+    
+    return Offset;
+}
+
+extern "C" u32 Sim86_DecodeBlock(u32 SourceSize, u8 *Source, u32 MaxCount, instruction *Dest, u32 *OutCount)
+{
+    /* NOTE: This is just Sim86_Decode8086Instruction in a loop, so that bindings for other
+       languages can decode an entire buffer in one call instead of one call per instruction.
+       Decoding stops at the end of the buffer, when MaxCount instructions have been written, or at
+       the first byte that does not decode to an instruction that fits in the buffer. The return value
+       is the number of bytes that were consumed, so if it is less than SourceSize, the caller can
+       tell exactly where decoding stopped. The Address of each instruction is its offset from Source. */
+    
+    u32 Result = DecodeBlock(SourceSize, Source, MaxCount, Dest, 0, OutCount);
+    return Result;
+}
+
+extern "C" u32 Sim86_DecodeBlockPacked(u32 SourceSize, u8 *Source, u32 MaxCount, packed_instruction *Dest, u32 *OutCount)
+{
+    // NOTE: Same as Sim86_DecodeBlock, but stores 16-byte packed instructions, for when the
+    // decoded stream is large enough that the full instruction struct would be a problem.
+    u32 Result = DecodeBlock(SourceSize, Source, MaxCount, 0, Dest, OutCount);
+    return Result;
+}
+
+extern "C" void Sim86_UnpackInstruction(packed_instruction *Source, instruction *Dest)
+{
+    *Dest = UnpackInstruction(*Source);
 }
 
 extern "C" char const *Sim86_RegisterNameFromOperand(register_access *RegAccess)
@@ -70,4 +147,220 @@ extern "C" char const *Sim86_MnemonicFromOperationType(operation_type Type)
 extern "C" void Sim86_Get8086InstructionTable(instruction_table *Dest)
 {
     *Dest = Get8086InstructionTable();
-}
\ No newline at end of file
+}
+
+/* NOTE: Everything past here is for running 8086 code from another program. A machine is set up
+   once, and then Sim86_LoadImage starts a new run on it as many times as you like. Loading only has to
+   clear the memory the last run touched (the old image plus every page written since), so short runs
+   don't pay for clearing the whole 1mb each time. */
+
+#define SIM86_MACHINE_MEMORY_POW2 20
+
+struct sim86_machine
+{
+    u32 Flags;
+    u32 OnePastLastByte;
+    instruction_table Table;
+    
+    register_state_8086 Registers;
+    lazy_flags Lazy;
+    timing_state Timing;
+    sim86_clocks Clocks;
+    
+    dirty_pages Dirty;
+    decode_cache Cache;
+    u8 Memory[1 << SIM86_MACHINE_MEMORY_POW2];
+};
+static_assert(sizeof(sim86_registers) == sizeof(register_state_8086), "Mismatched register sizes");
+
+static segmented_access GetMachineMemory(sim86_machine *Machine)
+{
+    segmented_access Result = FixedMemoryPow2(SIM86_MACHINE_MEMORY_POW2, Machine->Memory);
+    Result.Watch = &Machine->Cache.Watch;
+    Result.Dirty = &Machine->Dirty;
+    return Result;
+}
+
+static sim86_stop StepMachine(sim86_machine *Machine, instruction *Dest)
+{
+    sim86_stop Result = Sim86Stop_End;
+    
+    register_state_8086 *Registers = &Machine->Registers;
+    segmented_access Memory = GetMachineMemory(Machine);
+    
+    segmented_access At = Memory;
+    At.Mask = 0xffff;
+    At.SegmentBase = Registers->cs;
+    At.SegmentOffset = Registers->ip;
+    
+    if(GetAbsoluteAddressOf(At) < Machine->OnePastLastByte)
+    {
+        instruction Instruction = {};
+        if(!GetCachedInstruction(&Machine->Cache, At, &Instruction))
+        {
+            Instruction = DecodeInstruction(Machine->Table, At);
+            CacheInstruction(&Machine->Cache, At, Instruction);
+        }
+        
+        if(!Instruction.Op)
+        {
+            Result = Sim86Stop_DecodeError;
+        }
+        else if((Machine->Flags & Sim86Machine_StopOnRet) &&
+                ((Instruction.Op == Op_ret) || (Instruction.Op == Op_retf)))
+        {
+            Result = Sim86Stop_Return;
+        }
+        else
+        {
+            Registers->ip += Instruction.Size;
+            exec_result Exec = ExecInstruction(Memory, Registers, Instruction, &Machine->Lazy);
+            InvalidateWrittenInstructions(&Machine->Cache);
+            
+            if(Exec.Unimplemented)
+            {
+                // NOTE: ip is left on the instruction, so the machine stays stopped on it.
+                Registers->ip -= Instruction.Size;
+                Result = Sim86Stop_Unimplemented;
+            }
+            else
+            {
+                timing_state *Timing = &Machine->Timing;
+                UpdateTimingForExec(Timing, Exec);
+                instruction_clock_interval Clocks = ExpectedClocksFrom(*Timing, Instruction, EstimateInstructionClocks(*Timing, Instruction));
+                
+                ++Machine->Clocks.InstructionCount;
+                Machine->Clocks.Min += Clocks.Min;
+                Machine->Clocks.Max += Clocks.Max;
+                
+                Result = Sim86Stop_None;
+            }
+        }
+        
+        if(Dest)
+        {
+            *Dest = Instruction;
+        }
+    }
+    
+    return Result;
+}
+
+extern "C" sim86_machine *Sim86_CreateMachine(u32 Flags)
+{
+    // NOTE: Returns 0 if there isn't memory for the machine. It starts out with nothing loaded,
+    // so it stops right away until Sim86_LoadImage is called.
+    sim86_machine *Result = (sim86_machine *)calloc(1, sizeof(sim86_machine));
+    if(Result)
+    {
+        Result->Flags = Flags;
+        Result->Table = Get8086InstructionTable();
+        Result->Timing.Assume8088 = (Flags & Sim86Machine_Assume8088);
+    }
+    
+    return Result;
+}
+
+extern "C" void Sim86_FreeMachine(sim86_machine *Machine)
+{
+    free(Machine);
+}
+
+extern "C" u32 Sim86_LoadImage(sim86_machine *Machine, u32 ImageSize, u8 *Image)
+{
+    /* NOTE: Resets the machine to all zeroes and loads the image at address 0, like sim86 does
+       with the file it is given. Execution starts at 0 and stops once cs:ip is past the end of the image.
+       The return value is the number of bytes loaded, which is less than ImageSize if it didn't fit. */
+    
+    u32 OldEnd = Machine->OnePastLastByte;
+    for(u32 PageIndex = 0; PageIndex < MEMORY_PAGE_COUNT; ++PageIndex)
+    {
+        u32 PageAddress = PageIndex*MEMORY_PAGE_SIZE;
+        if((PageAddress < OldEnd) || IsPageDirty(&Machine->Dirty, PageIndex))
+        {
+            memset(Machine->Memory + PageAddress, 0, MEMORY_PAGE_SIZE);
+        }
+    }
+    ClearDirtyPages(&Machine->Dirty);
+    
+    // NOTE: Only instructions inside the old image could have been cached, so only their entries
+    // and the watch bits for their bytes need clearing.
+    decode_cache *Cache = &Machine->Cache;
+    u32 EntryCount = (OldEnd < ArrayCount(Cache->Entries)) ? OldEnd : ArrayCount(Cache->Entries);
+    memset(Cache->Entries, 0, EntryCount*sizeof(Cache->Entries[0]));
+    
+    u32 WatchByteCount = (OldEnd + Machine->Table.MaxInstructionByteCount + 7) / 8;
+    if(WatchByteCount > sizeof(Cache->Watch.Bits))
+    {
+        WatchByteCount = sizeof(Cache->Watch.Bits);
+    }
+    memset(Cache->Watch.Bits, 0, WatchByteCount);
+    Cache->Watch.Overflowed = false;
+    Cache->Watch.HitCount = 0;
+    
+    u32 Result = ImageSize;
+    if(Result > sizeof(Machine->Memory))
+    {
+        Result = sizeof(Machine->Memory);
+    }
+    memcpy(Machine->Memory, Image, Result);
+    Machine->OnePastLastByte = Result;
+    
+    Machine->Registers = {};
+    Machine->Lazy = {};
+    Machine->Timing = {};
+    Machine->Timing.Assume8088 = (Machine->Flags & Sim86Machine_Assume8088);
+    Machine->Clocks = {};
+    
+    return Result;
+}
+
+extern "C" sim86_stop Sim86_Run(sim86_machine *Machine, u64 MaxSteps)
+{
+    // NOTE: Runs until the machine stops or MaxSteps instructions have been executed, whichever
+    // comes first. Returns Sim86Stop_None in the second case, so calling it again picks up where it left off.
+    sim86_stop Result = Sim86Stop_None;
+    for(u64 StepIndex = 0; (Result == Sim86Stop_None) && (StepIndex < MaxSteps); ++StepIndex)
+    {
+        Result = StepMachine(Machine, 0);
+    }
+    
+    return Result;
+}
+
+extern "C" sim86_stop Sim86_Step(sim86_machine *Machine, instruction *Dest)
+{
+    // NOTE: Executes one instruction. If Dest is given, it gets the instruction that was executed
+    // (or that the machine stopped on), with Op_None if nothing could be decoded.
+    sim86_stop Result = StepMachine(Machine, Dest);
+    return Result;
+}
+
+extern "C" void Sim86_GetRegisters(sim86_machine *Machine, sim86_registers *Dest)
+{
+    // NOTE: The machine only computes flags when something needs them, so they have to be
+    // brought up to date before anyone outside can see them.
+    MaterializeFlags(&Machine->Registers, &Machine->Lazy);
+    memcpy(Dest, &Machine->Registers, sizeof(*Dest));
+}
+
+extern "C" u32 Sim86_ReadMemory(sim86_machine *Machine, u32 Address, u32 Count, u8 *Dest)
+{
+    // NOTE: Reads stop at the end of the 1mb address space rather than wrapping, and the return
+    // value is the number of bytes read.
+    u32 Result = 0;
+    if(Address < sizeof(Machine->Memory))
+    {
+        u32 Available = sizeof(Machine->Memory) - Address;
+        Result = (Count < Available) ? Count : Available;
+        memcpy(Dest, Machine->Memory + Address, Result);
+    }
+    
+    return Result;
+}
+
+extern "C" void Sim86_GetClocks(sim86_machine *Machine, sim86_clocks *Dest)
+{
+    // NOTE: The instruction count and estimated clocks for everything executed since the image was loaded.
+    *Dest = Machine->Clocks;
+}
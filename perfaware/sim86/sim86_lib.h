@@ -13,6 +13,7 @@
 #include "sim86.h"
 #include "sim86_instruction.h"
 #include "sim86_instruction_table.h"
+#include "sim86_machine.h"
 
 // NOTE(casey): This ridiculousness is just here so that we can preprocess these files
 // and still have #ifdef's in the resulting file to support compilation via C-like
@@ -27,9 +28,20 @@ externc
 endif
 u32 Sim86_GetVersion(void);
 void Sim86_Decode8086Instruction(u32 SourceSize, u8 *Source, instruction *Dest);
+u32 Sim86_DecodeBlock(u32 SourceSize, u8 *Source, u32 MaxCount, instruction *Dest, u32 *OutCount);
+u32 Sim86_DecodeBlockPacked(u32 SourceSize, u8 *Source, u32 MaxCount, packed_instruction *Dest, u32 *OutCount);
+void Sim86_UnpackInstruction(packed_instruction *Source, instruction *Dest);
 char const *Sim86_RegisterNameFromOperand(register_access *RegAccess);
 char const *Sim86_MnemonicFromOperationType(operation_type Type);
 void Sim86_Get8086InstructionTable(instruction_table *Dest);
+sim86_machine *Sim86_CreateMachine(u32 Flags);
+void Sim86_FreeMachine(sim86_machine *Machine);
+u32 Sim86_LoadImage(sim86_machine *Machine, u32 ImageSize, u8 *Image);
+sim86_stop Sim86_Run(sim86_machine *Machine, u64 MaxSteps);
+sim86_stop Sim86_Step(sim86_machine *Machine, instruction *Dest);
+void Sim86_GetRegisters(sim86_machine *Machine, sim86_registers *Dest);
+u32 Sim86_ReadMemory(sim86_machine *Machine, u32 Address, u32 Count, u8 *Dest);
+void Sim86_GetClocks(sim86_machine *Machine, sim86_clocks *Dest);
 ifdefcpp
 closebrace
 endif
@@ -0,0 +1,843 @@
+/* NOTE: lane16 is 16 lanes of u16. When the compiler is allowed to use AVX2 (-mavx2, or -arch:AVX2
+   with MSVC), it is one register. Otherwise it is an array, and the same code runs one lane at a time. Masks are 0xffff for lanes that are on and 0 for lanes that are off. */
+
+#if defined(__AVX2__)
+
+#include <immintrin.h>
+
+typedef __m256i lane16;
+
+static lane16 LoadLanes(u16 *Source) {return _mm256_loadu_si256((__m256i *)Source);}
+static void StoreLanes(u16 *Dest, lane16 A) {_mm256_storeu_si256((__m256i *)Dest, A);}
+static lane16 BroadcastLanes(u16 Value) {return _mm256_set1_epi16((s16)Value);}
+static lane16 AndLanes(lane16 A, lane16 B) {return _mm256_and_si256(A, B);}
+static lane16 AndNotLanes(lane16 A, lane16 B) {return _mm256_andnot_si256(B, A);}
+static lane16 OrLanes(lane16 A, lane16 B) {return _mm256_or_si256(A, B);}
+static lane16 XorLanes(lane16 A, lane16 B) {return _mm256_xor_si256(A, B);}
+static lane16 AddLanes(lane16 A, lane16 B) {return _mm256_add_epi16(A, B);}
+static lane16 SubLanes(lane16 A, lane16 B) {return _mm256_sub_epi16(A, B);}
+static lane16 ShiftLeftLanes(lane16 A, u32 Count) {return _mm256_sll_epi16(A, _mm_cvtsi32_si128(Count));}
+static lane16 ShiftRightLanes(lane16 A, u32 Count) {return _mm256_srl_epi16(A, _mm_cvtsi32_si128(Count));}
+static lane16 EqualLanes(lane16 A, lane16 B) {return _mm256_cmpeq_epi16(A, B);}
+static lane16 BelowLanes(lane16 A, lane16 B) {return _mm256_andnot_si256(_mm256_cmpeq_epi16(_mm256_max_epu16(A, B), A), _mm256_set1_epi16(-1));}
+static lane16 MinLanes(lane16 A, lane16 B) {return _mm256_min_epu16(A, B);}
+static lane16 SelectLanes(lane16 Mask, lane16 A, lane16 B) {return _mm256_blendv_epi8(B, A, Mask);}
+
+static u32 LaneBits(lane16 Mask)
+{
+    // NOTE: One bit per lane, which movemask can only do for bytes, so the lanes are packed down to bytes first.
+    __m128i Packed = _mm_packs_epi16(_mm256_castsi256_si128(Mask), _mm256_extracti128_si256(Mask, 1));
+    u32 Result = (u32)_mm_movemask_epi8(Packed);
+    return Result;
+}
+
+#else
+
+struct lane16
+{
+    u16 E[LOCKSTEP_LANE_WIDTH];
+};
+
+#define LANE16_OP(Expression) lane16 Result; for(u32 I = 0; I < LOCKSTEP_LANE_WIDTH; ++I) {Result.E[I] = (u16)(Expression);} return Result
+
+static lane16 LoadLanes(u16 *Source) {LANE16_OP(Source[I]);}
+static void StoreLanes(u16 *Dest, lane16 A) {for(u32 I = 0; I < LOCKSTEP_LANE_WIDTH; ++I) {Dest[I] = A.E[I];}}
+static lane16 BroadcastLanes(u16 Value) {LANE16_OP(Value);}
+static lane16 AndLanes(lane16 A, lane16 B) {LANE16_OP(A.E[I] & B.E[I]);}
+static lane16 AndNotLanes(lane16 A, lane16 B) {LANE16_OP(A.E[I] & ~B.E[I]);}
+static lane16 OrLanes(lane16 A, lane16 B) {LANE16_OP(A.E[I] | B.E[I]);}
+static lane16 XorLanes(lane16 A, lane16 B) {LANE16_OP(A.E[I] ^ B.E[I]);}
+static lane16 AddLanes(lane16 A, lane16 B) {LANE16_OP(A.E[I] + B.E[I]);}
+static lane16 SubLanes(lane16 A, lane16 B) {LANE16_OP(A.E[I] - B.E[I]);}
+static lane16 ShiftLeftLanes(lane16 A, u32 Count) {LANE16_OP(A.E[I] << Count);}
+static lane16 ShiftRightLanes(lane16 A, u32 Count) {LANE16_OP(A.E[I] >> Count);}
+static lane16 EqualLanes(lane16 A, lane16 B) {LANE16_OP((A.E[I] == B.E[I]) ? 0xffff : 0);}
+static lane16 BelowLanes(lane16 A, lane16 B) {LANE16_OP((A.E[I] < B.E[I]) ? 0xffff : 0);}
+static lane16 MinLanes(lane16 A, lane16 B) {LANE16_OP((A.E[I] < B.E[I]) ? A.E[I] : B.E[I]);}
+static lane16 SelectLanes(lane16 Mask, lane16 A, lane16 B) {LANE16_OP(Mask.E[I] ? A.E[I] : B.E[I]);}
+
+static u32 LaneBits(lane16 Mask)
+{
+    u32 Result = 0;
+    for(u32 I = 0; I < LOCKSTEP_LANE_WIDTH; ++I)
+    {
+        Result |= Mask.E[I] ? (1 << I) : 0;
+    }
+    return Result;
+}
+
+#undef LANE16_OP
+
+#endif
+
+static lane16 NotEqualLanes(lane16 A, lane16 B)
+{
+    lane16 Result = XorLanes(EqualLanes(A, B), BroadcastLanes(0xffff));
+    return Result;
+}
+
+static lane16 NonZeroLanes(lane16 A, u16 Bit)
+{
+    // NOTE: Bit where A is non-zero, 0 where it is zero.
+    lane16 Result = AndNotLanes(BroadcastLanes(Bit), EqualLanes(A, BroadcastLanes(0)));
+    return Result;
+}
+
+static u32 CountSetBits(u32 Value)
+{
+    u32 Result = 0;
+    while(Value)
+    {
+        Value &= Value - 1;
+        ++Result;
+    }
+    return Result;
+}
+
+static lane16 ComputeFlagsLanes(lane16 Flags, lazy_flags_op Op, u32 WWidth, lane16 V0, lane16 V1, lane16 R, lane16 CF)
+{
+    // NOTE: This is MaterializeFlags, UpdateArithFlags and UpdateLogFlags, for 16 lanes at once.
+    lane16 SignBit = BroadcastLanes(SignBitFor(WWidth));
+    lane16 Masked = (Op == LazyFlags_Log) ? R : AndLanes(R, BroadcastLanes(WidthMaskFor(WWidth)));
+    
+    lane16 Arith = BroadcastLanes(0);
+    switch(Op)
+    {
+        case LazyFlags_Add:
+        {
+            lane16 OF = AndLanes(AndNotLanes(XorLanes(V0, R), XorLanes(V0, V1)), SignBit);
+            lane16 AF = AndLanes(AddLanes(AndLanes(V0, BroadcastLanes(0xf)), AndLanes(V1, BroadcastLanes(0xf))), BroadcastLanes(0x10));
+            Arith = OrLanes(OrLanes(CF, NonZeroLanes(OF, Flag_OF)), NonZeroLanes(AF, Flag_AF));
+        } break;
+        
+        case LazyFlags_Sub:
+        {
+            lane16 OF = AndLanes(AndLanes(XorLanes(V0, V1), XorLanes(V0, R)), SignBit);
+            lane16 AF = AndLanes(SubLanes(AndLanes(V0, BroadcastLanes(0xf)), AndLanes(V1, BroadcastLanes(0xf))), BroadcastLanes(0x10));
+            Arith = OrLanes(OrLanes(CF, NonZeroLanes(OF, Flag_OF)), NonZeroLanes(AF, Flag_AF));
+        } break;
+        
+        case LazyFlags_Arith:
+        {
+            Arith = CF;
+        } break;
+        
+        default: {} break;
+    }
+    
+    // NOTE: Same parity computation as ParityFlagOf, which only looks at the low 8 bits.
+    lane16 Parity = XorLanes(Masked, ShiftRightLanes(Masked, 1));
+    Parity = XorLanes(Parity, ShiftRightLanes(Parity, 2));
+    Parity = XorLanes(Parity, ShiftRightLanes(Parity, 4));
+    lane16 PF = ShiftLeftLanes(AndNotLanes(BroadcastLanes(1), Parity), 2);
+    
+    lane16 SF = NonZeroLanes(AndLanes(Masked, SignBit), Flag_SF);
+    lane16 ZF = AndLanes(EqualLanes(Masked, BroadcastLanes(0)), BroadcastLanes(Flag_ZF));
+    
+    lane16 Result = AndNotLanes(Flags, BroadcastLanes(Flag_OF|Flag_CF|Flag_AF|Flag_SF|Flag_ZF|Flag_PF));
+    Result = OrLanes(Result, OrLanes(OrLanes(Arith, PF), OrLanes(SF, ZF)));
+    return Result;
+}
+
+static void MaterializeLockstepFlags(lockstep_machine *Machine)
+{
+    if(Machine->LazyOp)
+    {
+        u16 *Flags = Machine->Registers[FLAGS_REGISTER_8086];
+        for(u32 FirstLane = 0; FirstLane < Machine->PaddedLaneCount; FirstLane += LOCKSTEP_LANE_WIDTH)
+        {
+            lane16 Live = LoadLanes(Machine->Live + FirstLane);
+            lane16 Old = LoadLanes(Flags + FirstLane);
+            lane16 New = ComputeFlagsLanes(Old, Machine->LazyOp, Machine->LazyWWidth,
+                                           LoadLanes(Machine->LazyV0 + FirstLane), LoadLanes(Machine->LazyV1 + FirstLane),
+                                           LoadLanes(Machine->LazyR + FirstLane), LoadLanes(Machine->LazyCF + FirstLane));
+            StoreLanes(Flags + FirstLane, SelectLanes(Live, New, Old));
+        }
+        
+        Machine->LazyOp = LazyFlags_None;
+    }
+}
+
+static segmented_access GetLaneMemory(lockstep_machine *Machine, u32 Lane)
+{
+    segmented_access Result = FixedMemoryPow2(LOCKSTEP_MEMORY_POW2, Machine->Memory + (size_t)Lane*Machine->LaneMemorySize);
+    return Result;
+}
+
+static void GetLaneRegisters(lockstep_machine *Machine, u32 Lane, register_state_8086 *Registers)
+{
+    for(u32 RegIndex = 0; RegIndex < Register_count; ++RegIndex)
+    {
+        Registers->u16[RegIndex] = Machine->Registers[RegIndex][Lane];
+    }
+}
+
+static void SetLaneRegisters(lockstep_machine *Machine, u32 Lane, register_state_8086 *Registers)
+{
+    // NOTE: Registers[0] has to stay zero, so it is skipped.
+    for(u32 RegIndex = 1; RegIndex < Register_count; ++RegIndex)
+    {
+        Machine->Registers[RegIndex][Lane] = Registers->u16[RegIndex];
+    }
+}
+
+static u16 GetLaneRegisterValue(lockstep_machine *Machine, register_access Access, u32 Lane)
+{
+    u16 Value = Machine->Registers[Access.Index % Register_count][Lane];
+    u16 Result = (Access.Count == 1) ? ((Value >> (8*Access.Offset)) & 0xff) : Value;
+    return Result;
+}
+
+static lockstep_machine *CreateLockstepMachine(u32 LaneCount, segmented_access Image, u32 OnePastLastByte, b32 StopOnRet)
+{
+    if(LaneCount > LOCKSTEP_MAX_LANE_COUNT)
+    {
+        LaneCount = LOCKSTEP_MAX_LANE_COUNT;
+    }
+    u32 PaddedLaneCount = (LaneCount + LOCKSTEP_LANE_WIDTH - 1) & ~(LOCKSTEP_LANE_WIDTH - 1);
+    u32 LaneMemorySize = (1 << LOCKSTEP_MEMORY_POW2);
+    
+    // NOTE: Everything per lane is one allocation: the registers, then Live, Active, and the lazy flags,
+    // then the stops, then each lane's memory.
+    u32 ArrayCount16 = Register_count + 6;
+    size_t ArraysSize = (size_t)ArrayCount16*PaddedLaneCount*sizeof(u16) + PaddedLaneCount;
+    size_t MemoryOffset = (ArraysSize + 63) & ~(size_t)63;
+    u8 *Storage = (u8 *)calloc(1, MemoryOffset + (size_t)PaddedLaneCount*LaneMemorySize);
+    lockstep_machine *Machine = (lockstep_machine *)calloc(1, sizeof(lockstep_machine));
+    if(!Storage || !Machine)
+    {
+        free(Storage);
+        free(Machine);
+        return 0;
+    }
+    
+    Machine->LaneCount = LaneCount;
+    Machine->PaddedLaneCount = PaddedLaneCount;
+    
+    u16 *Arrays = (u16 *)Storage;
+    for(u32 RegIndex = 0; RegIndex < Register_count; ++RegIndex)
+    {
+        Machine->Registers[RegIndex] = Arrays;
+        Arrays += PaddedLaneCount;
+    }
+    Machine->Live = Arrays; Arrays += PaddedLaneCount;
+    Machine->Active = Arrays; Arrays += PaddedLaneCount;
+    Machine->LazyV0 = Arrays; Arrays += PaddedLaneCount;
+    Machine->LazyV1 = Arrays; Arrays += PaddedLaneCount;
+    Machine->LazyR = Arrays; Arrays += PaddedLaneCount;
+    Machine->LazyCF = Arrays; Arrays += PaddedLaneCount;
+    Machine->Stops = (u8 *)Arrays;
+    
+    Machine->Memory = Storage + MemoryOffset;
+    Machine->LaneMemorySize = LaneMemorySize;
+    Machine->OnePastLastByte = (OnePastLastByte < LaneMemorySize) ? OnePastLastByte : LaneMemorySize;
+    Machine->StopOnRet = StopOnRet;
+    Machine->Table = Get8086InstructionTable();
+    
+    u32 ImageSize = (GetHighestAddress(Image) + 1);
+    if(ImageSize > LaneMemorySize)
+    {
+        ImageSize = LaneMemorySize;
+    }
+    
+    for(u32 Lane = 0; Lane < LaneCount; ++Lane)
+    {
+        memcpy(Machine->Memory + (size_t)Lane*LaneMemorySize, Image.Memory, ImageSize);
+        Machine->Live[Lane] = 0xffff;
+        Machine->Active[Lane] = 0xffff;
+    }
+    Machine->LiveCount = LaneCount;
+    Machine->ActiveCount = LaneCount;
+    Machine->Converged = true;
+    
+    return Machine;
+}
+
+static void FreeLockstepMachine(lockstep_machine *Machine)
+{
+    if(Machine)
+    {
+        free(Machine->Registers[0]);
+        free(Machine);
+    }
+}
+
+static void LoadLaneData(lockstep_machine *Machine, u8 *Data, u32 RecordSize, u32 Address)
+{
+    // NOTE: Each lane gets its own RecordSize bytes of Data, stored starting at Address in its memory.
+    // Anything that would go past the end of the lane's memory is dropped, rather than wrapping around onto the program.
+    Address &= (Machine->LaneMemorySize - 1);
+    u32 CopySize = RecordSize;
+    if(CopySize > (Machine->LaneMemorySize - Address))
+    {
+        CopySize = Machine->LaneMemorySize - Address;
+    }
+    
+    for(u32 Lane = 0; Lane < Machine->LaneCount; ++Lane)
+    {
+        u8 *LaneMemory = Machine->Memory + (size_t)Lane*Machine->LaneMemorySize;
+        memcpy(LaneMemory + Address, Data + (size_t)Lane*RecordSize, CopySize);
+    }
+}
+
+static void StopActiveLanes(lockstep_machine *Machine, lockstep_stop Stop)
+{
+    // NOTE: Pending flags belong to every live lane, so they have to be finished before any lane stops.
+    MaterializeLockstepFlags(Machine);
+    
+    for(u32 Lane = 0; Lane < Machine->PaddedLaneCount; ++Lane)
+    {
+        if(Machine->Active[Lane])
+        {
+            Machine->Stops[Lane] = (u8)Stop;
+            Machine->Live[Lane] = 0;
+            Machine->Active[Lane] = 0;
+        }
+    }
+    
+    Machine->LiveCount -= Machine->ActiveCount;
+    Machine->ActiveCount = 0;
+    Machine->Converged = false;
+}
+
+static b32 SelectLockstepLanes(lockstep_machine *Machine)
+{
+    // NOTE: Picks the lanes to run next: every live lane at the lowest ip, which are in the same cs
+    // as the first of them. Returns false when there are no live lanes left.
+    if(!Machine->Converged)
+    {
+        u16 *IP = Machine->Registers[Register_ip];
+        u16 *CS = Machine->Registers[Register_cs];
+        
+        lane16 Min = BroadcastLanes(0xffff);
+        for(u32 FirstLane = 0; FirstLane < Machine->PaddedLaneCount; FirstLane += LOCKSTEP_LANE_WIDTH)
+        {
+            lane16 Live = LoadLanes(Machine->Live + FirstLane);
+            Min = MinLanes(Min, SelectLanes(Live, LoadLanes(IP + FirstLane), BroadcastLanes(0xffff)));
+        }
+        
+        u16 MinValues[LOCKSTEP_LANE_WIDTH];
+        StoreLanes(MinValues, Min);
+        u16 MinIP = 0xffff;
+        for(u32 Index = 0; Index < LOCKSTEP_LANE_WIDTH; ++Index)
+        {
+            MinIP = (MinValues[Index] < MinIP) ? MinValues[Index] : MinIP;
+        }
+        
+        b32 Found = false;
+        for(u32 Lane = 0; Lane < Machine->PaddedLaneCount; ++Lane)
+        {
+            if(Machine->Live[Lane] && (IP[Lane] == MinIP))
+            {
+                Machine->CS = CS[Lane];
+                Found = true;
+                break;
+            }
+        }
+        
+        if(!Found)
+        {
+            return false;
+        }
+        
+        Machine->IP = MinIP;
+        Machine->ActiveCount = 0;
+        lane16 MatchIP = BroadcastLanes(Machine->IP);
+        lane16 MatchCS = BroadcastLanes(Machine->CS);
+        for(u32 FirstLane = 0; FirstLane < Machine->PaddedLaneCount; FirstLane += LOCKSTEP_LANE_WIDTH)
+        {
+            lane16 Active = AndLanes(LoadLanes(Machine->Live + FirstLane),
+                                     AndLanes(EqualLanes(LoadLanes(IP + FirstLane), MatchIP),
+                                              EqualLanes(LoadLanes(CS + FirstLane), MatchCS)));
+            StoreLanes(Machine->Active + FirstLane, Active);
+            Machine->ActiveCount += CountSetBits(LaneBits(Active));
+        }
+        
+        Machine->Converged = (Machine->ActiveCount == Machine->LiveCount);
+    }
+    
+    b32 Result = (Machine->LiveCount != 0);
+    return Result;
+}
+
+static u32 GetFirstActiveLane(lockstep_machine *Machine)
+{
+    u32 Result = 0;
+    while(!Machine->Active[Result])
+    {
+        ++Result;
+    }
+    return Result;
+}
+
+static b32 IsLockstepOperand(instruction_operand Operand)
+{
+    // NOTE: Explicit segments are only used by far jumps and calls, which go through ExecInstruction.
+    b32 Result = ((Operand.Type == Operand_Register) ||
+                  (Operand.Type == Operand_Immediate) ||
+                  ((Operand.Type == Operand_Memory) && !(Operand.Address.Flags & Address_ExplicitSegment)));
+    return Result;
+}
+
+static lazy_flags_op GetLockstepFlagsOp(operation_type Op)
+{
+    lazy_flags_op Result = LazyFlags_None;
+    switch(Op)
+    {
+        case Op_add: {Result = LazyFlags_Add;} break;
+        case Op_sub: case Op_cmp: {Result = LazyFlags_Sub;} break;
+        case Op_inc: case Op_dec: {Result = LazyFlags_Arith;} break;
+        case Op_and: case Op_or: case Op_xor: case Op_test: {Result = LazyFlags_Log;} break;
+        default: {} break;
+    }
+    return Result;
+}
+
+static b32 IsLockstepBranch(operation_type Op)
+{
+    b32 Result = false;
+    switch(Op)
+    {
+        case Op_je: case Op_jl: case Op_jle: case Op_jb: case Op_jbe: case Op_jp: case Op_jo: case Op_js:
+        case Op_jne: case Op_jnl: case Op_jg: case Op_jnb: case Op_ja: case Op_jnp: case Op_jno: case Op_jns:
+        case Op_loop: case Op_loopz: case Op_loopnz: case Op_jcxz:
+        {
+            Result = true;
+        } break;
+        
+        default: {} break;
+    }
+    return Result;
+}
+
+static b32 CanRunAsLanes(instruction Instruction)
+{
+    // NOTE: Everything else runs lane by lane through ExecInstruction.
+    b32 Result = false;
+    if(IsLockstepBranch(Instruction.Op))
+    {
+        Result = (Instruction.Operands[0].Type == Operand_Immediate);
+    }
+    else if((Instruction.Op == Op_mov) || GetLockstepFlagsOp(Instruction.Op))
+    {
+        Result = (((Instruction.Operands[0].Type == Operand_Register) || (Instruction.Operands[0].Type == Operand_Memory)) &&
+                  IsLockstepOperand(Instruction.Operands[0]) &&
+                  ((Instruction.Operands[1].Type == Operand_None) || IsLockstepOperand(Instruction.Operands[1])));
+    }
+    return Result;
+}
+
+static segmented_access GetLaneOperandMemory(lockstep_machine *Machine, instruction Instruction, instruction_operand Operand, u32 Lane)
+{
+    // NOTE: The same address AccessOperand would work out for this lane.
+    segmented_access Result = GetLaneMemory(Machine, Lane);
+    Result.Mask = Machine->LaneMemorySize - 1;
+    Result.SegmentOffset = Operand.Address.Displacement;
+    
+    u32 SegReg = (Operand.Address.Terms[0].Register.Index == Register_bp) ? Register_ss : Register_ds;
+    if(Instruction.SegmentOverride)
+    {
+        SegReg = Instruction.SegmentOverride;
+    }
+    Result.SegmentBase = Machine->Registers[SegReg % Register_count][Lane];
+    
+    for(u32 TermIndex = 0; TermIndex < ArrayCount(Operand.Address.Terms); ++TermIndex)
+    {
+        effective_address_term Term = Operand.Address.Terms[TermIndex];
+        Result.SegmentOffset += Term.Scale*GetLaneRegisterValue(Machine, Term.Register, Lane);
+    }
+    
+    return Result;
+}
+
+static lane16 ReadOperandLanes(lockstep_machine *Machine, instruction Instruction, u32 OperandIndex, u32 FirstLane, u32 ActiveBits)
+{
+    instruction_operand Operand = Instruction.Operands[OperandIndex];
+    
+    lane16 Result = BroadcastLanes(0);
+    switch(Operand.Type)
+    {
+        case Operand_Register:
+        {
+            lane16 Value = LoadLanes(Machine->Registers[Operand.Register.Index % Register_count] + FirstLane);
+            if(Operand.Register.Count == 1)
+            {
+                Value = AndLanes(ShiftRightLanes(Value, 8*Operand.Register.Offset), BroadcastLanes(0xff));
+            }
+            Result = Value;
+        } break;
+        
+        case Operand_Memory:
+        {
+            // NOTE: AVX2 can gather, but can't scatter, and the lanes' memories are 64k apart, so memory
+            // is just read (and written) one lane at a time. Like AccessOperand, this always reads 16 bits.
+            u16 Values[LOCKSTEP_LANE_WIDTH] = {};
+            for(u32 Index = 0; Index < LOCKSTEP_LANE_WIDTH; ++Index)
+            {
+                if(ActiveBits & (1 << Index))
+                {
+                    Values[Index] = ReadU16(GetLaneOperandMemory(Machine, Instruction, Operand, FirstLane + Index), 0);
+                }
+            }
+            Result = LoadLanes(Values);
+        } break;
+        
+        case Operand_Immediate:
+        {
+            Result = BroadcastLanes((u16)Operand.Immediate.Value);
+        } break;
+        
+        default: {} break;
+    }
+    
+    return Result;
+}
+
+static void WriteOperandLanes(lockstep_machine *Machine, instruction Instruction, u32 FirstLane, u32 ActiveBits,
+                              lane16 Mask, lane16 Value, u32 WWidth)
+{
+    instruction_operand Operand = Instruction.Operands[0];
+    if(Operand.Type == Operand_Register)
+    {
+        u16 *Reg = Machine->Registers[Operand.Register.Index % Register_count] + FirstLane;
+        lane16 Old = LoadLanes(Reg);
+        lane16 New = Value;
+        if(Operand.Register.Count == 1)
+        {
+            u32 Shift = 8*Operand.Register.Offset;
+            lane16 Keep = BroadcastLanes((u16)~(0xff << Shift));
+            New = OrLanes(AndLanes(Old, Keep), ShiftLeftLanes(AndLanes(Value, BroadcastLanes(0xff)), Shift));
+        }
+        StoreLanes(Reg, SelectLanes(Mask, New, Old));
+    }
+    else
+    {
+        u16 Values[LOCKSTEP_LANE_WIDTH];
+        StoreLanes(Values, Value);
+        for(u32 Index = 0; Index < LOCKSTEP_LANE_WIDTH; ++Index)
+        {
+            if(ActiveBits & (1 << Index))
+            {
+                WriteN(GetLaneOperandMemory(Machine, Instruction, Operand, FirstLane + Index), 0, Values[Index], WWidth);
+            }
+        }
+    }
+}
+
+static lane16 EvaluateJumpConditionLanes(lockstep_machine *Machine, operation_type Op, u32 FirstLane, lane16 Mask)
+{
+    // NOTE: EvaluateJumpCondition, for 16 lanes at once, including the way it compares the flag bits
+    // (so it takes exactly the same branches). loop, loopz and loopnz decrement cx in the lanes in Mask.
+    lane16 Flags = LoadLanes(Machine->Registers[FLAGS_REGISTER_8086] + FirstLane);
+    lane16 CF = AndLanes(Flags, BroadcastLanes(Flag_CF));
+    lane16 PF = AndLanes(Flags, BroadcastLanes(Flag_PF));
+    lane16 ZF = AndLanes(Flags, BroadcastLanes(Flag_ZF));
+    lane16 SF = AndLanes(Flags, BroadcastLanes(Flag_SF));
+    lane16 OF = AndLanes(Flags, BroadcastLanes(Flag_OF));
+    lane16 Zero = BroadcastLanes(0);
+    lane16 One = BroadcastLanes(1);
+    
+    u16 *CXRegister = Machine->Registers[Register_c] + FirstLane;
+    lane16 CX = LoadLanes(CXRegister);
+    if((Op == Op_loop) || (Op == Op_loopz) || (Op == Op_loopnz))
+    {
+        CX = SelectLanes(Mask, SubLanes(CX, One), CX);
+        StoreLanes(CXRegister, CX);
+    }
+    
+    lane16 Result = Zero;
+    switch(Op)
+    {
+        case Op_je: {Result = EqualLanes(ZF, One);} break;
+        case Op_jl: {Result = EqualLanes(XorLanes(SF, OF), One);} break;
+        case Op_jle: {Result = EqualLanes(OrLanes(XorLanes(SF, OF), ZF), One);} break;
+        case Op_jb: {Result = EqualLanes(CF, One);} break;
+        case Op_jbe: {Result = EqualLanes(OrLanes(CF, ZF), One);} break;
+        case Op_jp: {Result = EqualLanes(PF, One);} break;
+        case Op_jo: {Result = EqualLanes(OF, One);} break;
+        case Op_js: {Result = EqualLanes(SF, One);} break;
+        case Op_jne: {Result = EqualLanes(ZF, Zero);} break;
+        case Op_jnl: {Result = EqualLanes(XorLanes(SF, OF), Zero);} break;
+        case Op_jg: {Result = EqualLanes(OrLanes(AndLanes(SF, OF), ZF), Zero);} break;
+        case Op_jnb: {Result = EqualLanes(CF, Zero);} break;
+        case Op_ja: {Result = EqualLanes(OrLanes(CF, ZF), Zero);} break;
+        case Op_jnp: {Result = EqualLanes(PF, Zero);} break;
+        case Op_jno: {Result = EqualLanes(OF, Zero);} break;
+        case Op_jns: {Result = EqualLanes(SF, Zero);} break;
+        case Op_loop: {Result = NotEqualLanes(CX, Zero);} break;
+        case Op_loopz: {Result = AndLanes(NotEqualLanes(CX, Zero), EqualLanes(ZF, One));} break;
+        case Op_loopnz: {Result = AndLanes(NotEqualLanes(CX, Zero), EqualLanes(ZF, Zero));} break;
+        case Op_jcxz: {Result = NotEqualLanes(CX, Zero);} break;
+        
+        default: {} break;
+    }
+    
+    Result = AndLanes(Result, Mask);
+    return Result;
+}
+
+static void RunBranchAsLanes(lockstep_machine *Machine, instruction Instruction, u16 NextIP)
+{
+    MaterializeLockstepFlags(Machine);
+    
+    u16 Target = NextIP + (s8)Instruction.Operands[0].Immediate.Value;
+    lane16 TargetIP = BroadcastLanes(Target);
+    lane16 FallThroughIP = BroadcastLanes(NextIP);
+    
+    u32 TakenCount = 0;
+    u16 *IP = Machine->Registers[Register_ip];
+    for(u32 FirstLane = 0; FirstLane < Machine->PaddedLaneCount; FirstLane += LOCKSTEP_LANE_WIDTH)
+    {
+        lane16 Mask = LoadLanes(Machine->Active + FirstLane);
+        if(LaneBits(Mask))
+        {
+            lane16 Taken = EvaluateJumpConditionLanes(Machine, Instruction.Op, FirstLane, Mask);
+            TakenCount += CountSetBits(LaneBits(Taken));
+            
+            lane16 Old = LoadLanes(IP + FirstLane);
+            StoreLanes(IP + FirstLane, SelectLanes(Taken, TargetIP, SelectLanes(Mask, FallThroughIP, Old)));
+        }
+    }
+    
+    // NOTE: Lanes that all went the same way are still together. Otherwise they are split up here.
+    if(TakenCount == Machine->ActiveCount)
+    {
+        Machine->IP = Target;
+    }
+    else if(TakenCount == 0)
+    {
+        Machine->IP = NextIP;
+    }
+    else
+    {
+        Machine->Converged = false;
+    }
+}
+
+static void RunInstructionAsLanes(lockstep_machine *Machine, instruction Instruction, u16 NextIP)
+{
+    u32 WWidth = (Instruction.Flags & Inst_Wide) ? 2 : 1;
+    lane16 WidthMask = BroadcastLanes(WidthMaskFor(WWidth));
+    lane16 One = BroadcastLanes(1);
+    lane16 Zero = BroadcastLanes(0);
+    lane16 CarryBit = BroadcastLanes((WWidth == 2) ? 0 : 0x100);
+    
+    // NOTE: Flags can only be left lazy if every live lane is running this. Otherwise, whatever is
+    // pending has to be finished first, and the new flags are computed right away.
+    lazy_flags_op FlagsOp = GetLockstepFlagsOp(Instruction.Op);
+    b32 RecordLazy = (FlagsOp && !Machine->EagerFlags && (Machine->ActiveCount == Machine->LiveCount));
+    if(FlagsOp && !RecordLazy)
+    {
+        MaterializeLockstepFlags(Machine);
+    }
+    
+    u16 *IP = Machine->Registers[Register_ip];
+    u16 *Flags = Machine->Registers[FLAGS_REGISTER_8086];
+    for(u32 FirstLane = 0; FirstLane < Machine->PaddedLaneCount; FirstLane += LOCKSTEP_LANE_WIDTH)
+    {
+        lane16 Mask = LoadLanes(Machine->Active + FirstLane);
+        u32 ActiveBits = LaneBits(Mask);
+        if(!ActiveBits)
+        {
+            continue;
+        }
+        
+        StoreLanes(IP + FirstLane, SelectLanes(Mask, BroadcastLanes(NextIP), LoadLanes(IP + FirstLane)));
+        
+        lane16 V0 = Zero;
+        if(Instruction.Op != Op_mov)
+        {
+            V0 = ReadOperandLanes(Machine, Instruction, 0, FirstLane, ActiveBits);
+        }
+        lane16 V1 = ReadOperandLanes(Machine, Instruction, 1, FirstLane, ActiveBits);
+        
+        // NOTE: Same arithmetic as ExecInstruction. CF is worked out here, since for 16-bit operations
+        // it is in bit 16 of the result, which doesn't fit in a lane.
+        lane16 R = Zero;
+        lane16 CF = Zero;
+        b32 WriteResult = true;
+        switch(Instruction.Op)
+        {
+            case Op_mov:
+            {
+                R = V1;
+            } break;
+            
+            case Op_add:
+            {
+                V0 = AndLanes(V0, WidthMask);
+                V1 = AndLanes(V1, WidthMask);
+                R = AddLanes(V0, V1);
+                CF = (WWidth == 2) ? BelowLanes(R, V0) : AndLanes(R, CarryBit);
+            } break;
+            
+            case Op_sub:
+            case Op_cmp:
+            {
+                lane16 A = AndLanes(V0, WidthMask);
+                lane16 B = AndLanes(V1, WidthMask);
+                R = SubLanes(A, B);
+                CF = (WWidth == 2) ? BelowLanes(A, B) : AndLanes(R, CarryBit);
+                WriteResult = (Instruction.Op == Op_sub);
+            } break;
+            
+            case Op_inc:
+            {
+                R = AddLanes(V0, One);
+                CF = (WWidth == 2) ? EqualLanes(R, Zero) : AndLanes(R, CarryBit);
+            } break;
+            
+            case Op_dec:
+            {
+                R = SubLanes(V0, One);
+                CF = (WWidth == 2) ? EqualLanes(V0, Zero) : AndLanes(R, CarryBit);
+            } break;
+            
+            case Op_and: {R = AndLanes(V0, V1);} break;
+            case Op_or: {R = OrLanes(V0, V1);} break;
+            case Op_xor: {R = XorLanes(V0, V1);} break;
+            
+            case Op_test:
+            {
+                R = AndLanes(V0, V1);
+                WriteResult = false;
+            } break;
+            
+            default: {} break;
+        }
+        
+        if(FlagsOp)
+        {
+            CF = NonZeroLanes(CF, Flag_CF);
+            if(FlagsOp == LazyFlags_Log)
+            {
+                // NOTE: Logical ops only pass the result along, which is masked except for test (see
+                // WriteLogOpResult, and Op_test in ExecInstruction).
+                if(Instruction.Op != Op_test)
+                {
+                    R = AndLanes(R, WidthMask);
+                }
+                V0 = Zero;
+                V1 = Zero;
+                CF = Zero;
+            }
+            
+            if(RecordLazy)
+            {
+                StoreLanes(Machine->LazyV0 + FirstLane, V0);
+                StoreLanes(Machine->LazyV1 + FirstLane, V1);
+                StoreLanes(Machine->LazyR + FirstLane, R);
+                StoreLanes(Machine->LazyCF + FirstLane, CF);
+            }
+            else
+            {
+                lane16 Old = LoadLanes(Flags + FirstLane);
+                StoreLanes(Flags + FirstLane, SelectLanes(Mask, ComputeFlagsLanes(Old, FlagsOp, WWidth, V0, V1, R, CF), Old));
+            }
+        }
+        
+        if(WriteResult)
+        {
+            WriteOperandLanes(Machine, Instruction, FirstLane, ActiveBits, Mask, AndLanes(R, WidthMask), WWidth);
+        }
+    }
+    
+    if(RecordLazy)
+    {
+        Machine->LazyOp = FlagsOp;
+        Machine->LazyWWidth = WWidth;
+    }
+    
+    Machine->IP = NextIP;
+    if((Instruction.Operands[0].Type == Operand_Register) &&
+       ((Instruction.Operands[0].Register.Index == Register_cs) || (Instruction.Operands[0].Register.Index == Register_ip)))
+    {
+        Machine->Converged = false;
+    }
+}
+
+static void RunInstructionByLane(lockstep_machine *Machine, instruction Instruction, u16 NextIP)
+{
+    // NOTE: Anything that can't run as lanes is given to ExecInstruction one lane at a time, with
+    // flags computed right away, the same as -eagerflags.
+    MaterializeLockstepFlags(Machine);
+    
+    b32 Unimplemented = false;
+    for(u32 Lane = 0; Lane < Machine->PaddedLaneCount; ++Lane)
+    {
+        if(Machine->Active[Lane])
+        {
+            register_state_8086 Registers;
+            GetLaneRegisters(Machine, Lane, &Registers);
+            Registers.ip = NextIP;
+            
+            exec_result Exec = ExecInstruction(GetLaneMemory(Machine, Lane), &Registers, Instruction);
+            Unimplemented |= Exec.Unimplemented;
+            
+            SetLaneRegisters(Machine, Lane, &Registers);
+        }
+    }
+    
+    if(Unimplemented)
+    {
+        // NOTE: Like Run8086, an unimplemented instruction doesn't count as executed.
+        Machine->LaneInstructionCount -= Machine->ActiveCount;
+        StopActiveLanes(Machine, LockstepStop_Unimplemented);
+    }
+    else
+    {
+        Machine->ScalarLaneInstructionCount += Machine->ActiveCount;
+    }
+    
+    // NOTE: There's no telling where ExecInstruction sent each lane, so they have to be sorted out again.
+    Machine->Converged = false;
+}
+
+static void RunLockstep(lockstep_machine *Machine)
+{
+    while(SelectLockstepLanes(Machine))
+    {
+        u32 FirstLane = GetFirstActiveLane(Machine);
+        
+        segmented_access At = GetLaneMemory(Machine, FirstLane);
+        At.Mask = 0xffff;
+        At.SegmentBase = Machine->CS;
+        At.SegmentOffset = Machine->IP;
+        
+        if(GetAbsoluteAddressOf(At) < Machine->OnePastLastByte)
+        {
+            instruction Instruction = DecodeInstruction(Machine->Table, At);
+            if(!Instruction.Op)
+            {
+                StopActiveLanes(Machine, LockstepStop_DecodeError);
+            }
+            else if(Machine->StopOnRet && IsRet(Instruction.Op))
+            {
+                StopActiveLanes(Machine, LockstepStop_Return);
+            }
+            else
+            {
+                ++Machine->StepCount;
+                Machine->LaneInstructionCount += Machine->ActiveCount;
+                
+                u16 NextIP = Machine->IP + Instruction.Size;
+                if(!CanRunAsLanes(Instruction))
+                {
+                    RunInstructionByLane(Machine, Instruction, NextIP);
+                }
+                else if(IsLockstepBranch(Instruction.Op))
+                {
+                    RunBranchAsLanes(Machine, Instruction, NextIP);
+                }
+                else
+                {
+                    RunInstructionAsLanes(Machine, Instruction, NextIP);
+                }
+            }
+        }
+        else
+        {
+            StopActiveLanes(Machine, LockstepStop_End);
+        }
+    }
+}
@@ -0,0 +1,79 @@
+/* NOTE: Lockstep runs the same program on many 8086s at once, each with its own registers and memory
+   (so each can be given different data to work on). The registers are kept as structure-of-arrays, so that
+   each decoded instruction can be executed for 16 machines ("lanes") at a time with AVX2.
+
+   All the lanes that are at the same cs:ip run together. When a branch sends some lanes one way and some
+   the other, the lanes are split up, and from then on, the lanes with the lowest ip run first while the
+   others are masked off. Since loops branch backwards and the code after them is at higher addresses,
+   this tends to bring the lanes back together at the first instruction they all reach.
+
+   Each lane only has 64k of memory, so that thousands of lanes still fit. Addresses wrap at 64k, which
+   only matters for programs that set segment registers. The program's code is assumed to be the same in
+   every lane, so instructions are decoded from the first running lane's memory. */
+
+#define LOCKSTEP_LANE_WIDTH 16
+#define LOCKSTEP_MEMORY_POW2 16
+#define LOCKSTEP_MAX_LANE_COUNT (16*1024)
+
+enum lockstep_stop
+{
+    LockstepStop_None,
+    LockstepStop_End, // NOTE: cs:ip is past the end of the loaded program
+    LockstepStop_DecodeError,
+    LockstepStop_Unimplemented,
+    LockstepStop_Return, // NOTE: A ret was reached and the machine was asked to stop on those
+    
+    LockstepStop_Count,
+};
+
+struct lockstep_machine
+{
+    // NOTE: The per-lane arrays are padded out to a multiple of LOCKSTEP_LANE_WIDTH, and the lanes
+    // past LaneCount are never live.
+    u32 LaneCount;
+    u32 PaddedLaneCount;
+    
+    // NOTE: Registers[Reg][Lane]. Registers[0] is all zeroes, like register_state_8086's Zero.
+    u16 *Registers[Register_count];
+    
+    // NOTE: 0xffff for lanes that haven't stopped, and for the lanes running the current instruction.
+    u16 *Live;
+    u16 *Active;
+    u32 LiveCount;
+    u32 ActiveCount;
+    u8 *Stops;
+    
+    // NOTE: When every live lane is at cs:ip CS:IP, Converged is set and Active is the same as Live,
+    // so there is nothing to work out before running the next instruction.
+    b32 Converged;
+    u16 CS;
+    u16 IP;
+    
+    u8 *Memory;
+    u32 LaneMemorySize;
+    u32 OnePastLastByte;
+    b32 StopOnRet;
+    instruction_table Table;
+    
+    /* NOTE: Like lazy_flags, but with the operands and result of each lane. LazyCF is Flag_CF or 0,
+       since the result is only kept to 16 bits. Flags are only left lazy when every live lane ran the
+       instruction that set them, so there is only ever one pending operation for all of them. */
+    b32 EagerFlags;
+    lazy_flags_op LazyOp;
+    u32 LazyWWidth;
+    u16 *LazyV0;
+    u16 *LazyV1;
+    u16 *LazyR;
+    u16 *LazyCF;
+    
+    u64 StepCount;
+    u64 LaneInstructionCount;
+    u64 ScalarLaneInstructionCount; // NOTE: The ones that had to be run lane by lane through ExecInstruction
+};
+
+static lockstep_machine *CreateLockstepMachine(u32 LaneCount, segmented_access Image, u32 OnePastLastByte, b32 StopOnRet);
+static void FreeLockstepMachine(lockstep_machine *Machine);
+static void LoadLaneData(lockstep_machine *Machine, u8 *Data, u32 RecordSize, u32 Address);
+static segmented_access GetLaneMemory(lockstep_machine *Machine, u32 Lane);
+static void GetLaneRegisters(lockstep_machine *Machine, u32 Lane, register_state_8086 *Registers);
+static void RunLockstep(lockstep_machine *Machine);
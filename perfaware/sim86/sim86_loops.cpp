@@ -0,0 +1,285 @@
+static instruction_clock_interval LoopInstructionClocks(b32 Assume8088, instruction Instruction, b32 Taken)
+{
+    timing_state State = {};
+    State.Assume8088 = Assume8088;
+    State.AssumeBranchTaken = Taken;
+    
+    instruction_clock_interval Result = ExpectedClocksFrom(State, Instruction, EstimateInstructionClocks(State, Instruction));
+    return Result;
+}
+
+struct loop_accesses
+{
+    s32 Steps[Register_count];
+    u32 Counts[Register_count];
+    u32 Widths[Register_count]; // NOTE: A bit for each access width seen (1 and/or 2)
+};
+
+static void NoteElementAccess(loop_accesses *Accesses, register_index Index, u32 Width)
+{
+    if(Index)
+    {
+        ++Accesses->Counts[Index];
+        Accesses->Widths[Index] |= Width;
+    }
+}
+
+static void NoteRegisterSteps(instruction Instruction, loop_accesses *Accesses)
+{
+    // NOTE: Only steps by a constant count, since that is what walks through an array. String
+    // instructions step si and/or di by their width (the direction flag is assumed to be clear).
+    instruction_operand Dest = Instruction.Operands[0];
+    instruction_operand Source = Instruction.Operands[1];
+    if((Dest.Type == Operand_Register) && (Dest.Register.Count == 2))
+    {
+        register_index Index = Dest.Register.Index;
+        switch(Instruction.Op)
+        {
+            case Op_inc: {++Accesses->Steps[Index];} break;
+            case Op_dec: {--Accesses->Steps[Index];} break;
+            
+            case Op_add:
+            case Op_sub:
+            {
+                if(Source.Type == Operand_Immediate)
+                {
+                    Accesses->Steps[Index] += (Instruction.Op == Op_add) ? Source.Immediate.Value : -Source.Immediate.Value;
+                }
+            } break;
+            
+            default: {} break;
+        }
+    }
+    
+    if(!(Instruction.Flags & Inst_Rep))
+    {
+        u32 Width = (Instruction.Flags & Inst_Wide) ? 2 : 1;
+        b32 UsesSI = ((Instruction.Op == Op_lods) || (Instruction.Op == Op_movs) || (Instruction.Op == Op_cmps));
+        b32 UsesDI = ((Instruction.Op == Op_stos) || (Instruction.Op == Op_scas) ||
+                      (Instruction.Op == Op_movs) || (Instruction.Op == Op_cmps));
+        if(UsesSI)
+        {
+            Accesses->Steps[Register_si] += Width;
+            NoteElementAccess(Accesses, Register_si, Width);
+        }
+        if(UsesDI)
+        {
+            Accesses->Steps[Register_di] += Width;
+            NoteElementAccess(Accesses, Register_di, Width);
+        }
+    }
+}
+
+static void CountElements(loop_accesses *Accesses, loop_estimate *Loop)
+{
+    u32 Stride = 0;
+    u32 Widths = 0;
+    b32 Even = true;
+    for(u32 Index = 0; Index < Register_count; ++Index)
+    {
+        s32 Step = Accesses->Steps[Index];
+        if(Accesses->Counts[Index] && Step)
+        {
+            u32 Distance = (Step < 0) ? -Step : Step;
+            if(Stride && (Stride != Distance))
+            {
+                Even = false;
+            }
+            Stride = Distance;
+            Widths |= Accesses->Widths[Index];
+        }
+    }
+    
+    if(Even && Stride && ((Widths == 1) || (Widths == 2)))
+    {
+        u32 ElementSize = Widths;
+        for(u32 Index = 0; Index < Register_count; ++Index)
+        {
+            if(Accesses->Counts[Index] && Accesses->Steps[Index] && ((Accesses->Counts[Index]*ElementSize) != Stride))
+            {
+                Even = false;
+            }
+        }
+        
+        if(Even)
+        {
+            Loop->Stride = Stride;
+            Loop->ElementSize = ElementSize;
+            Loop->ElementsPerIteration = Stride / ElementSize;
+        }
+    }
+}
+
+static b32 EstimateLoop(instruction_table Table, segmented_access Memory, u32 Address, instruction BackEdge,
+                        loop_estimate *Loop)
+{
+    *Loop = {};
+    Loop->Address = Address;
+    Loop->BranchAddress = BackEdge.Address;
+    Loop->OnePastLastAddress = BackEdge.Address + BackEdge.Size;
+    
+    loop_accesses Accesses = {};
+    
+    u32 At = Address;
+    u32 LastAddress = At;
+    while(At < Loop->OnePastLastAddress)
+    {
+        instruction Instruction = DecodeInstruction(Table, AtBlockAddress(Memory, At));
+        if(!Instruction.Op)
+        {
+            break;
+        }
+        
+        b32 Taken = (At == BackEdge.Address);
+        for(u32 Model = 0; Model < ArrayCount(Loop->Clocks); ++Model)
+        {
+            instruction_clock_interval Clocks = LoopInstructionClocks(Model, Instruction, Taken);
+            Loop->Clocks[Model].Min += Clocks.Min;
+            Loop->Clocks[Model].Max += Clocks.Max;
+        }
+        
+        // NOTE: Any other jump back to somewhere in the body is the back-edge of an inner loop.
+        control_flow Flow = GetControlFlow(Instruction.Op);
+        u32 Target = 0;
+        if(!Taken && ((Flow == Flow_Conditional) || (Flow == Flow_Jump)) &&
+           GetDirectTarget(Instruction, 0, &Target) && (Target >= Address) && (Target <= At))
+        {
+            Loop->Nested = true;
+        }
+        
+        u32 Width = (Instruction.Flags & Inst_Wide) ? 2 : 1;
+        for(u32 OperandIndex = 0; OperandIndex < ArrayCount(Instruction.Operands); ++OperandIndex)
+        {
+            instruction_operand Operand = Instruction.Operands[OperandIndex];
+            if(Operand.Type == Operand_Memory)
+            {
+                for(u32 TermIndex = 0; TermIndex < ArrayCount(Operand.Address.Terms); ++TermIndex)
+                {
+                    NoteElementAccess(&Accesses, Operand.Address.Terms[TermIndex].Register.Index, Width);
+                }
+            }
+        }
+        NoteRegisterSteps(Instruction, &Accesses);
+        
+        ++Loop->InstructionCount;
+        LastAddress = At;
+        At += Instruction.Size;
+    }
+    
+    CountElements(&Accesses, Loop);
+    
+    // NOTE: If the target is in the middle of an instruction, decoding from it might never line back up
+    // with the back-edge, in which case this isn't a loop that can be timed.
+    b32 Result = ((At == Loop->OnePastLastAddress) && (LastAddress == BackEdge.Address));
+    return Result;
+}
+
+static void PrintLoopClocks(char const *Name, instruction_clock_interval Clocks, u32 ElementsPerIteration, FILE *Out)
+{
+    fprintf(Out, "; %s: ", Name);
+    PrintClockInterval(Clocks, Out);
+    fprintf(Out, " clocks/iteration");
+    if(ElementsPerIteration)
+    {
+        double Min = (double)Clocks.Min / (double)ElementsPerIteration;
+        double Max = (double)Clocks.Max / (double)ElementsPerIteration;
+        if(Clocks.Min != Clocks.Max)
+        {
+            fprintf(Out, ", [%.2f,%.2f] clocks/element", Min, Max);
+        }
+        else
+        {
+            fprintf(Out, ", %.2f clocks/element", Min);
+        }
+    }
+    fprintf(Out, "\n");
+}
+
+static void PrintLoop(instruction_table Table, segmented_access Memory, loop_estimate *Loop, instruction BackEdge, FILE *Out)
+{
+    fprintf(Out, "; loop 0x%05x-0x%05x: %u instructions, back-edge %s at 0x%05x\n", Loop->Address,
+            Loop->OnePastLastAddress, Loop->InstructionCount, GetMnemonic(BackEdge.Op), Loop->BranchAddress);
+    if(Loop->ElementsPerIteration && !Loop->Nested)
+    {
+        fprintf(Out, "; stride %u, %u byte elements, %u elements/iteration\n",
+                Loop->Stride, Loop->ElementSize, Loop->ElementsPerIteration);
+    }
+    
+    u32 At = Loop->Address;
+    while(At < Loop->OnePastLastAddress)
+    {
+        instruction Instruction = DecodeInstruction(Table, AtBlockAddress(Memory, At));
+        b32 Taken = (At == Loop->BranchAddress);
+        
+        PrintInstruction(Instruction, Out);
+        fprintf(Out, " ; 8086: ");
+        PrintClockInterval(LoopInstructionClocks(false, Instruction, Taken), Out);
+        fprintf(Out, ", 8088: ");
+        PrintClockInterval(LoopInstructionClocks(true, Instruction, Taken), Out);
+        fprintf(Out, "\n");
+        
+        At += Instruction.Size;
+    }
+    
+    if(Loop->Nested)
+    {
+        fprintf(Out, "; contains an inner loop, so there is no total per iteration\n");
+    }
+    else
+    {
+        PrintLoopClocks("8086", Loop->Clocks[0], Loop->ElementsPerIteration, Out);
+        PrintLoopClocks("8088", Loop->Clocks[1], Loop->ElementsPerIteration, Out);
+    }
+    fprintf(Out, "\n");
+}
+
+static void AnalyzeLoops8086(u32 ByteCount, segmented_access Memory, FILE *Out)
+{
+    instruction_table Table = Get8086InstructionTable();
+    
+    // NOTE: Back-edges are found by disassembling the same way DisAsm8086 does, straight through
+    // from the start of the image.
+    u32 LoopCount = 0;
+    u32 Address = 0;
+    while(Address < ByteCount)
+    {
+        instruction Instruction = DecodeInstruction(Table, AtBlockAddress(Memory, Address));
+        if(!Instruction.Op)
+        {
+            fprintf(stderr, "ERROR: Unrecognized binary in instruction stream.\n");
+            break;
+        }
+        
+        if((Address + Instruction.Size) > ByteCount)
+        {
+            fprintf(stderr, "ERROR: Instruction extends outside disassembly region\n");
+            break;
+        }
+        
+        u32 Target = 0;
+        if((GetControlFlow(Instruction.Op) == Flow_Conditional) &&
+           GetDirectTarget(Instruction, 0, &Target) &&
+           (Target <= Address))
+        {
+            loop_estimate Loop;
+            if(EstimateLoop(Table, Memory, Target, Instruction, &Loop))
+            {
+                PrintLoop(Table, Memory, &Loop, Instruction, Out);
+            }
+            else
+            {
+                fprintf(Out, "; 0x%05x: %s back to 0x%05x does not decode as a loop\n\n",
+                        Address, GetMnemonic(Instruction.Op), Target);
+            }
+            
+            ++LoopCount;
+        }
+        
+        Address += Instruction.Size;
+    }
+    
+    if(!LoopCount)
+    {
+        fprintf(Out, "; no loops found\n");
+    }
+}
@@ -0,0 +1,30 @@
+/* NOTE: -loops estimates how long each loop in a program takes per iteration, without running it.
+   A loop is any conditional jump (including loop, loopz and loopnz) that goes backwards, and its body is
+   everything from the jump's target up to and including the jump. Each iteration is timed as one pass
+   through the body with the back-edge taken and every other branch in it not taken, using the manual's
+   clocks for both the 8086 and the 8088.
+
+   Since that is all there is to go on, rep counts and shift counts in cl are taken to be 0. A loop with
+   another back-edge inside it has an inner loop whose iteration count can't be known, so it gets no total. */
+
+struct loop_estimate
+{
+    u32 Address;
+    u32 BranchAddress;
+    u32 OnePastLastAddress;
+    u32 InstructionCount;
+    
+    b32 Nested;
+    instruction_clock_interval Clocks[2]; // NOTE: Per iteration, on the 8086 and then on the 8088
+    
+    /* NOTE: Elements are only counted when the loop walks through its data evenly: every address
+       register that steps at all steps by the same Stride, every access through them is ElementSize bytes,
+       and each of them is used for exactly Stride / ElementSize accesses. Otherwise ElementsPerIteration is 0. */
+    u32 Stride;
+    u32 ElementSize;
+    u32 ElementsPerIteration;
+};
+
+static b32 EstimateLoop(instruction_table Table, segmented_access Memory, u32 Address, instruction BackEdge,
+                        loop_estimate *Loop);
+static void AnalyzeLoops8086(u32 ByteCount, segmented_access Memory, FILE *Out);
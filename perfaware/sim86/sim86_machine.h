@@ -0,0 +1,48 @@
+// NOTE: A machine is an 8086 with 1mb of memory that can be run from another program.
+// It is opaque, so it can only be used through the Sim86_ calls in sim86_lib.h.
+typedef struct sim86_machine sim86_machine;
+typedef struct sim86_registers sim86_registers;
+typedef struct sim86_clocks sim86_clocks;
+
+typedef enum sim86_machine_flag : u32
+{
+    Sim86Machine_StopOnRet = 0x1, // NOTE: Stop before executing ret or retf, like sim86 -stoponret
+    Sim86Machine_Assume8088 = 0x2, // NOTE: Estimate clocks for the 8088 instead of the 8086
+} sim86_machine_flag;
+
+typedef enum sim86_stop : u32
+{
+    Sim86Stop_None, // NOTE: The machine can keep running (Sim86_Run just hit its step limit)
+    Sim86Stop_End, // NOTE: cs:ip is past the end of the loaded image
+    Sim86Stop_DecodeError,
+    Sim86Stop_Unimplemented, // NOTE: The instruction at cs:ip decodes, but can't be executed
+    Sim86Stop_Return, // NOTE: The instruction at cs:ip is a return, and Sim86Machine_StopOnRet was set
+} sim86_stop;
+
+struct sim86_registers
+{
+    // NOTE: These are in register_access Index order, so (&Zero)[Index] is the register an
+    // operand refers to. Zero is always zero.
+    u16 Zero;
+    u16 ax;
+    u16 bx;
+    u16 cx;
+    u16 dx;
+    u16 sp;
+    u16 bp;
+    u16 si;
+    u16 di;
+    u16 es;
+    u16 cs;
+    u16 ss;
+    u16 ds;
+    u16 ip;
+    u16 flags;
+};
+
+struct sim86_clocks
+{
+    u64 InstructionCount;
+    u64 Min;
+    u64 Max;
+};
@@ -49,6 +49,178 @@ static u8 *AccessMemory(segmented_access SegMem, u16 Offset)
     return Result;
 }
 
+static u8 *AccessContiguousMemory(segmented_access SegMem, u16 Offset, u32 Count)
+{
+    /* NOTE: Returns where the Count bytes starting at Offset are, if they are one contiguous piece of
+       host memory, so they can be read or written all at once. Otherwise returns 0, and they have to be
+       accessed a byte at a time. They are contiguous as long as the offsets don't wrap around the segment,
+       and either the addresses don't wrap around the end of memory, or the memory is mirrored right after
+       itself so that it looks like they don't. */
+    u8 *Result = 0;
+    
+    u32 Size = SegMem.Mask + 1;
+    if(((u32)(u16)(SegMem.SegmentOffset + Offset) + Count) <= 0x10000)
+    {
+        u32 AbsAddr = GetAbsoluteAddressOf(SegMem, Offset);
+        if(((AbsAddr + Count) <= Size) ||
+           ((SegMem.MirrorSize == Size) && (Count <= Size)))
+        {
+            Result = SegMem.Memory + AbsAddr;
+        }
+    }
+    
+    return Result;
+}
+
+static void SetWatch(memory_watch *Watch, u32 AbsAddr, b32 Watched)
+{
+    u32 BitIndex = AbsAddr % (8*ArrayCount(Watch->Bits));
+    u8 Bit = (u8)(1 << (BitIndex % 8));
+    if(Watched)
+    {
+        Watch->Bits[BitIndex / 8] |= Bit;
+    }
+    else
+    {
+        Watch->Bits[BitIndex / 8] &= ~Bit;
+    }
+}
+
+static b32 IsWatched(memory_watch *Watch, u32 AbsAddr)
+{
+    u32 BitIndex = AbsAddr % (8*ArrayCount(Watch->Bits));
+    b32 Result = (Watch->Bits[BitIndex / 8] >> (BitIndex % 8)) & 1;
+    return Result;
+}
+
+static void LogWrite(memory_write_log *Log, u32 AbsAddr)
+{
+    memory_write_run *Last = Log->RunCount ? (Log->Runs + Log->RunCount - 1) : 0;
+    if(Last && ((AbsAddr - Last->Address) < Last->Count))
+    {
+        // NOTE: Already covered
+    }
+    else if(Last && (AbsAddr == (Last->Address + Last->Count)))
+    {
+        ++Last->Count;
+    }
+    else if(Last && ((AbsAddr + 1) == Last->Address))
+    {
+        --Last->Address;
+        ++Last->Count;
+    }
+    else if(Log->RunCount < ArrayCount(Log->Runs))
+    {
+        Last = Log->Runs + Log->RunCount++;
+        Last->Address = AbsAddr;
+        Last->Count = 1;
+    }
+    else
+    {
+        Log->Overflowed = true;
+        Last = 0;
+    }
+    
+    // NOTE: Word writes going down through memory (like std; rep movsw) extend the last run upward
+    // into the one before it, so the two are joined back together here.
+    if(Last && (Log->RunCount >= 2))
+    {
+        memory_write_run *Prev = Last - 1;
+        if((Last->Address + Last->Count) == Prev->Address)
+        {
+            Prev->Address = Last->Address;
+            Prev->Count += Last->Count;
+            --Log->RunCount;
+        }
+    }
+}
+
+static void MarkPagesDirty(dirty_pages *Dirty, u32 AbsAddr, u32 Count)
+{
+    if(Count)
+    {
+        u32 FirstPage = AbsAddr >> MEMORY_PAGE_SHIFT;
+        u32 PageCount = (((AbsAddr + Count - 1) >> MEMORY_PAGE_SHIFT) - FirstPage) + 1;
+        for(u32 PageIndex = 0; PageIndex < PageCount; ++PageIndex)
+        {
+            // NOTE: Wraps around at the end of the address space, the same way addresses do.
+            u32 Page = (FirstPage + PageIndex) % MEMORY_PAGE_COUNT;
+            Dirty->Bits[Page / 64] |= (1ull << (Page % 64));
+        }
+    }
+}
+
+static b32 IsPageDirty(dirty_pages *Dirty, u32 PageIndex)
+{
+    b32 Result = (Dirty->Bits[PageIndex / 64] >> (PageIndex % 64)) & 1;
+    return Result;
+}
+
+static void ClearDirtyPages(dirty_pages *Dirty)
+{
+    for(u32 Index = 0; Index < ArrayCount(Dirty->Bits); ++Index)
+    {
+        Dirty->Bits[Index] = 0;
+    }
+}
+
+static void NoteWrite(segmented_access SegMem, u16 Offset)
+{
+    if(SegMem.Dirty)
+    {
+        MarkPagesDirty(SegMem.Dirty, GetAbsoluteAddressOf(SegMem, Offset), 1);
+    }
+    
+    if(SegMem.WriteLog)
+    {
+        LogWrite(SegMem.WriteLog, GetAbsoluteAddressOf(SegMem, Offset));
+    }
+    
+    memory_watch *Watch = SegMem.Watch;
+    if(Watch)
+    {
+        u32 AbsAddr = GetAbsoluteAddressOf(SegMem, Offset);
+        if(IsWatched(Watch, AbsAddr))
+        {
+            if(Watch->HitCount < ArrayCount(Watch->Hits))
+            {
+                Watch->Hits[Watch->HitCount++] = AbsAddr;
+            }
+            else
+            {
+                Watch->Overflowed = true;
+            }
+        }
+    }
+}
+
+static void NoteWrites(segmented_access SegMem, u16 Offset, u32 Count)
+{
+    // NOTE: For bulk writes that went straight to memory without going through WriteU8.
+    if(SegMem.Watch || SegMem.WriteLog)
+    {
+        for(u32 Index = 0; Index < Count; ++Index)
+        {
+            NoteWrite(SegMem, (u16)(Offset + Index));
+        }
+    }
+    else if(SegMem.Dirty)
+    {
+        // NOTE: One page at a time, since the offset can wrap around within the segment and the
+        // address can wrap around the end of memory partway through.
+        u32 Index = 0;
+        while(Index < Count)
+        {
+            u32 SegmentLeft = 0x10000 - (u16)(SegMem.SegmentOffset + Offset + Index);
+            u32 AbsAddr = GetAbsoluteAddressOf(SegMem, (u16)(Offset + Index));
+            u32 PageLeft = MEMORY_PAGE_SIZE - (AbsAddr % MEMORY_PAGE_SIZE);
+            
+            MarkPagesDirty(SegMem.Dirty, AbsAddr, 1);
+            Index += (PageLeft < SegmentLeft) ? PageLeft : SegmentLeft;
+        }
+    }
+}
+
 static b32 IsValid(segmented_access SegMem)
 {
     b32 Result = (SegMem.Mask != 0);
@@ -10,12 +10,59 @@
    
    ======================================================================== */
 
+struct memory_watch
+{
+    // NOTE: One bit per byte of the 8086's 1mb address space. Writes to bytes whose bit is set
+    // are logged in Hits, so that whoever is watching them (like the decoded instruction cache) can
+    // deal with them after the fact. If more writes hit than there is room to log, Overflowed is set
+    // and the watcher has to assume everything it was watching changed.
+    u8 Bits[(1 << 20) / 8];
+    
+    b32 Overflowed;
+    u32 HitCount;
+    u32 Hits[16];
+};
+
+#define MEMORY_PAGE_SHIFT 12
+#define MEMORY_PAGE_SIZE (1 << MEMORY_PAGE_SHIFT)
+#define MEMORY_PAGE_COUNT ((1 << 20) >> MEMORY_PAGE_SHIFT)
+
+struct dirty_pages
+{
+    // NOTE: One bit per 4k page of the 8086's 1mb address space, set when anything writes to the page.
+    u64 Bits[MEMORY_PAGE_COUNT / 64];
+};
+
+#define MEMORY_WRITE_LOG_RUNS 32
+
+struct memory_write_run
+{
+    u32 Address;
+    u32 Count;
+};
+
+struct memory_write_log
+{
+    // NOTE: Every write, as runs of contiguous absolute addresses. Writes that extend the last run
+    // (in either direction) are merged into it, so string instructions only use one run no matter how many
+    // bytes they write. If there are more runs than fit, Overflowed is set and the rest are dropped.
+    b32 Overflowed;
+    u32 RunCount;
+    memory_write_run Runs[MEMORY_WRITE_LOG_RUNS];
+};
+
 struct segmented_access
 {
     u8 *Memory;
     u32 Mask;
     u16 SegmentBase;
     u16 SegmentOffset;
+    
+    memory_watch *Watch; // NOTE: Optional, only set for memory someone wants to know about writes to
+    memory_write_log *WriteLog; // NOTE: Optional, only set when every write needs to be recorded
+    dirty_pages *Dirty; // NOTE: Optional, only set when someone needs to know which pages were written
+    
+    u32 MirrorSize; // NOTE: Optional, only set when Memory[MirrorSize + i] is the same byte as Memory[i] (see AllocateMirroredMemory)
 };
 
 static u32 GetHighestAddress(segmented_access SegMem);
@@ -23,6 +70,17 @@ static u32 GetAbsoluteAddressOf(segmented_access SegMem, u16 Offset = 0);
 static segmented_access MoveBaseBy(segmented_access Access, s32 Offset);
 
 static u8 *AccessMemory(segmented_access SegMem, u16 Offset = 0);
+static u8 *AccessContiguousMemory(segmented_access SegMem, u16 Offset, u32 Count);
+
+static void SetWatch(memory_watch *Watch, u32 AbsAddr, b32 Watched);
+static b32 IsWatched(memory_watch *Watch, u32 AbsAddr);
+static void NoteWrite(segmented_access SegMem, u16 Offset);
+static void NoteWrites(segmented_access SegMem, u16 Offset, u32 Count);
+static void LogWrite(memory_write_log *Log, u32 AbsAddr);
+
+static void MarkPagesDirty(dirty_pages *Dirty, u32 AbsAddr, u32 Count);
+static b32 IsPageDirty(dirty_pages *Dirty, u32 PageIndex);
+static void ClearDirtyPages(dirty_pages *Dirty);
 
 static b32 IsValid(segmented_access SegMem);
 static segmented_access FixedMemoryPow2(u32 SizePow2, u8 *Memory);
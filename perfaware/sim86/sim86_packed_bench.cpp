@@ -0,0 +1,214 @@
+/* NOTE: This is a small standalone benchmark comparing a decoded instruction
+   stream stored as "instruction" versus "packed_instruction". It decodes the files
+   given on the command line (repeating them until the requested number of
+   instructions is reached), then reports the memory footprint of each
+   representation and how fast each can be iterated, both when only reading
+   the common fields and when every packed instruction has to be unpacked.
+
+   Usage: sim86_packed_bench [-count N] [-repeat N] file...
+*/
+
+#include "sim86.h"
+
+typedef double f64;
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "sim86_instruction.h"
+#include "sim86_instruction_table.h"
+#include "sim86_memory.h"
+#include "sim86_decode.h"
+
+#include "sim86_instruction.cpp"
+#include "sim86_instruction_table.cpp"
+#include "sim86_memory.cpp"
+#include "sim86_decode.cpp"
+
+#include "../part2/listing_0074_platform_metrics.cpp"
+
+struct bench_result
+{
+    u64 MinTime;
+    u64 TotalTime;
+    u64 Checksum;
+};
+
+static u64 SumFields(u32 Count, instruction *Instructions)
+{
+    u64 Result = 0;
+    for(u32 Index = 0; Index < Count; ++Index)
+    {
+        instruction *Instruction = Instructions + Index;
+        Result += Instruction->Address + Instruction->Size + Instruction->Op + Instruction->Operands[0].Type;
+    }
+    
+    return Result;
+}
+
+static u64 SumFields(u32 Count, packed_instruction *Instructions)
+{
+    u64 Result = 0;
+    for(u32 Index = 0; Index < Count; ++Index)
+    {
+        packed_instruction *Instruction = Instructions + Index;
+        Result += Instruction->Address + GetPackedSize(*Instruction) + Instruction->Op +
+            (Instruction->OperandInfo & PackedOperand_TypeMask);
+    }
+    
+    return Result;
+}
+
+static u64 SumUnpacked(u32 Count, packed_instruction *Instructions)
+{
+    u64 Result = 0;
+    for(u32 Index = 0; Index < Count; ++Index)
+    {
+        instruction Instruction = UnpackInstruction(Instructions[Index]);
+        Result += Instruction.Address + Instruction.Size + Instruction.Op + Instruction.Operands[0].Type;
+    }
+    
+    return Result;
+}
+
+static void PrintResult(char const *Label, bench_result Bench, u32 RepeatCount, u32 Count, u64 Bytes, u64 CPUFreq)
+{
+    f64 MinSeconds = (f64)Bench.MinTime / (f64)CPUFreq;
+    f64 MeanSeconds = ((f64)Bench.TotalTime / (f64)RepeatCount) / (f64)CPUFreq;
+    printf("%-24s min %8.3fms (%6.2f cycles/inst, %8.2f MB/s)  mean %8.3fms  [checksum %llu]\n", Label,
+           1000.0*MinSeconds, (f64)Bench.MinTime / (f64)Count, ((f64)Bytes / (1024.0*1024.0)) / MinSeconds,
+           1000.0*MeanSeconds, (unsigned long long)Bench.Checksum);
+}
+
+#define TIME_PASS(Result, Expression) \
+    { \
+        u64 Start = ReadCPUTimer(); \
+        (Result).Checksum = (Expression); \
+        u64 Elapsed = ReadCPUTimer() - Start; \
+        (Result).TotalTime += Elapsed; \
+        if(Elapsed < (Result).MinTime) (Result).MinTime = Elapsed; \
+    }
+
+int main(int ArgCount, char **Args)
+{
+    u32 TargetCount = 1 << 21;
+    u32 RepeatCount = 10;
+    
+    u32 FirstFile = 1;
+    for(; FirstFile < (u32)ArgCount; ++FirstFile)
+    {
+        char *Arg = Args[FirstFile];
+        if((strcmp(Arg, "-count") == 0) && ((FirstFile + 1) < (u32)ArgCount))
+        {
+            TargetCount = (u32)atoi(Args[++FirstFile]);
+        }
+        else if((strcmp(Arg, "-repeat") == 0) && ((FirstFile + 1) < (u32)ArgCount))
+        {
+            RepeatCount = (u32)atoi(Args[++FirstFile]);
+        }
+        else
+        {
+            break;
+        }
+    }
+    
+    if((FirstFile >= (u32)ArgCount) || !TargetCount || !RepeatCount)
+    {
+        fprintf(stderr, "USAGE: %s [-count N] [-repeat N] [8086 machine code file] ...\n", Args[0]);
+        return 1;
+    }
+    
+    u8 *Memory = (u8 *)calloc(1, 1024*1024);
+    instruction *Instructions = (instruction *)malloc(TargetCount*sizeof(instruction));
+    packed_instruction *Packed = (packed_instruction *)malloc(TargetCount*sizeof(packed_instruction));
+    if(!Memory || !Instructions || !Packed)
+    {
+        fprintf(stderr, "ERROR: Unable to allocate space for %u instructions.\n", TargetCount);
+        return 1;
+    }
+    
+    // NOTE: Decode the files round-robin until we have enough instructions.
+    instruction_table Table = Get8086InstructionTable();
+    u32 Count = 0;
+    b32 AnyDecoded = true;
+    while((Count < TargetCount) && AnyDecoded)
+    {
+        AnyDecoded = false;
+        for(u32 FileIndex = FirstFile; (FileIndex < (u32)ArgCount) && (Count < TargetCount); ++FileIndex)
+        {
+            segmented_access At = FixedMemoryPow2(20, Memory);
+            memset(Memory, 0, 1024*1024);
+            
+            u32 ByteCount = 0;
+            FILE *File = fopen(Args[FileIndex], "rb");
+            if(File)
+            {
+                ByteCount = (u32)fread(Memory, 1, 1024*1024 - 16, File);
+                fclose(File);
+            }
+            else
+            {
+                fprintf(stderr, "ERROR: Unable to open %s.\n", Args[FileIndex]);
+            }
+            
+            u32 Offset = 0;
+            while((Offset < ByteCount) && (Count < TargetCount))
+            {
+                At.SegmentOffset = (u16)Offset;
+                instruction Instruction = DecodeInstruction(Table, At);
+                if(Instruction.Op && PackInstruction(Instruction, &Packed[Count]))
+                {
+                    Instructions[Count++] = Instruction;
+                    Offset += Instruction.Size;
+                    AnyDecoded = true;
+                }
+                else
+                {
+                    ++Offset;
+                }
+            }
+        }
+    }
+    
+    if(!Count)
+    {
+        fprintf(stderr, "ERROR: No instructions decoded.\n");
+        return 1;
+    }
+    
+    u64 CPUFreq = EstimateCPUTimerFreq();
+    u64 UnpackedBytes = (u64)Count*sizeof(instruction);
+    u64 PackedBytes = (u64)Count*sizeof(packed_instruction);
+    
+    printf("Instructions: %u\n", Count);
+    printf("instruction:        %3u bytes each, %10llu bytes total\n", (u32)sizeof(instruction), (unsigned long long)UnpackedBytes);
+    printf("packed_instruction: %3u bytes each, %10llu bytes total (%.2fx smaller)\n", (u32)sizeof(packed_instruction),
+           (unsigned long long)PackedBytes, (f64)UnpackedBytes / (f64)PackedBytes);
+    printf("CPU timer: %llu Hz estimated, %u repeats\n\n", (unsigned long long)CPUFreq, RepeatCount);
+    
+    bench_result UnpackedFields = {~0ull};
+    bench_result PackedFields = {~0ull};
+    bench_result PackedUnpack = {~0ull};
+    for(u32 Repeat = 0; Repeat < RepeatCount; ++Repeat)
+    {
+        TIME_PASS(UnpackedFields, SumFields(Count, Instructions));
+        TIME_PASS(PackedFields, SumFields(Count, Packed));
+        TIME_PASS(PackedUnpack, SumUnpacked(Count, Packed));
+    }
+    
+    PrintResult("instruction fields", UnpackedFields, RepeatCount, Count, UnpackedBytes, CPUFreq);
+    PrintResult("packed fields", PackedFields, RepeatCount, Count, PackedBytes, CPUFreq);
+    PrintResult("packed full unpack", PackedUnpack, RepeatCount, Count, PackedBytes, CPUFreq);
+    
+    if((UnpackedFields.Checksum != PackedFields.Checksum) || (UnpackedFields.Checksum != PackedUnpack.Checksum))
+    {
+        fprintf(stderr, "ERROR: Packed and unpacked checksums differ.\n");
+        return 1;
+    }
+    
+    return 0;
+}
@@ -0,0 +1,411 @@
+struct thread_start
+{
+    thread_proc *Proc;
+    void *Param;
+    u32 ThreadIndex;
+};
+
+#define MAX_THREAD_COUNT 256
+
+#if _WIN32
+
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+
+static u32 GetProcessorCount(void)
+{
+    SYSTEM_INFO Info;
+    GetSystemInfo(&Info);
+    
+    u32 Result = Info.dwNumberOfProcessors;
+    return Result;
+}
+
+static u64 GetOSTimerFreq(void)
+{
+    LARGE_INTEGER Freq;
+    QueryPerformanceFrequency(&Freq);
+    return Freq.QuadPart;
+}
+
+static u64 ReadOSTimer(void)
+{
+    LARGE_INTEGER Value;
+    QueryPerformanceCounter(&Value);
+    return Value.QuadPart;
+}
+
+static DWORD WINAPI ThreadEntry(LPVOID Param)
+{
+    thread_start *Start = (thread_start *)Param;
+    Start->Proc(Start->Param, Start->ThreadIndex);
+    return 0;
+}
+
+static void RunOnThreads(u32 ThreadCount, thread_proc *Proc, void *Param)
+{
+    thread_start Starts[MAX_THREAD_COUNT];
+    HANDLE Threads[MAX_THREAD_COUNT];
+    
+    if(ThreadCount > MAX_THREAD_COUNT)
+    {
+        ThreadCount = MAX_THREAD_COUNT;
+    }
+    
+    // NOTE: The calling thread does the work for index 0, so a thread count of 1 never makes a thread.
+    for(u32 ThreadIndex = 1; ThreadIndex < ThreadCount; ++ThreadIndex)
+    {
+        Starts[ThreadIndex] = {Proc, Param, ThreadIndex};
+        Threads[ThreadIndex] = CreateThread(0, 0, ThreadEntry, &Starts[ThreadIndex], 0, 0);
+    }
+    
+    Proc(Param, 0);
+    
+    for(u32 ThreadIndex = 1; ThreadIndex < ThreadCount; ++ThreadIndex)
+    {
+        if(Threads[ThreadIndex])
+        {
+            WaitForSingleObject(Threads[ThreadIndex], INFINITE);
+            CloseHandle(Threads[ThreadIndex]);
+        }
+        else
+        {
+            // NOTE: If the OS wouldn't give us the thread, its share of the work still has to get done.
+            Proc(Param, ThreadIndex);
+        }
+    }
+}
+
+static mapped_file MapFileForRead(char *FileName, u32 Padding)
+{
+    mapped_file Result = {};
+    
+    HANDLE File = CreateFileA(FileName, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+    if(File != INVALID_HANDLE_VALUE)
+    {
+        LARGE_INTEGER Size;
+        if(GetFileSizeEx(File, &Size) && ((u64)Size.QuadPart <= (0xffffffffull - Padding)))
+        {
+            SYSTEM_INFO Info;
+            GetSystemInfo(&Info);
+            
+            u64 PageSize = Info.dwPageSize;
+            u64 ByteCount = (u64)Size.QuadPart;
+            u64 PageAlignedSize = (ByteCount + PageSize - 1) & ~(PageSize - 1);
+            
+            // NOTE: Windows zero-fills the part of the last page of a view that is past the end of the
+            // file, but it can't put zero pages after the view the way mmap can on other OSes. So the file is
+            // only mapped if the end of its last page has room for the padding, and read into memory otherwise.
+            if(ByteCount && ((PageAlignedSize - ByteCount) >= Padding))
+            {
+                HANDLE Mapping = CreateFileMappingA(File, 0, PAGE_READONLY, 0, 0, 0);
+                if(Mapping)
+                {
+                    Result.Data = (u8 *)MapViewOfFile(Mapping, FILE_MAP_READ, 0, 0, 0);
+                    if(Result.Data)
+                    {
+                        Result.ByteCount = (u32)ByteCount;
+                        Result.MappedSize = (size_t)PageAlignedSize;
+                        Result.Mapping = Mapping;
+                    }
+                    else
+                    {
+                        CloseHandle(Mapping);
+                    }
+                }
+            }
+            
+            if(!Result.Data)
+            {
+                Result.Data = (u8 *)VirtualAlloc(0, (size_t)(ByteCount + Padding), MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+                if(Result.Data)
+                {
+                    Result.IsCopy = true;
+                    Result.MappedSize = (size_t)(ByteCount + Padding);
+                    
+                    DWORD BytesRead = 0;
+                    if(ByteCount && !ReadFile(File, Result.Data, (DWORD)ByteCount, &BytesRead, 0))
+                    {
+                        BytesRead = 0;
+                    }
+                    Result.ByteCount = BytesRead;
+                }
+            }
+        }
+        
+        CloseHandle(File);
+    }
+    
+    return Result;
+}
+
+static void UnmapFile(mapped_file *File)
+{
+    if(File->Data)
+    {
+        if(File->IsCopy)
+        {
+            VirtualFree(File->Data, 0, MEM_RELEASE);
+        }
+        else
+        {
+            UnmapViewOfFile(File->Data);
+            CloseHandle((HANDLE)File->Mapping);
+        }
+    }
+    
+    *File = {};
+}
+
+static u8 *AllocateMirroredMemory(u32 Size)
+{
+    /* NOTE: Without VirtualAlloc2, two views can't be asked for at adjacent addresses directly. So
+       this finds a free range big enough for both, releases it, and maps the views into it. Another thread
+       can take the range in between, in which case it just tries again somewhere else. */
+    u8 *Result = 0;
+    
+    HANDLE Section = CreateFileMappingA(INVALID_HANDLE_VALUE, 0, PAGE_READWRITE, 0, Size, 0);
+    if(Section)
+    {
+        for(u32 Attempt = 0; !Result && (Attempt < 16); ++Attempt)
+        {
+            u8 *Base = (u8 *)VirtualAlloc(0, 2*(SIZE_T)Size, MEM_RESERVE, PAGE_NOACCESS);
+            if(Base)
+            {
+                VirtualFree(Base, 0, MEM_RELEASE);
+                
+                void *View0 = MapViewOfFileEx(Section, FILE_MAP_ALL_ACCESS, 0, 0, Size, Base);
+                void *View1 = MapViewOfFileEx(Section, FILE_MAP_ALL_ACCESS, 0, 0, Size, Base + Size);
+                if((View0 == Base) && (View1 == (Base + Size)))
+                {
+                    Result = Base;
+                }
+                else
+                {
+                    if(View0) UnmapViewOfFile(View0);
+                    if(View1) UnmapViewOfFile(View1);
+                }
+            }
+        }
+        
+        // NOTE: The views keep the memory alive on their own.
+        CloseHandle(Section);
+    }
+    
+    return Result;
+}
+
+static void FreeMirroredMemory(u8 *Memory, u32 Size)
+{
+    if(Memory)
+    {
+        UnmapViewOfFile(Memory);
+        UnmapViewOfFile(Memory + Size);
+    }
+}
+
+static u8 *AllocateExecutableMemory(u32 Size)
+{
+    u8 *Result = (u8 *)VirtualAlloc(0, Size, MEM_RESERVE|MEM_COMMIT, PAGE_EXECUTE_READWRITE);
+    return Result;
+}
+
+static void FreeExecutableMemory(u8 *Memory, u32 Size)
+{
+    if(Memory)
+    {
+        VirtualFree(Memory, 0, MEM_RELEASE);
+    }
+}
+
+#else
+
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+static u32 GetProcessorCount(void)
+{
+    long Count = sysconf(_SC_NPROCESSORS_ONLN);
+    
+    u32 Result = (Count > 0) ? (u32)Count : 1;
+    return Result;
+}
+
+static u64 GetOSTimerFreq(void)
+{
+    return 1000000;
+}
+
+static u64 ReadOSTimer(void)
+{
+    struct timeval Value;
+    gettimeofday(&Value, 0);
+    
+    u64 Result = GetOSTimerFreq()*(u64)Value.tv_sec + (u64)Value.tv_usec;
+    return Result;
+}
+
+static void *ThreadEntry(void *Param)
+{
+    thread_start *Start = (thread_start *)Param;
+    Start->Proc(Start->Param, Start->ThreadIndex);
+    return 0;
+}
+
+static void RunOnThreads(u32 ThreadCount, thread_proc *Proc, void *Param)
+{
+    thread_start Starts[MAX_THREAD_COUNT];
+    pthread_t Threads[MAX_THREAD_COUNT];
+    b32 Started[MAX_THREAD_COUNT];
+    
+    if(ThreadCount > MAX_THREAD_COUNT)
+    {
+        ThreadCount = MAX_THREAD_COUNT;
+    }
+    
+    // NOTE: The calling thread does the work for index 0, so a thread count of 1 never makes a thread.
+    for(u32 ThreadIndex = 1; ThreadIndex < ThreadCount; ++ThreadIndex)
+    {
+        Starts[ThreadIndex] = {Proc, Param, ThreadIndex};
+        Started[ThreadIndex] = (pthread_create(&Threads[ThreadIndex], 0, ThreadEntry, &Starts[ThreadIndex]) == 0);
+    }
+    
+    Proc(Param, 0);
+    
+    for(u32 ThreadIndex = 1; ThreadIndex < ThreadCount; ++ThreadIndex)
+    {
+        if(Started[ThreadIndex])
+        {
+            pthread_join(Threads[ThreadIndex], 0);
+        }
+        else
+        {
+            // NOTE: If the OS wouldn't give us the thread, its share of the work still has to get done.
+            Proc(Param, ThreadIndex);
+        }
+    }
+}
+
+static mapped_file MapFileForRead(char *FileName, u32 Padding)
+{
+    mapped_file Result = {};
+    
+    int File = open(FileName, O_RDONLY);
+    if(File >= 0)
+    {
+        struct stat Stat;
+        if((fstat(File, &Stat) == 0) && ((u64)Stat.st_size <= (0xffffffffull - Padding)))
+        {
+            u64 PageSize = (u64)sysconf(_SC_PAGESIZE);
+            u64 ByteCount = (u64)Stat.st_size;
+            size_t MappedSize = (size_t)((ByteCount + Padding + PageSize - 1) & ~(PageSize - 1));
+            
+            // NOTE: Reserve zero pages for the file plus its padding, then map the file over the front of
+            // them. The part of the file's last page past its end reads as zero, and so do the pages after it.
+            void *Reserved = mmap(0, MappedSize, PROT_READ, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+            if(Reserved != MAP_FAILED)
+            {
+                if(!ByteCount ||
+                   (mmap(Reserved, (size_t)ByteCount, PROT_READ, MAP_PRIVATE|MAP_FIXED, File, 0) != MAP_FAILED))
+                {
+                    Result.Data = (u8 *)Reserved;
+                    Result.ByteCount = (u32)ByteCount;
+                    Result.MappedSize = MappedSize;
+                }
+                else
+                {
+                    munmap(Reserved, MappedSize);
+                }
+            }
+        }
+        
+        close(File);
+    }
+    
+    return Result;
+}
+
+static void UnmapFile(mapped_file *File)
+{
+    if(File->Data)
+    {
+        munmap(File->Data, File->MappedSize);
+    }
+    
+    *File = {};
+}
+
+static u8 *AllocateMirroredMemory(u32 Size)
+{
+    // NOTE: The memory has to be a file of some kind so it can be mapped twice. Linux can make one
+    // that never has a name. Elsewhere, it gets a shared memory name just long enough to open it.
+    u8 *Result = 0;
+    
+#if __linux__
+    int File = memfd_create("sim86", 0);
+#else
+    char Name[64];
+    snprintf(Name, sizeof(Name), "/sim86-%d-%p", (int)getpid(), (void *)Name);
+    int File = shm_open(Name, O_RDWR|O_CREAT|O_EXCL, 0600);
+    if(File >= 0)
+    {
+        shm_unlink(Name);
+    }
+#endif
+    
+    if(File >= 0)
+    {
+        if(ftruncate(File, Size) == 0)
+        {
+            // NOTE: Reserve room for both mappings first, so nothing else can end up between them.
+            void *Reserved = mmap(0, 2*(size_t)Size, PROT_NONE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+            if(Reserved != MAP_FAILED)
+            {
+                u8 *Base = (u8 *)Reserved;
+                if((mmap(Base, Size, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_FIXED, File, 0) != MAP_FAILED) &&
+                   (mmap(Base + Size, Size, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_FIXED, File, 0) != MAP_FAILED))
+                {
+                    Result = Base;
+                }
+                else
+                {
+                    munmap(Reserved, 2*(size_t)Size);
+                }
+            }
+        }
+        
+        close(File);
+    }
+    
+    return Result;
+}
+
+static void FreeMirroredMemory(u8 *Memory, u32 Size)
+{
+    if(Memory)
+    {
+        munmap(Memory, 2*(size_t)Size);
+    }
+}
+
+static u8 *AllocateExecutableMemory(u32 Size)
+{
+    void *Memory = mmap(0, Size, PROT_READ|PROT_WRITE|PROT_EXEC, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    u8 *Result = (Memory != MAP_FAILED) ? (u8 *)Memory : 0;
+    return Result;
+}
+
+static void FreeExecutableMemory(u8 *Memory, u32 Size)
+{
+    if(Memory)
+    {
+        munmap(Memory, Size);
+    }
+}
+
+#endif
@@ -0,0 +1,34 @@
+typedef void thread_proc(void *Param, u32 ThreadIndex);
+
+static u32 GetProcessorCount(void);
+
+// NOTE: The same OS timer as the part 2 listings, which is all the run summaries need to time themselves.
+static u64 GetOSTimerFreq(void);
+static u64 ReadOSTimer(void);
+
+// NOTE: Calls Proc(Param, ThreadIndex) on ThreadCount threads and waits for all of them to finish.
+static void RunOnThreads(u32 ThreadCount, thread_proc *Proc, void *Param);
+
+struct mapped_file
+{
+    // NOTE: Data is followed by at least as many bytes of zeroes as were asked for in MapFileForRead,
+    // so code that reads a little past the end of the file (like the decoder) never faults.
+    u8 *Data;
+    u32 ByteCount;
+    
+    size_t MappedSize;
+    b32 IsCopy; // NOTE: Set if the file could not be mapped with enough padding after it, so it was read instead
+    void *Mapping;
+};
+
+static mapped_file MapFileForRead(char *FileName, u32 Padding);
+static void UnmapFile(mapped_file *File);
+
+// NOTE: Size bytes of memory, immediately followed by a second mapping of the same bytes, so that Result[Size + i]
+// is Result[i]. Size has to be a multiple of 64k. Returns 0 if the OS won't allow it.
+static u8 *AllocateMirroredMemory(u32 Size);
+static void FreeMirroredMemory(u8 *Memory, u32 Size);
+
+// NOTE: Memory that can be both written and executed, for generated code. Returns 0 if the OS won't allow it.
+static u8 *AllocateExecutableMemory(u32 Size);
+static void FreeExecutableMemory(u8 *Memory, u32 Size);
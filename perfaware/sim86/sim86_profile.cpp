@@ -0,0 +1,201 @@
+struct profile_line
+{
+    u32 Address;
+    u32 InstructionCount; // NOTE: Only for blocks
+    profile_entry Entry;
+};
+
+static b32 BeginProfile(execution_profile *Profile, u32 ByteCount)
+{
+    *Profile = {};
+    Profile->Entries = (profile_entry *)calloc(ByteCount, sizeof(profile_entry));
+    Profile->IsTarget = (u8 *)calloc(ByteCount, sizeof(u8));
+    
+    b32 Result = (Profile->Entries && Profile->IsTarget);
+    if(Result)
+    {
+        Profile->ByteCount = ByteCount;
+    }
+    else
+    {
+        EndProfile(Profile);
+    }
+    
+    return Result;
+}
+
+static void ProfileStep(execution_profile *Profile, u32 Address, instruction Instruction, exec_result Exec,
+                        instruction_clock_interval Clocks, u32 NextAddress)
+{
+    if(Address < Profile->ByteCount)
+    {
+        profile_entry *Entry = Profile->Entries + Address;
+        ++Entry->ExecCount;
+        Entry->TakenCount += (Exec.BranchTaken != 0);
+        Entry->ClocksMin += Clocks.Min;
+        Entry->ClocksMax += Clocks.Max;
+    }
+    
+    if((NextAddress != (Address + Instruction.Size)) && (NextAddress < Profile->ByteCount))
+    {
+        Profile->IsTarget[NextAddress] = true;
+    }
+}
+
+static int CompareProfileLines(void const *AVoid, void const *BVoid)
+{
+    // NOTE: Most clocks first, then lowest address first.
+    profile_line const *A = (profile_line const *)AVoid;
+    profile_line const *B = (profile_line const *)BVoid;
+    
+    int Result = 0;
+    if(A->Entry.ClocksMax != B->Entry.ClocksMax)
+    {
+        Result = (A->Entry.ClocksMax > B->Entry.ClocksMax) ? -1 : 1;
+    }
+    else if(A->Address != B->Address)
+    {
+        Result = (A->Address < B->Address) ? -1 : 1;
+    }
+    
+    return Result;
+}
+
+static void PrintProfileClocks(profile_entry Entry, u64 TotalClocks, FILE *Out)
+{
+    double Percent = TotalClocks ? (100.0*(double)Entry.ClocksMax / (double)TotalClocks) : 0.0;
+    if(Entry.ClocksMin != Entry.ClocksMax)
+    {
+        fprintf(Out, "[%llu,%llu]", (unsigned long long)Entry.ClocksMin, (unsigned long long)Entry.ClocksMax);
+    }
+    else
+    {
+        fprintf(Out, "%llu", (unsigned long long)Entry.ClocksMax);
+    }
+    fprintf(Out, " clocks (%.1f%%)", Percent);
+}
+
+static void PrintProfile(execution_profile *Profile, segmented_access Memory, FILE *Out)
+{
+    instruction_table Table = Get8086InstructionTable();
+    
+    u32 LineCount = 0;
+    u32 EntryCount = 1;
+    profile_entry Total = {};
+    for(u32 Address = 0; Address < Profile->ByteCount; ++Address)
+    {
+        profile_entry Entry = Profile->Entries[Address];
+        if(Entry.ExecCount)
+        {
+            ++LineCount;
+            Total.ExecCount += Entry.ExecCount;
+            Total.ClocksMin += Entry.ClocksMin;
+            Total.ClocksMax += Entry.ClocksMax;
+        }
+        
+        EntryCount += (Profile->IsTarget[Address] != 0);
+    }
+    
+    profile_line *Lines = (profile_line *)malloc((LineCount + 1)*sizeof(profile_line));
+    u32 *Entries = (u32 *)malloc(EntryCount*sizeof(u32));
+    if(!Lines || !Entries)
+    {
+        fprintf(stderr, "ERROR: Unable to allocate space to print the profile.\n");
+        free(Lines);
+        free(Entries);
+        return;
+    }
+    
+    LineCount = 0;
+    EntryCount = 0;
+    Entries[EntryCount++] = 0;
+    for(u32 Address = 0; Address < Profile->ByteCount; ++Address)
+    {
+        if(Profile->Entries[Address].ExecCount)
+        {
+            profile_line *Line = Lines + LineCount++;
+            Line->Address = Address;
+            Line->InstructionCount = 1;
+            Line->Entry = Profile->Entries[Address];
+        }
+        
+        if(Profile->IsTarget[Address])
+        {
+            Entries[EntryCount++] = Address;
+        }
+    }
+    
+    fprintf(Out, "\nProfile: %llu instructions, ", (unsigned long long)Total.ExecCount);
+    PrintProfileClocks(Total, Total.ClocksMax, Out);
+    fprintf(Out, "\n");
+    
+    // NOTE: The instructions are decoded from memory as it is at the end of the run, so if the program
+    // modified its own code, this shows what is there now rather than what ran.
+    qsort(Lines, LineCount, sizeof(profile_line), CompareProfileLines);
+    for(u32 LineIndex = 0; LineIndex < LineCount; ++LineIndex)
+    {
+        profile_line *Line = Lines + LineIndex;
+        instruction Instruction = DecodeInstruction(Table, AtBlockAddress(Memory, Line->Address));
+        Instruction.Address = Line->Address;
+        
+        fprintf(Out, "0x%05x: ", Line->Address);
+        PrintInstruction(Instruction, Out);
+        fprintf(Out, " ; ");
+        PrintProfileClocks(Line->Entry, Total.ClocksMax, Out);
+        fprintf(Out, ", %llu runs", (unsigned long long)Line->Entry.ExecCount);
+        if(GetControlFlow(Instruction.Op) == Flow_Conditional)
+        {
+            fprintf(Out, ", taken %llu, not taken %llu", (unsigned long long)Line->Entry.TakenCount,
+                    (unsigned long long)(Line->Entry.ExecCount - Line->Entry.TakenCount));
+        }
+        fprintf(Out, "\n");
+    }
+    
+    // NOTE: Blocks start at the program's entry and everywhere control was seen to go, so every
+    // instruction that ran is in one, unless it ran outside the image's decodable code.
+    block_graph Graph = BuildBlockGraph(Table, Memory, Profile->ByteCount, EntryCount, Entries);
+    u32 BlockLineCount = 0;
+    for(u32 BlockIndex = 0; BlockIndex < Graph.BlockCount; ++BlockIndex)
+    {
+        basic_block *Block = Graph.Blocks + BlockIndex;
+        profile_line *Line = Lines + BlockLineCount;
+        *Line = {};
+        Line->Address = Block->Address;
+        Line->InstructionCount = Block->InstructionCount;
+        for(u32 Index = 0; Index < Block->InstructionCount; ++Index)
+        {
+            u32 Address = Graph.Instructions[Block->FirstInstruction + Index].Address;
+            profile_entry Entry = Profile->Entries[Address];
+            Line->Entry.ClocksMin += Entry.ClocksMin;
+            Line->Entry.ClocksMax += Entry.ClocksMax;
+            Line->Entry.ExecCount += Entry.ExecCount;
+        }
+        
+        if(Line->Entry.ExecCount)
+        {
+            ++BlockLineCount;
+        }
+    }
+    
+    fprintf(Out, "\nBlocks:\n");
+    qsort(Lines, BlockLineCount, sizeof(profile_line), CompareProfileLines);
+    for(u32 LineIndex = 0; LineIndex < BlockLineCount; ++LineIndex)
+    {
+        profile_line *Line = Lines + LineIndex;
+        fprintf(Out, "0x%05x: %u instructions, entered %llu times, ", Line->Address, Line->InstructionCount,
+                (unsigned long long)Profile->Entries[Line->Address].ExecCount);
+        PrintProfileClocks(Line->Entry, Total.ClocksMax, Out);
+        fprintf(Out, "\n");
+    }
+    
+    FreeBlockGraph(&Graph);
+    free(Lines);
+    free(Entries);
+}
+
+static void EndProfile(execution_profile *Profile)
+{
+    free(Profile->Entries);
+    free(Profile->IsTarget);
+    *Profile = {};
+}
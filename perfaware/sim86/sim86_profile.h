@@ -0,0 +1,25 @@
+/* NOTE: A profile counts, for every address in the program, how many times the instruction there ran,
+   how many clocks it took in total (as estimated by ExpectedClocksFrom), and how many times it branched.
+   Counting is just a few adds into an array indexed by address, so it costs about the same no matter how
+   long the run is. Everything else (decoding, finding basic blocks, sorting) happens once, when it prints. */
+
+struct profile_entry
+{
+    u64 ExecCount;
+    u64 TakenCount; // NOTE: Times a branch went somewhere other than the next instruction
+    u64 ClocksMin;
+    u64 ClocksMax;
+};
+
+struct execution_profile
+{
+    u32 ByteCount;
+    profile_entry *Entries;
+    u8 *IsTarget; // NOTE: Set for addresses that control was transferred to, so basic blocks can start there
+};
+
+static b32 BeginProfile(execution_profile *Profile, u32 ByteCount);
+static void ProfileStep(execution_profile *Profile, u32 Address, instruction Instruction, exec_result Exec,
+                        instruction_clock_interval Clocks, u32 NextAddress);
+static void PrintProfile(execution_profile *Profile, segmented_access Memory, FILE *Out);
+static void EndProfile(execution_profile *Profile);
@@ -0,0 +1,65 @@
+static b32 TakeSnapshot(machine_snapshot *Snapshot, segmented_access *Memory, u32 OnePastLastByte,
+                        register_state_8086 *Registers, timing_state Timing, instruction_clock_interval Clocks,
+                        u64 InstructionCount)
+{
+    u32 MemorySize = GetHighestAddress(*Memory) + 1;
+    if(Snapshot->MemorySize != MemorySize)
+    {
+        free(Snapshot->Memory);
+        Snapshot->Memory = (u8 *)malloc(MemorySize);
+        Snapshot->MemorySize = Snapshot->Memory ? MemorySize : 0;
+    }
+    
+    b32 Result = (Snapshot->Memory != 0);
+    if(Result)
+    {
+        memcpy(Snapshot->Memory, Memory->Memory, MemorySize);
+        ClearDirtyPages(&Snapshot->Dirty);
+        Memory->Dirty = &Snapshot->Dirty;
+        
+        Snapshot->Taken = true;
+        Snapshot->OnePastLastByte = OnePastLastByte;
+        Snapshot->Registers = *Registers;
+        Snapshot->Timing = Timing;
+        Snapshot->Clocks = Clocks;
+        Snapshot->InstructionCount = InstructionCount;
+    }
+    
+    return Result;
+}
+
+static u32 RestoreSnapshot(machine_snapshot *Snapshot, segmented_access Memory,
+                           register_state_8086 *Registers, timing_state *Timing, instruction_clock_interval *Clocks,
+                           u64 *InstructionCount)
+{
+    // NOTE: Returns how many pages had to be copied back.
+    u32 Result = 0;
+    
+    assert(Snapshot->Taken);
+    assert(Snapshot->MemorySize == (GetHighestAddress(Memory) + 1));
+    
+    u32 PageCount = Snapshot->MemorySize >> MEMORY_PAGE_SHIFT;
+    for(u32 PageIndex = 0; PageIndex < PageCount; ++PageIndex)
+    {
+        if(IsPageDirty(&Snapshot->Dirty, PageIndex))
+        {
+            u32 Offset = PageIndex << MEMORY_PAGE_SHIFT;
+            memcpy(Memory.Memory + Offset, Snapshot->Memory + Offset, MEMORY_PAGE_SIZE);
+            ++Result;
+        }
+    }
+    ClearDirtyPages(&Snapshot->Dirty);
+    
+    *Registers = Snapshot->Registers;
+    *Timing = Snapshot->Timing;
+    *Clocks = Snapshot->Clocks;
+    *InstructionCount = Snapshot->InstructionCount;
+    
+    return Result;
+}
+
+static void FreeSnapshot(machine_snapshot *Snapshot)
+{
+    free(Snapshot->Memory);
+    *Snapshot = {};
+}
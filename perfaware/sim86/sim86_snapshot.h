@@ -0,0 +1,33 @@
+/* NOTE: A snapshot is the whole machine at one point in a run, so the run can be restarted from that
+   point as many times as you like without reloading anything.
+
+   Taking a snapshot copies all of memory once. After that, the memory being snapshotted has to have its
+   Dirty pointer set to the snapshot's Dirty (TakeSnapshot does this for the access it is given, but any
+   other copies of it need it too), so that every write marks its page. Restoring then only copies back
+   the pages that were written since the snapshot was taken or last restored, so it costs about what the
+   run touched, not the full 1mb. */
+
+struct machine_snapshot
+{
+    b32 Taken;
+    char *Name;
+    u32 OnePastLastByte;
+    
+    register_state_8086 Registers;
+    timing_state Timing;
+    instruction_clock_interval Clocks;
+    u64 InstructionCount;
+    
+    u32 MemorySize;
+    u8 *Memory;
+    
+    dirty_pages Dirty;
+};
+
+static b32 TakeSnapshot(machine_snapshot *Snapshot, segmented_access *Memory, u32 OnePastLastByte,
+                        register_state_8086 *Registers, timing_state Timing, instruction_clock_interval Clocks,
+                        u64 InstructionCount);
+static u32 RestoreSnapshot(machine_snapshot *Snapshot, segmented_access Memory,
+                           register_state_8086 *Registers, timing_state *Timing, instruction_clock_interval *Clocks,
+                           u64 *InstructionCount);
+static void FreeSnapshot(machine_snapshot *Snapshot);
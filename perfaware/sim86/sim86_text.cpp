@@ -234,3 +234,69 @@ static void ExplainTiming(instruction_timing Timing, instruction_clock_interval
         fprintf(Dest, ")");
     }
 }
+
+static void PrintFinalRegisters(register_state_8086 *Registers, FILE *Dest)
+{
+    fprintf(Dest, "\n");
+    fprintf(Dest, "Final registers:\n");
+    PrintRegisters(Registers, Dest);
+    fprintf(Dest, "\n");
+}
+
+static void PrintClockWarning(FILE *Dest)
+{
+    fprintf(Dest,
+            "\n"
+            "WARNING: Clocks reported by this utility are strictly from the 8086 manual.\n"
+            "They will be inaccurate, both because the manual clocks are estimates, and because\n"
+            "some of the entries in the manual look highly suspicious and are probably typos.\n"
+            "\n");
+}
+
+static void PrintClocks(instruction_timing Timing, instruction_clock_interval Clocks, u32 SimFlags,
+                        instruction_clock_interval *Accum, FILE *Dest)
+{
+    Accum->Min += Clocks.Min;
+    Accum->Max += Clocks.Max;
+    
+    if(Accum->Min != Accum->Max)
+    {
+        fprintf(Dest, "Clocks: +[%u,%u] = [%u,%u]", Clocks.Min, Clocks.Max, Accum->Min, Accum->Max);
+    }
+    else
+    {
+        fprintf(Dest, "Clocks: +%u = %u", Clocks.Min, Accum->Min);
+    }
+    
+    if(SimFlags & SimFlag_ExplainClocks)
+    {
+        ExplainTiming(Timing, Clocks, Dest);
+    }
+}
+
+static void PrintEstimatedClocks(timing_state State, instruction Instruction, u32 SimFlags,
+                                 instruction_clock_interval *Accum, FILE *Dest)
+{
+    instruction_timing Timing = EstimateInstructionClocks(State, Instruction);
+    PrintClocks(Timing, ExpectedClocksFrom(State, Instruction, Timing), SimFlags, Accum, Dest);
+}
+
+static void PrintExecutedInstruction(instruction Instruction, exec_result Exec, register_state_8086 *PrevRegisters,
+                                     register_state_8086 *Registers, u32 SimFlags, timing_state *Timing,
+                                     instruction_clock_interval *TimeAccum, FILE *Dest)
+{
+    PrintInstruction(Instruction, Dest);
+    fprintf(Dest, " ; ");
+    if(SimFlags & SimFlag_ShowClocks)
+    {
+        UpdateTimingForExec(Timing, Exec);
+        instruction_timing InstructionTiming = EstimateInstructionClocks(*Timing, Instruction);
+        PrintClocks(InstructionTiming, ClocksForExec(Timing, Instruction, InstructionTiming), SimFlags, TimeAccum, Dest);
+        fprintf(Dest, " | ");
+    }
+    if(!(SimFlags & SimFlag_NoRegisterDiffs))
+    {
+        PrintRegisterDifference(PrevRegisters, Registers, Dest);
+    }
+    fprintf(Dest, "\n");
+}
@@ -10,4 +10,26 @@
    
    ======================================================================== */
 
+enum sim_flags
+{
+    SimFlag_StopOnRet = 0x1,
+    SimFlag_ShowClocks = 0x2,
+    SimFlag_DumpMemory = 0x4,
+    SimFlag_ExplainClocks = 0x8,
+    SimFlag_NoRegisterDiffs = 0x10,
+    SimFlag_CheckDecode = 0x20,
+    SimFlag_Blocks = 0x40,
+    SimFlag_JIT = 0x80,
+    SimFlag_VerifyJIT = 0x100,
+    SimFlag_EagerFlags = 0x200,
+    SimFlag_Quiet = 0x400,
+    SimFlag_Trace = 0x800,
+    SimFlag_DumpDelta = 0x1000,
+    SimFlag_Profile = 0x2000,
+    SimFlag_Loops = 0x4000,
+};
+
 static void PrintInstruction(instruction Instruction, FILE *Dest);
+static void PrintRegisters(register_state_8086 *Registers, FILE *Dest);
+static void PrintFinalRegisters(register_state_8086 *Registers, FILE *Dest);
+static void PrintClockWarning(FILE *Dest);
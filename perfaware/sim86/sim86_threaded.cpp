@@ -0,0 +1,606 @@
+/* NOTE: This is an alternative to decoding and then switching on every instruction as it is
+   executed. The first time execution reaches a cs:ip, the basic block starting there is decoded once into
+   an array of ops, each of which is a pointer to the handler for that instruction plus its already-resolved
+   operands. Running a block is then just calling each handler in turn, with each handler returning the
+   next op (this is "direct-threaded" code).
+
+   The moves, the arithmetic and logical ops, and all the conditional jumps get handlers specialized by
+   template for their op, the form of each operand (register, memory or immediate) and their width, picked
+   once when the block is built (see ThreadedALU). Everything else goes through a generic handler that calls
+   ExecInstruction, so register state and clocks always come out exactly the same as they do for Run8086. */
+
+static threaded_op *ThreadedExit(threaded_machine *Machine, threaded_op *Op)
+{
+    return 0;
+}
+
+static threaded_op *ThreadedStopOnRet(threaded_machine *Machine, threaded_op *Op)
+{
+    // NOTE: Like Run8086, this stops before the ret is executed.
+    Machine->Stop = ThreadedStop_Return;
+    Machine->StopOp = Op;
+    return 0;
+}
+
+static threaded_op *FinishThreadedOp(threaded_machine *Machine, threaded_op *Op, u32 ClockIndex)
+{
+    Machine->Clocks.Min += Op->Clocks[ClockIndex].Min;
+    Machine->Clocks.Max += Op->Clocks[ClockIndex].Max;
+    ++Machine->InstructionCount;
+    return Op + 1;
+}
+
+template<u32 WWidth> static u32 ReadThreadedRegister(u8 *Register)
+{
+    u32 Result = (WWidth == 2) ? *(u16 *)Register : *Register;
+    return Result;
+}
+
+template<u32 WWidth> static void WriteThreadedRegister(u8 *Register, u32 Value)
+{
+    if(WWidth == 2)
+    {
+        *(u16 *)Register = (u16)Value;
+    }
+    else
+    {
+        *Register = (u8)Value;
+    }
+}
+
+static segmented_access GetThreadedAddress(threaded_machine *Machine, threaded_op *Op)
+{
+    // NOTE: Same address AccessOperand computes for a memory operand.
+    segmented_access Result = Machine->Memory;
+    Result.Mask = 0xffff;
+    Result.SegmentBase = *Op->Segment;
+    Result.SegmentOffset = (u16)(Op->Displacement + *Op->Terms[0] + *Op->Terms[1]);
+    return Result;
+}
+
+static b32 ThreadedOpSeesUpperByte(operation_type InstOp)
+{
+    // NOTE: ExecInstruction always reads 16 bits from memory, even for byte operations. For these ops,
+    // the byte after the operand can change the flags (CF for inc, dec and neg, and SF, ZF and PF for test),
+    // so they have to read it too. Everything else masks it off before it matters.
+    b32 Result = ((InstOp == Op_test) || (InstOp == Op_inc) || (InstOp == Op_dec) || (InstOp == Op_neg));
+    return Result;
+}
+
+template<threaded_operand_form Form, u32 WWidth>
+static u32 ReadThreadedOperand(threaded_op *Op, u8 *Register, segmented_access Address, b32 UpperByte)
+{
+    u32 Result = 0;
+    if(Form == ThreadedForm_Register)
+    {
+        Result = ReadThreadedRegister<WWidth>(Register);
+    }
+    else if(Form == ThreadedForm_Memory)
+    {
+        Result = ((WWidth == 2) || UpperByte) ? ReadU16(Address, 0) : ReadU8(Address, 0);
+    }
+    else if(Form == ThreadedForm_Immediate)
+    {
+        Result = Op->Immediate;
+    }
+    return Result;
+}
+
+template<operation_type InstOp, threaded_operand_form DestForm, threaded_operand_form SourceForm, u32 WWidth>
+static threaded_op *ThreadedALU(threaded_machine *Machine, threaded_op *Op)
+{
+    // NOTE: Everything but Op is a template argument, so each instantiation compiles down to just
+    // the reads, the operation and the write for its one form. The results and flags are exactly what
+    // ExecInstruction produces for the same instruction.
+    register_state_8086 *Registers = &Machine->Registers;
+    Registers->ip = Op->NextIP;
+    
+    b32 HasMemory = ((DestForm == ThreadedForm_Memory) || (SourceForm == ThreadedForm_Memory));
+    segmented_access Address = {};
+    u32 ClockIndex = 0;
+    if(HasMemory)
+    {
+        Address = GetThreadedAddress(Machine, Op);
+        ClockIndex = Address.SegmentOffset & 1;
+        Machine->Exec.AddressIsUnaligned = ClockIndex;
+    }
+    
+    b32 UpperByte = ThreadedOpSeesUpperByte(InstOp);
+    u32 V0 = (InstOp == Op_mov) ? 0 : ReadThreadedOperand<DestForm, WWidth>(Op, Op->Dest, Address, UpperByte);
+    u32 V1 = ReadThreadedOperand<SourceForm, WWidth>(Op, Op->Source, Address, UpperByte);
+    u32 WidthMask = WidthMaskFor(WWidth);
+    
+    b32 Write = true;
+    u32 R = 0;
+    switch(InstOp)
+    {
+        case Op_mov: {R = V1;} break;
+        case Op_add: {R = AddAndUpdateFlags(Registers, V0, V1, WWidth, Machine->Lazy);} break;
+        case Op_sub: {R = SubAndUpdateFlags(Registers, V0, V1, WWidth, Machine->Lazy);} break;
+        case Op_cmp: {SubAndUpdateFlags(Registers, V0, V1, WWidth, Machine->Lazy); Write = false;} break;
+        
+        case Op_and:
+        case Op_or:
+        case Op_xor:
+        {
+            R = (InstOp == Op_and) ? (V0 & V1) : (InstOp == Op_or) ? (V0 | V1) : (V0 ^ V1);
+            R = (u16)R & WidthMask;
+            SetFlagsFrom(Registers, Machine->Lazy, LazyFlags_Log, WWidth, 0, 0, R);
+        } break;
+        
+        case Op_test: {SetFlagsFrom(Registers, Machine->Lazy, LazyFlags_Log, WWidth, 0, 0, (u16)(V0 & V1)); Write = false;} break;
+        
+        case Op_inc:
+        case Op_dec:
+        case Op_neg:
+        {
+            R = (InstOp == Op_inc) ? (V0 + 1) : (InstOp == Op_dec) ? (V0 - 1) : -V0;
+            SetFlagsFrom(Registers, Machine->Lazy, LazyFlags_Arith, WWidth, 0, 0, R);
+        } break;
+        
+        case Op_not: {R = ~V0;} break;
+        
+        default: {} break;
+    }
+    
+    threaded_op *Result = FinishThreadedOp(Machine, Op, ClockIndex);
+    if(Write)
+    {
+        if(DestForm == ThreadedForm_Register)
+        {
+            WriteThreadedRegister<WWidth>(Op->Dest, R & WidthMask);
+        }
+        else if(DestForm == ThreadedForm_Memory)
+        {
+            WriteN(Address, 0, R & WidthMask, WWidth);
+            
+            // NOTE: Like the generic handler, go back to the dispatcher if this wrote over any block's code.
+            memory_watch *Watch = &Machine->Watch;
+            if(Watch->HitCount || Watch->Overflowed)
+            {
+                Result = 0;
+            }
+        }
+    }
+    
+    return Result;
+}
+
+template<operation_type JumpOp> static threaded_op *ThreadedJump(threaded_machine *Machine, threaded_op *Op)
+{
+    // NOTE: A conditional jump always ends its block, so this always goes back to the dispatcher.
+    register_state_8086 *Registers = &Machine->Registers;
+    Registers->ip = Op->NextIP;
+    MaterializeFlags(Registers, Machine->Lazy);
+    
+    exec_result Exec = {};
+    ConditionalJump(&Exec, Registers, (s8)Op->Immediate, EvaluateJumpCondition(Registers, JumpOp));
+    
+    u32 Taken = Exec.BranchTaken ? 1 : 0;
+    Machine->Exec.BranchTaken = Exec.BranchTaken;
+    Machine->Clocks.Min += Op->Clocks[Taken].Min;
+    Machine->Clocks.Max += Op->Clocks[Taken].Max;
+    ++Machine->InstructionCount;
+    
+    return 0;
+}
+
+static threaded_op *ThreadedGeneric(threaded_machine *Machine, threaded_op *Op)
+{
+    register_state_8086 *Registers = &Machine->Registers;
+    instruction Instruction = UnpackInstruction(Op->Instruction);
+    
+    Registers->ip += Op->Size;
+    exec_result Exec = ExecInstruction(Machine->Memory, Registers, Instruction, Machine->Lazy);
+    Machine->Exec = Exec;
+    
+    threaded_op *Result = 0;
+    if(Exec.Unimplemented)
+    {
+        Machine->Stop = ThreadedStop_Unimplemented;
+        Machine->StopOp = Op;
+    }
+    else
+    {
+        // NOTE: The precomputed clocks are good unless the exec result changed something the
+        // timing depends on besides whether a branch was taken or the address was odd.
+        instruction_clock_interval Clocks = Op->Clocks[(Exec.BranchTaken || Exec.AddressIsUnaligned) ? 1 : 0];
+        if(Exec.ShiftCount || Exec.RepCount)
+        {
+            timing_state Timing = Machine->Timing;
+            UpdateTimingForExec(&Timing, Exec);
+            Clocks = ExpectedClocksFrom(Timing, Instruction, EstimateInstructionClocks(Timing, Instruction));
+        }
+        
+        Machine->Clocks.Min += Clocks.Min;
+        Machine->Clocks.Max += Clocks.Max;
+        ++Machine->InstructionCount;
+        
+        // NOTE: Keep going in this block only if execution went where the block expected it to,
+        // and nothing wrote over the code of any block.
+        memory_watch *Watch = &Machine->Watch;
+        if((Registers->ip == Op->NextIP) && (Registers->cs == Machine->BlockCS) &&
+           !Watch->HitCount && !Watch->Overflowed)
+        {
+            Result = Op + 1;
+        }
+    }
+    
+    return Result;
+}
+
+static b32 IsGeneralRegister(instruction_operand Operand, u32 WWidth)
+{
+    b32 Result = ((Operand.Type == Operand_Register) &&
+                  (Operand.Register.Index >= Register_a) &&
+                  (Operand.Register.Index <= Register_di) &&
+                  (Operand.Register.Count == WWidth));
+    return Result;
+}
+
+static threaded_operand_form GetThreadedOperandForm(instruction_operand Operand, u32 WWidth)
+{
+    threaded_operand_form Result = ThreadedForm_Unsupported;
+    
+    switch(Operand.Type)
+    {
+        case Operand_None: {Result = ThreadedForm_None;} break;
+        case Operand_Register: {if(IsGeneralRegister(Operand, WWidth)) {Result = ThreadedForm_Register;}} break;
+        case Operand_Memory: {if(!(Operand.Address.Flags & Address_ExplicitSegment)) {Result = ThreadedForm_Memory;}} break;
+        case Operand_Immediate: {Result = ThreadedForm_Immediate;} break;
+    }
+    
+    return Result;
+}
+
+template<operation_type InstOp, threaded_operand_form DestForm, threaded_operand_form SourceForm>
+static threaded_handler *GetALUHandler(u32 WWidth)
+{
+    threaded_handler *Result = (WWidth == 2) ? ThreadedALU<InstOp, DestForm, SourceForm, 2> : ThreadedALU<InstOp, DestForm, SourceForm, 1>;
+    return Result;
+}
+
+template<operation_type InstOp> static threaded_handler *GetBinaryALUHandler(threaded_operand_form DestForm, threaded_operand_form SourceForm, u32 WWidth)
+{
+    // NOTE: These are the forms that actually get encoded - there's no memory-to-memory, and nothing
+    // has an immediate destination.
+    threaded_handler *Result = 0;
+    
+    if(DestForm == ThreadedForm_Register)
+    {
+        switch(SourceForm)
+        {
+            case ThreadedForm_Register: {Result = GetALUHandler<InstOp, ThreadedForm_Register, ThreadedForm_Register>(WWidth);} break;
+            case ThreadedForm_Memory: {Result = GetALUHandler<InstOp, ThreadedForm_Register, ThreadedForm_Memory>(WWidth);} break;
+            case ThreadedForm_Immediate: {Result = GetALUHandler<InstOp, ThreadedForm_Register, ThreadedForm_Immediate>(WWidth);} break;
+            default: {} break;
+        }
+    }
+    else if(DestForm == ThreadedForm_Memory)
+    {
+        switch(SourceForm)
+        {
+            case ThreadedForm_Register: {Result = GetALUHandler<InstOp, ThreadedForm_Memory, ThreadedForm_Register>(WWidth);} break;
+            case ThreadedForm_Immediate: {Result = GetALUHandler<InstOp, ThreadedForm_Memory, ThreadedForm_Immediate>(WWidth);} break;
+            default: {} break;
+        }
+    }
+    
+    return Result;
+}
+
+template<operation_type InstOp> static threaded_handler *GetUnaryALUHandler(threaded_operand_form DestForm, threaded_operand_form SourceForm, u32 WWidth)
+{
+    threaded_handler *Result = 0;
+    
+    if(SourceForm == ThreadedForm_None)
+    {
+        switch(DestForm)
+        {
+            case ThreadedForm_Register: {Result = GetALUHandler<InstOp, ThreadedForm_Register, ThreadedForm_None>(WWidth);} break;
+            case ThreadedForm_Memory: {Result = GetALUHandler<InstOp, ThreadedForm_Memory, ThreadedForm_None>(WWidth);} break;
+            default: {} break;
+        }
+    }
+    
+    return Result;
+}
+
+static threaded_handler *GetJumpHandler(operation_type Op)
+{
+    threaded_handler *Result = 0;
+    
+    switch(Op)
+    {
+#define THREADED_JUMP(Name) case Op_##Name: {Result = ThreadedJump<Op_##Name>;} break;
+        THREADED_JUMP(je) THREADED_JUMP(jl) THREADED_JUMP(jle) THREADED_JUMP(jb)
+        THREADED_JUMP(jbe) THREADED_JUMP(jp) THREADED_JUMP(jo) THREADED_JUMP(js)
+        THREADED_JUMP(jne) THREADED_JUMP(jnl) THREADED_JUMP(jg) THREADED_JUMP(jnb)
+        THREADED_JUMP(ja) THREADED_JUMP(jnp) THREADED_JUMP(jno) THREADED_JUMP(jns)
+        THREADED_JUMP(loop) THREADED_JUMP(loopz) THREADED_JUMP(loopnz) THREADED_JUMP(jcxz)
+#undef THREADED_JUMP
+        
+        default: {} break;
+    }
+    
+    return Result;
+}
+
+static void ResolveThreadedOperand(threaded_machine *Machine, instruction Instruction, instruction_operand Operand, u8 **Register, threaded_op *Op)
+{
+    register_state_8086 *Registers = &Machine->Registers;
+    
+    if(Operand.Type == Operand_Register)
+    {
+        *Register = GetRegisterPtr(Registers, Operand.Register);
+    }
+    else if(Operand.Type == Operand_Memory)
+    {
+        effective_address_expression Address = Operand.Address;
+        u32 SegmentIndex = (Address.Terms[0].Register.Index == Register_bp) ? Register_ss : Register_ds;
+        if(Instruction.SegmentOverride)
+        {
+            SegmentIndex = Instruction.SegmentOverride;
+        }
+        
+        Op->Segment = &Registers->u16[SegmentIndex];
+        Op->Terms[0] = &Registers->u16[Address.Terms[0].Register.Index];
+        Op->Terms[1] = &Registers->u16[Address.Terms[1].Register.Index];
+        Op->Displacement = (u16)Address.Displacement;
+    }
+    else if(Operand.Type == Operand_Immediate)
+    {
+        Op->Immediate = (u32)Operand.Immediate.Value;
+    }
+}
+
+static threaded_handler *SelectThreadedHandler(threaded_machine *Machine, instruction Instruction, threaded_op *Op)
+{
+    // NOTE: Segment registers and far addresses are left to the generic handler. Ops that write
+    // memory check for self-modifying code themselves.
+    threaded_handler *Result = 0;
+    
+    u32 WWidth = (Instruction.Flags & Inst_Wide) ? 2 : 1;
+    instruction_operand Op0 = Instruction.Operands[0];
+    instruction_operand Op1 = Instruction.Operands[1];
+    threaded_operand_form DestForm = GetThreadedOperandForm(Op0, WWidth);
+    threaded_operand_form SourceForm = GetThreadedOperandForm(Op1, WWidth);
+    
+    switch(Instruction.Op)
+    {
+        case Op_mov: {Result = GetBinaryALUHandler<Op_mov>(DestForm, SourceForm, WWidth);} break;
+        case Op_add: {Result = GetBinaryALUHandler<Op_add>(DestForm, SourceForm, WWidth);} break;
+        case Op_sub: {Result = GetBinaryALUHandler<Op_sub>(DestForm, SourceForm, WWidth);} break;
+        case Op_cmp: {Result = GetBinaryALUHandler<Op_cmp>(DestForm, SourceForm, WWidth);} break;
+        case Op_and: {Result = GetBinaryALUHandler<Op_and>(DestForm, SourceForm, WWidth);} break;
+        case Op_or: {Result = GetBinaryALUHandler<Op_or>(DestForm, SourceForm, WWidth);} break;
+        case Op_xor: {Result = GetBinaryALUHandler<Op_xor>(DestForm, SourceForm, WWidth);} break;
+        case Op_test: {Result = GetBinaryALUHandler<Op_test>(DestForm, SourceForm, WWidth);} break;
+        case Op_inc: {Result = GetUnaryALUHandler<Op_inc>(DestForm, SourceForm, WWidth);} break;
+        case Op_dec: {Result = GetUnaryALUHandler<Op_dec>(DestForm, SourceForm, WWidth);} break;
+        case Op_neg: {Result = GetUnaryALUHandler<Op_neg>(DestForm, SourceForm, WWidth);} break;
+        case Op_not: {Result = GetUnaryALUHandler<Op_not>(DestForm, SourceForm, WWidth);} break;
+        
+        default:
+        {
+            if(DestForm == ThreadedForm_Immediate)
+            {
+                Result = GetJumpHandler(Instruction.Op);
+            }
+        } break;
+    }
+    
+    if(Result)
+    {
+        ResolveThreadedOperand(Machine, Instruction, Op0, &Op->Dest, Op);
+        ResolveThreadedOperand(Machine, Instruction, Op1, &Op->Source, Op);
+    }
+    else
+    {
+        Result = ThreadedGeneric;
+    }
+    
+    return Result;
+}
+
+static u32 GetThreadedHashSlot(u16 CS, u16 IP)
+{
+    u32 Result = (((u32)CS << 4) + IP) % THREADED_HASH_COUNT;
+    return Result;
+}
+
+static b32 HasMemoryOperand(instruction Instruction)
+{
+    b32 Result = ((Instruction.Operands[0].Type == Operand_Memory) ||
+                  (Instruction.Operands[1].Type == Operand_Memory));
+    return Result;
+}
+
+static void FlushThreadedBlocks(threaded_machine *Machine)
+{
+    Machine->BlockCount = 0;
+    Machine->OpCount = 0;
+    Machine->Code.Used = 0;
+    memset(Machine->Hash, 0, sizeof(Machine->Hash));
+    
+    memory_watch *Watch = &Machine->Watch;
+    memset(Watch->Bits, 0, sizeof(Watch->Bits));
+    Watch->Overflowed = false;
+    Watch->HitCount = 0;
+}
+
+static threaded_block *BuildThreadedBlock(threaded_machine *Machine, u16 CS, u16 IP)
+{
+    if((Machine->BlockCount == THREADED_BLOCK_COUNT) ||
+       ((Machine->OpCount + THREADED_MAX_BLOCK_OPS + 1) > THREADED_OP_COUNT))
+    {
+        FlushThreadedBlocks(Machine);
+    }
+    
+    threaded_op *Ops = Machine->Ops + Machine->OpCount;
+    
+    segmented_access At = Machine->Memory;
+    At.Mask = 0xffff;
+    At.SegmentBase = CS;
+    At.SegmentOffset = IP;
+    
+    timing_state Timing = Machine->Timing;
+    exec_result Exec = {};
+    UpdateTimingForExec(&Timing, Exec);
+    timing_state TakenTiming = Timing;
+    Exec.BranchTaken = true;
+    UpdateTimingForExec(&TakenTiming, Exec);
+    timing_state UnalignedTiming = Timing;
+    Exec = {};
+    Exec.AddressIsUnaligned = true;
+    UpdateTimingForExec(&UnalignedTiming, Exec);
+    
+    u32 OpCount = 0;
+    while((OpCount < THREADED_MAX_BLOCK_OPS) && (GetAbsoluteAddressOf(At) < Machine->OnePastLastByte))
+    {
+        threaded_op *Op = Ops + OpCount;
+        *Op = {};
+        
+        instruction Instruction = DecodeInstruction(Machine->Table, At);
+        if(!Instruction.Op || !PackInstruction(Instruction, &Op->Instruction))
+        {
+            break;
+        }
+        
+        for(u32 ByteIndex = 0; ByteIndex < Instruction.Size; ++ByteIndex)
+        {
+            SetWatch(&Machine->Watch, GetAbsoluteAddressOf(At, (u16)ByteIndex), true);
+        }
+        
+        Op->Size = (u16)Instruction.Size;
+        Op->NextIP = (u16)(At.SegmentOffset + Instruction.Size);
+        Op->Clocks[0] = ExpectedClocksFrom(Timing, Instruction, EstimateInstructionClocks(Timing, Instruction));
+        timing_state *AltTiming = HasMemoryOperand(Instruction) ? &UnalignedTiming : &TakenTiming;
+        Op->Clocks[1] = ExpectedClocksFrom(*AltTiming, Instruction, EstimateInstructionClocks(*AltTiming, Instruction));
+        ++OpCount;
+        
+        if(Machine->StopOnRet && IsRet(Instruction.Op))
+        {
+            Op->Handler = ThreadedStopOnRet;
+            break;
+        }
+        
+        Op->Handler = SelectThreadedHandler(Machine, Instruction, Op);
+        At.SegmentOffset = Op->NextIP;
+        
+        if(GetControlFlow(Instruction.Op) != Flow_None)
+        {
+            break;
+        }
+    }
+    
+    threaded_block *Result = 0;
+    if(OpCount)
+    {
+        threaded_op *Exit = Ops + OpCount;
+        *Exit = {};
+        Exit->Handler = ThreadedExit;
+        
+        Result = Machine->Blocks + Machine->BlockCount++;
+        Result->CS = CS;
+        Result->IP = IP;
+        Result->OpCount = OpCount;
+        Result->Ops = Ops;
+        Result->ExecCount = 0;
+        Result->CompiledOpCount = 0;
+        Result->Compiled = 0;
+        
+        threaded_block **Slot = Machine->Hash + GetThreadedHashSlot(CS, IP);
+        Result->NextInHash = *Slot;
+        *Slot = Result;
+        
+        Machine->OpCount += OpCount + 1;
+    }
+    
+    return Result;
+}
+
+static threaded_machine *CreateThreadedMachine(segmented_access Memory, u32 OnePastLastByte, timing_state Timing, b32 StopOnRet)
+{
+    threaded_machine *Result = (threaded_machine *)calloc(1, sizeof(threaded_machine));
+    if(Result)
+    {
+        Result->Memory = Memory;
+        Result->Memory.Watch = &Result->Watch;
+        Result->OnePastLastByte = OnePastLastByte;
+        Result->Timing = Timing;
+        Result->StopOnRet = StopOnRet;
+        Result->Table = Get8086InstructionTable();
+        Result->Lazy = &Result->LazyFlags;
+    }
+    
+    return Result;
+}
+
+static void FreeThreadedMachine(threaded_machine *Machine)
+{
+    FreeExecutableMemory(Machine->Code.Memory, Machine->Code.Size);
+    free(Machine);
+}
+
+static threaded_block *GetThreadedBlock(threaded_machine *Machine)
+{
+    // NOTE: Returns 0 and sets Stop if there is no block to run at cs:ip.
+    memory_watch *Watch = &Machine->Watch;
+    if(Watch->HitCount || Watch->Overflowed)
+    {
+        FlushThreadedBlocks(Machine);
+    }
+    
+    u16 CS = Machine->Registers.cs;
+    u16 IP = Machine->Registers.ip;
+    
+    threaded_block *Result = Machine->Hash[GetThreadedHashSlot(CS, IP)];
+    while(Result && ((Result->CS != CS) || (Result->IP != IP)))
+    {
+        Result = Result->NextInHash;
+    }
+    
+    if(!Result)
+    {
+        Result = BuildThreadedBlock(Machine, CS, IP);
+        if(!Result)
+        {
+            u32 AbsAddr = GetAbsoluteAddressOf(0xffff, CS, IP, 0);
+            Machine->Stop = (AbsAddr < Machine->OnePastLastByte) ? ThreadedStop_DecodeError : ThreadedStop_End;
+        }
+    }
+    
+    Machine->BlockCS = CS;
+    
+    return Result;
+}
+
+static threaded_op *RunThreadedOp(threaded_machine *Machine, threaded_op *Op)
+{
+    threaded_op *Result = Op->Handler(Machine, Op);
+    return Result;
+}
+
+static void RunThreadedBlock(threaded_machine *Machine, threaded_block *Block)
+{
+    threaded_op *Op = Block->Ops;
+    while(Op)
+    {
+        Op = Op->Handler(Machine, Op);
+    }
+}
+
+static void RunThreaded(threaded_machine *Machine)
+{
+    while(!Machine->Stop)
+    {
+        threaded_block *Block = GetThreadedBlock(Machine);
+        if(Block)
+        {
+            RunThreadedBlock(Machine, Block);
+        }
+    }
+    
+    MaterializeFlags(&Machine->Registers, Machine->Lazy);
+}
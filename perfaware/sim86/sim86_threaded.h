@@ -0,0 +1,120 @@
+#define THREADED_MAX_BLOCK_OPS 64
+#define THREADED_BLOCK_COUNT 4096
+#define THREADED_OP_COUNT (THREADED_BLOCK_COUNT*16)
+#define THREADED_HASH_COUNT 4096
+
+struct threaded_machine;
+struct threaded_op;
+
+// NOTE: Every handler returns the next op to run, or 0 when control has to go back to the dispatcher.
+typedef threaded_op *threaded_handler(threaded_machine *Machine, threaded_op *Op);
+
+enum threaded_operand_form
+{
+    ThreadedForm_None,
+    ThreadedForm_Register,
+    ThreadedForm_Memory,
+    ThreadedForm_Immediate,
+    
+    ThreadedForm_Unsupported,
+};
+
+struct threaded_op
+{
+    threaded_handler *Handler;
+    
+    // NOTE: Operands are resolved when the block is built. Dest and Source point straight into
+    // the register file for the specialized handlers, and Immediate is already converted to what
+    // ExecInstruction would have read. A memory operand is the segment register, the two address terms
+    // (which point at the always-zero register when unused), and the displacement. The generic handler
+    // only uses Instruction.
+    u8 *Dest;
+    u8 *Source;
+    u32 Immediate;
+    
+    u16 *Segment;
+    u16 *Terms[2];
+    u16 Displacement;
+    
+    u16 Size;
+    u16 NextIP;
+    
+    // NOTE: Indexed by whether the branch was taken, or for instructions with a memory operand,
+    // whether the address was odd.
+    instruction_clock_interval Clocks[2];
+    packed_instruction Instruction;
+};
+
+struct threaded_block
+{
+    u16 CS;
+    u16 IP;
+    
+    u32 OpCount; // NOTE: Not counting the exit op at the end
+    threaded_op *Ops;
+    
+    threaded_block *NextInHash;
+    
+    // NOTE: Only used when the JIT is on. The first CompiledOpCount ops have been translated
+    // to machine code, and the rest still run through their handlers.
+    u32 ExecCount;
+    u32 CompiledOpCount;
+    jit_block_function *Compiled;
+};
+
+enum threaded_stop
+{
+    ThreadedStop_None,
+    ThreadedStop_End, // NOTE: cs:ip is past the end of the loaded program
+    ThreadedStop_DecodeError,
+    ThreadedStop_Unimplemented,
+    ThreadedStop_Return, // NOTE: A ret was reached and the machine was asked to stop on those
+};
+
+struct threaded_machine
+{
+    register_state_8086 Registers;
+    
+    // NOTE: The bytes of every block's instructions are watched, so self-modifying code throws
+    // the blocks away instead of running stale ones.
+    segmented_access Memory;
+    memory_watch Watch;
+    
+    u32 OnePastLastByte;
+    b32 StopOnRet;
+    timing_state Timing;
+    
+    // NOTE: Clocks and InstructionCount are running totals for everything executed. Exec is only filled in by the
+    // handlers that have an exec result worth knowing (the generic one, and branches), so anyone who
+    // wants it per instruction has to clear it before each op.
+    instruction_clock_interval Clocks;
+    u64 InstructionCount;
+    exec_result Exec;
+    
+    // NOTE: Lazy points at LazyFlags, or is 0 to compute flags eagerly. Registers.flags is only up to date
+    // after MaterializeFlags, which RunThreaded and RunJIT do before they return.
+    lazy_flags LazyFlags;
+    lazy_flags *Lazy;
+    
+    threaded_stop Stop;
+    threaded_op *StopOp;
+    
+    instruction_table Table;
+    u16 BlockCS;
+    
+    u32 BlockCount;
+    u32 OpCount;
+    threaded_block Blocks[THREADED_BLOCK_COUNT];
+    threaded_op Ops[THREADED_OP_COUNT];
+    threaded_block *Hash[THREADED_HASH_COUNT];
+    
+    jit_code Code;
+};
+
+static threaded_machine *CreateThreadedMachine(segmented_access Memory, u32 OnePastLastByte, timing_state Timing, b32 StopOnRet);
+static void FreeThreadedMachine(threaded_machine *Machine);
+
+static threaded_block *GetThreadedBlock(threaded_machine *Machine);
+static threaded_op *RunThreadedOp(threaded_machine *Machine, threaded_op *Op);
+static void RunThreadedBlock(threaded_machine *Machine, threaded_block *Block);
+static void RunThreaded(threaded_machine *Machine);
@@ -0,0 +1,85 @@
+/* NOTE: A trace is a binary record of every instruction Run8086 executed, with everything needed to
+   print the same text -exec would have printed, but without paying for the printing while simulating.
+
+   The file is a trace_header (which has the registers and clocks the run started with, since a run
+   restored from a snapshot doesn't start from zero), followed by the program's name, followed by one
+   record per step:
+
+       u8 Tag           Low 4 bits are the instruction's byte count, plus the TraceTag_ bits below
+       u24 Address      Absolute address of the instruction
+       u8 Bytes[]       The instruction's bytes, as they were when it was executed
+       u16 Changed      Bit N set means register N changed
+       u16 Values[]     The new value of each changed register, in register order
+       u16 RepCount     Only with TraceTag_Counts
+       u8 ShiftCount    Only with TraceTag_Counts
+       u8 RunCount      Only with TraceTag_Writes, then for each run:
+           u24 Address
+           u32 Count
+           u8 Bytes[Count]
+
+   Clocks are not stored directly. Instead, the step stores the same things exec_result tells the clock
+   estimator (whether the branch was taken, etc.), so the clocks and their explanations come out the same.
+   The header says which timing model the run used, and for -timing biu, the state the prefetch queue
+   started in. The queue depends on every step before it, so the index can't be used to skip ahead then.
+
+   A Tag of 0 ends the steps, and is followed by a trace_end. Then comes an index with an entry every
+   TRACE_INDEX_INTERVAL steps, and a trace_footer at the very end of the file to find it. If the simulator
+   never got to write the end (it crashed, say), the steps are all still there, they just can't be seeked. */
+
+#define TRACE_MAGIC 0x54363853 // NOTE: "S86T"
+#define TRACE_VERSION 3
+#define TRACE_INDEX_INTERVAL 4096
+
+enum trace_tag
+{
+    TraceTag_SizeMask = 0xf,
+    TraceTag_BranchTaken = 0x10,
+    TraceTag_AddressIsUnaligned = 0x20,
+    TraceTag_Counts = 0x40,
+    TraceTag_Writes = 0x80,
+};
+
+enum trace_stop
+{
+    TraceStop_OutOfBounds,
+    TraceStop_Return,
+    TraceStop_Unimplemented,
+    TraceStop_DecodeError,
+};
+
+struct trace_header
+{
+    u32 Magic;
+    u32 Version;
+    u32 SimFlags;
+    u32 Assume8088;
+    u32 SimulateBIU;
+    u32 NameByteCount;
+    u16 Registers[Register_count];
+    instruction_clock_interval Clocks;
+    biu_queue BIU[2];
+};
+
+struct trace_end
+{
+    u32 Stop;
+    u32 StopValue; // NOTE: The address for TraceStop_Return, the operation_type for TraceStop_Unimplemented
+    u16 Registers[Register_count];
+};
+
+struct trace_index_entry
+{
+    u64 Step;
+    u64 Offset;
+    u16 Registers[Register_count];
+    instruction_clock_interval Clocks;
+};
+
+struct trace_footer
+{
+    u64 IndexOffset;
+    u64 IndexCount;
+    u64 StepCount;
+    u32 IndexInterval;
+    u32 Magic;
+};
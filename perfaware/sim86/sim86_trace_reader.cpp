@@ -0,0 +1,259 @@
+static u32 GetU16(u8 *At)
+{
+    u32 Result = At[0] | (At[1] << 8);
+    return Result;
+}
+
+static u32 GetU24(u8 *At)
+{
+    u32 Result = At[0] | (At[1] << 8) | (At[2] << 16);
+    return Result;
+}
+
+static u32 GetU32(u8 *At)
+{
+    u32 Result = GetU16(At) | (GetU16(At + 2) << 16);
+    return Result;
+}
+
+static b32 OpenTrace(trace_reader *Reader, u8 *Data, u64 ByteCount)
+{
+    *Reader = {};
+    Reader->Data = Data;
+    Reader->ByteCount = ByteCount;
+    
+    b32 Result = false;
+    if(ByteCount >= sizeof(trace_header))
+    {
+        memcpy(&Reader->Header, Data, sizeof(Reader->Header));
+        Result = ((Reader->Header.Magic == TRACE_MAGIC) &&
+                  (Reader->Header.Version == TRACE_VERSION) &&
+                  (Reader->Header.NameByteCount <= (ByteCount - sizeof(trace_header))));
+    }
+    
+    if(Result)
+    {
+        // NOTE: The name is not null-terminated in the file, so it gets its own copy.
+        Reader->Name = (char *)calloc(1, Reader->Header.NameByteCount + 1);
+        if(Reader->Name)
+        {
+            memcpy(Reader->Name, Data + sizeof(trace_header), Reader->Header.NameByteCount);
+        }
+        Reader->StepsOffset = sizeof(trace_header) + Reader->Header.NameByteCount;
+        Reader->Offset = Reader->StepsOffset;
+        memcpy(Reader->Registers.u16, Reader->Header.Registers, sizeof(Reader->Header.Registers));
+        
+        if(ByteCount >= (Reader->StepsOffset + sizeof(trace_footer)))
+        {
+            trace_footer Footer;
+            memcpy(&Footer, Data + ByteCount - sizeof(Footer), sizeof(Footer));
+            
+            u64 IndexSize = Footer.IndexCount*sizeof(trace_index_entry);
+            if((Footer.Magic == TRACE_MAGIC) &&
+               (Footer.IndexOffset >= Reader->StepsOffset) &&
+               (Footer.IndexCount <= ByteCount) &&
+               ((Footer.IndexOffset + IndexSize + sizeof(Footer)) == ByteCount))
+            {
+                Reader->Footer = Footer;
+                Reader->Index = (trace_index_entry *)(Data + Footer.IndexOffset);
+            }
+        }
+    }
+    
+    return Result;
+}
+
+static b32 NextTraceStep(trace_reader *Reader, trace_step *Step)
+{
+    b32 Result = false;
+    *Step = {};
+    
+    u8 *Record = Reader->Data + Reader->Offset;
+    u64 Remaining = Reader->ByteCount - Reader->Offset;
+    if(!Reader->Ended && !Reader->Truncated && Remaining)
+    {
+        u32 Tag = Record[0];
+        
+        // NOTE: How long a step is isn't known until its tag and changed mask have been read,
+        // and its writes aren't known until their headers have been read, so the size is checked
+        // against what's left of the file as it goes. Only an unfinished trace would ever come up short.
+        u64 Size = 0;
+        u32 Changed = 0;
+        if(Tag == 0)
+        {
+            Size = 1 + sizeof(trace_end);
+        }
+        else
+        {
+            Size = 1 + 3 + (Tag & TraceTag_SizeMask) + 2;
+            if(Remaining >= Size)
+            {
+                Changed = GetU16(Record + Size - 2);
+                for(u32 RegIndex = 0; RegIndex < Register_count; ++RegIndex)
+                {
+                    if(Changed & (1 << RegIndex))
+                    {
+                        Size += 2;
+                    }
+                }
+                if(Tag & TraceTag_Counts) {Size += 3;}
+                if(Tag & TraceTag_Writes) {Size += 1;}
+            }
+            
+            if((Tag & TraceTag_Writes) && (Remaining >= Size))
+            {
+                u32 RunCount = Record[Size - 1];
+                for(u32 RunIndex = 0; (RunIndex < RunCount) && ((Remaining - Size) >= 7); ++RunIndex)
+                {
+                    Size += 7 + GetU32(Record + Size + 3);
+                }
+            }
+        }
+        
+        if(Remaining < Size)
+        {
+            Reader->Truncated = true;
+        }
+        else if(Tag == 0)
+        {
+            memcpy(&Reader->End, Record + 1, sizeof(Reader->End));
+            Reader->Ended = true;
+            Reader->Offset += Size;
+        }
+        else
+        {
+            u8 *At = Record + 1;
+            
+            Step->ByteCount = Tag & TraceTag_SizeMask;
+            Step->Exec.BranchTaken = (Tag & TraceTag_BranchTaken) != 0;
+            Step->Exec.AddressIsUnaligned = (Tag & TraceTag_AddressIsUnaligned) != 0;
+            
+            Step->Address = GetU24(At);
+            At += 3;
+            Step->Bytes = At;
+            At += Step->ByteCount + 2;
+            
+            for(u32 RegIndex = 0; RegIndex < Register_count; ++RegIndex)
+            {
+                if(Changed & (1 << RegIndex))
+                {
+                    Reader->Registers.u16[RegIndex] = (u16)GetU16(At);
+                    At += 2;
+                }
+            }
+            
+            if(Tag & TraceTag_Counts)
+            {
+                Step->Exec.RepCount = GetU16(At);
+                Step->Exec.ShiftCount = At[2];
+                At += 3;
+            }
+            
+            if(Tag & TraceTag_Writes)
+            {
+                Step->WriteRunCount = *At++;
+                Step->Writes = At;
+            }
+            
+            Reader->Offset += Size;
+            ++Reader->Step;
+            Result = true;
+        }
+    }
+    
+    return Result;
+}
+
+static b32 NextTraceWrite(trace_step *Step, trace_write *Write)
+{
+    b32 Result = false;
+    if(Step->WriteRunCount)
+    {
+        Write->Address = GetU24(Step->Writes);
+        Write->Count = GetU32(Step->Writes + 3);
+        Write->Bytes = Step->Writes + 7;
+        
+        Step->Writes += 7 + Write->Count;
+        --Step->WriteRunCount;
+        Result = true;
+    }
+    
+    return Result;
+}
+
+static void SeekTrace(trace_reader *Reader, u64 Step, timing_state *Timing, instruction_clock_interval *Clocks)
+{
+    // NOTE: Clocks are a running total, so unless they come from the index, every step before
+    // Step has to be run through the clock estimator. If the trace was never finished, it has no index.
+    // Clocks is optional, and nothing is estimated without it. Timing gets the timing state for Step.
+    instruction_table Table = Get8086InstructionTable();
+    *Timing = {};
+    Timing->Assume8088 = Reader->Header.Assume8088;
+    Timing->SimulateBIU = Reader->Header.SimulateBIU;
+    memcpy(Timing->BIU, Reader->Header.BIU, sizeof(Timing->BIU));
+    b32 UseIndex = !(Clocks && Timing->SimulateBIU);
+    
+    Reader->Offset = Reader->StepsOffset;
+    Reader->Step = 0;
+    Reader->Ended = false;
+    Reader->Truncated = false;
+    memcpy(Reader->Registers.u16, Reader->Header.Registers, sizeof(Reader->Header.Registers));
+    instruction_clock_interval Accum = Reader->Header.Clocks;
+    
+    if(UseIndex && Reader->Footer.IndexCount)
+    {
+        u64 Low = 0;
+        u64 High = Reader->Footer.IndexCount;
+        while((High - Low) > 1)
+        {
+            u64 Mid = (Low + High) / 2;
+            if(Reader->Index[Mid].Step <= Step)
+            {
+                Low = Mid;
+            }
+            else
+            {
+                High = Mid;
+            }
+        }
+        
+        trace_index_entry Entry;
+        memcpy(&Entry, Reader->Index + Low, sizeof(Entry));
+        if(Entry.Step <= Step)
+        {
+            Reader->Offset = Entry.Offset;
+            Reader->Step = Entry.Step;
+            memcpy(Reader->Registers.u16, Entry.Registers, sizeof(Entry.Registers));
+            Accum = Entry.Clocks;
+        }
+    }
+    
+    while(Reader->Step < Step)
+    {
+        u64 PrevOffset = Reader->Offset;
+        trace_step Skipped;
+        if(!NextTraceStep(Reader, &Skipped))
+        {
+            // NOTE: Put the end back, so the caller still sees it when it asks for the next step.
+            Reader->Offset = PrevOffset;
+            Reader->Ended = false;
+            break;
+        }
+        
+        if(Clocks)
+        {
+            u8 Buffer[64] = {};
+            memcpy(Buffer, Skipped.Bytes, Skipped.ByteCount);
+            instruction Instruction = DecodeInstruction(Table, FixedMemoryPow2(6, Buffer));
+            UpdateTimingForExec(Timing, Skipped.Exec);
+            instruction_clock_interval StepClocks = ClocksForExec(Timing, Instruction, EstimateInstructionClocks(*Timing, Instruction));
+            Accum.Min += StepClocks.Min;
+            Accum.Max += StepClocks.Max;
+        }
+    }
+    
+    if(Clocks)
+    {
+        *Clocks = Accum;
+    }
+}
@@ -0,0 +1,47 @@
+/* NOTE: Reading traces back is only done by the tools that look at them (see sim86_trace_replay.cpp), so it lives
+   apart from the writing, which is all the simulator itself needs. The format is in sim86_trace.h. */
+
+struct trace_step
+{
+    u32 Address;
+    u32 ByteCount;
+    u8 *Bytes;
+    exec_result Exec;
+    
+    u32 WriteRunCount;
+    u8 *Writes; // NOTE: Still in the file's format, see NextTraceWrite
+};
+
+struct trace_write
+{
+    u32 Address;
+    u32 Count;
+    u8 *Bytes;
+};
+
+struct trace_reader
+{
+    u8 *Data;
+    u64 ByteCount;
+    
+    trace_header Header;
+    char *Name;
+    
+    trace_footer Footer; // NOTE: Zero if the trace was never finished
+    trace_index_entry *Index;
+    
+    u64 StepsOffset;
+    u64 Offset;
+    u64 Step;
+    
+    register_state_8086 Registers;
+    
+    b32 Ended;
+    b32 Truncated;
+    trace_end End;
+};
+
+static b32 OpenTrace(trace_reader *Reader, u8 *Data, u64 ByteCount);
+static b32 NextTraceStep(trace_reader *Reader, trace_step *Step);
+static b32 NextTraceWrite(trace_step *Step, trace_write *Write);
+static void SeekTrace(trace_reader *Reader, u64 Step, timing_state *Timing, instruction_clock_interval *Clocks);
@@ -0,0 +1,205 @@
+/* NOTE: This prints a trace written by sim86 -exec -trace as the text sim86 -exec would have
+   printed for that run, with the same flags. -showclocks and -explainclocks can be added on top of the
+   flags the trace was written with, since clocks are worked out from the trace rather than stored in it.
+
+   -from N starts printing at step N (counting from 0), using the trace's index to get there without
+   reading all the steps before it, and -count N stops after printing N steps. The final registers are
+   only printed if the printing gets to the end of the trace. -writes also prints the bytes each step
+   wrote to memory.
+
+   Usage: sim86_trace_replay [-showclocks] [-explainclocks] [-writes] [-from N] [-count N] trace...
+*/
+
+#include "sim86.h"
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "sim86_instruction.h"
+#include "sim86_instruction_table.h"
+#include "sim86_memory.h"
+#include "sim86_decode.h"
+#include "sim86_execute.h"
+#include "sim86_cycles.h"
+#include "sim86_text.h"
+#include "sim86_trace.h"
+#include "sim86_trace_reader.h"
+#include "sim86_platform.h"
+
+#include "sim86_instruction.cpp"
+#include "sim86_instruction_table.cpp"
+#include "sim86_memory.cpp"
+#include "sim86_decode.cpp"
+#include "sim86_execute.cpp"
+#include "sim86_cycles.cpp"
+#include "sim86_text_table.cpp"
+#include "sim86_text.cpp"
+#include "sim86_trace_reader.cpp"
+#include "sim86_platform.cpp"
+
+static void PrintTraceWrites(trace_step Step)
+{
+    trace_write Write;
+    while(NextTraceWrite(&Step, &Write))
+    {
+        printf("    wrote 0x%05x:", Write.Address);
+        for(u32 Index = 0; (Index < Write.Count) && (Index < 16); ++Index)
+        {
+            printf(" %02x", Write.Bytes[Index]);
+        }
+        if(Write.Count > 16)
+        {
+            printf(" ... (%u bytes)", Write.Count);
+        }
+        printf("\n");
+    }
+}
+
+static void ReplayTrace(trace_reader *Reader, u32 SimFlags, b32 ShowWrites, u64 FromStep, u64 StepCount)
+{
+    instruction_table Table = Get8086InstructionTable();
+    
+    timing_state Timing = {};
+    instruction_clock_interval TimeAccum = {};
+    
+    if(SimFlags & SimFlag_ShowClocks)
+    {
+        PrintClockWarning(stdout);
+    }
+    printf("--- %s execution ---\n", Reader->Name);
+    
+    SeekTrace(Reader, FromStep, &Timing, (SimFlags & SimFlag_ShowClocks) ? &TimeAccum : 0);
+    
+    u64 Printed = 0;
+    while(Printed < StepCount)
+    {
+        register_state_8086 PrevRegisters = Reader->Registers;
+        
+        trace_step Step;
+        if(!NextTraceStep(Reader, &Step))
+        {
+            break;
+        }
+        
+        // NOTE: The decoder can read past the end of the instruction, so it gets zeroes after it.
+        u8 Buffer[64] = {};
+        memcpy(Buffer, Step.Bytes, Step.ByteCount);
+        instruction Instruction = DecodeInstruction(Table, FixedMemoryPow2(6, Buffer));
+        Instruction.Address = Step.Address;
+        
+        PrintExecutedInstruction(Instruction, Step.Exec, &PrevRegisters, &Reader->Registers, SimFlags, &Timing, &TimeAccum, stdout);
+        if(ShowWrites)
+        {
+            PrintTraceWrites(Step);
+        }
+        
+        ++Printed;
+    }
+    
+    if(Printed < StepCount)
+    {
+        if(Reader->Ended)
+        {
+            trace_end End = Reader->End;
+            switch(End.Stop)
+            {
+                case TraceStop_Return:
+                {
+                    fprintf(stdout, "STOPONRET: Return encountered at address %u.\n", End.StopValue);
+                } break;
+                
+                case TraceStop_Unimplemented:
+                {
+                    printf("ERROR: Unimplemented instruction (%s).\n", GetMnemonic((operation_type)End.StopValue));
+                } break;
+                
+                case TraceStop_DecodeError:
+                {
+                    fprintf(stderr, "ERROR: Unrecognized binary in instruction stream.\n");
+                } break;
+                
+                default: {} break;
+            }
+            
+            register_state_8086 Registers = {};
+            memcpy(Registers.u16, End.Registers, sizeof(End.Registers));
+            PrintFinalRegisters(&Registers, stdout);
+        }
+        else if(Reader->Truncated)
+        {
+            fprintf(stderr, "WARNING: Trace ends after step %llu without finishing.\n", (unsigned long long)Reader->Step);
+        }
+    }
+}
+
+int main(int ArgCount, char **Args)
+{
+    u32 ExtraFlags = 0;
+    b32 ShowWrites = false;
+    u64 FromStep = 0;
+    u64 StepCount = (u64)-1;
+    
+    if(ArgCount > 1)
+    {
+        for(int ArgIndex = 1; ArgIndex < ArgCount; ++ArgIndex)
+        {
+            char *FileName = Args[ArgIndex];
+            
+            if(strcmp(FileName, "-showclocks") == 0)
+            {
+                ExtraFlags |= SimFlag_ShowClocks;
+            }
+            else if(strcmp(FileName, "-explainclocks") == 0)
+            {
+                ExtraFlags |= SimFlag_ShowClocks|SimFlag_ExplainClocks;
+            }
+            else if(strcmp(FileName, "-writes") == 0)
+            {
+                ShowWrites = true;
+            }
+            else if((strcmp(FileName, "-from") == 0) && ((ArgIndex + 1) < ArgCount))
+            {
+                FromStep = strtoull(Args[++ArgIndex], 0, 10);
+            }
+            else if((strcmp(FileName, "-count") == 0) && ((ArgIndex + 1) < ArgCount))
+            {
+                StepCount = strtoull(Args[++ArgIndex], 0, 10);
+            }
+            else
+            {
+                mapped_file Mapped = MapFileForRead(FileName, 0);
+                if(Mapped.Data)
+                {
+                    trace_reader Reader;
+                    if(OpenTrace(&Reader, Mapped.Data, Mapped.ByteCount))
+                    {
+                        // NOTE: Everything gets printed, even if the trace was written with -quiet.
+                        u32 SimFlags = (Reader.Header.SimFlags & ~SimFlag_Quiet) | ExtraFlags;
+                        ReplayTrace(&Reader, SimFlags, ShowWrites, FromStep, StepCount);
+                        free(Reader.Name);
+                    }
+                    else
+                    {
+                        fprintf(stderr, "ERROR: %s is not a sim86 trace.\n", FileName);
+                    }
+                    
+                    UnmapFile(&Mapped);
+                }
+                else
+                {
+                    fprintf(stderr, "ERROR: Unable to map %s.\n", FileName);
+                }
+            }
+        }
+    }
+    else
+    {
+        fprintf(stderr, "USAGE: %s [-showclocks] [-explainclocks] [-writes] [-from N] [-count N] [sim86 trace file] ...\n", Args[0]);
+    }
+    
+    return 0;
+}
@@ -0,0 +1,231 @@
+static void FlushTrace(trace_writer *Trace)
+{
+    if(Trace->BufferUsed)
+    {
+        fwrite(Trace->Buffer, Trace->BufferUsed, 1, Trace->File);
+        Trace->FlushedByteCount += Trace->BufferUsed;
+        Trace->BufferUsed = 0;
+    }
+}
+
+static void PutTraceBytes(trace_writer *Trace, void *Source, u32 Count)
+{
+    if((TRACE_BUFFER_SIZE - Trace->BufferUsed) < Count)
+    {
+        FlushTrace(Trace);
+    }
+    
+    if(Count <= TRACE_BUFFER_SIZE)
+    {
+        memcpy(Trace->Buffer + Trace->BufferUsed, Source, Count);
+        Trace->BufferUsed += Count;
+    }
+    else
+    {
+        fwrite(Source, Count, 1, Trace->File);
+        Trace->FlushedByteCount += Count;
+    }
+}
+
+static u64 GetTraceOffset(trace_writer *Trace)
+{
+    u64 Result = Trace->FlushedByteCount + Trace->BufferUsed;
+    return Result;
+}
+
+static u8 *PutU16(u8 *At, u32 Value)
+{
+    At[0] = (u8)Value;
+    At[1] = (u8)(Value >> 8);
+    return At + 2;
+}
+
+static u8 *PutU24(u8 *At, u32 Value)
+{
+    At[0] = (u8)Value;
+    At[1] = (u8)(Value >> 8);
+    At[2] = (u8)(Value >> 16);
+    return At + 3;
+}
+
+static u8 *PutU32(u8 *At, u32 Value)
+{
+    At = PutU16(At, Value);
+    At = PutU16(At, Value >> 16);
+    return At;
+}
+
+static b32 BeginTrace(trace_writer *Trace, char *TraceFileName, char *ProgramName, u32 SimFlags, timing_state Timing,
+                      register_state_8086 *Registers, instruction_clock_interval Clocks)
+{
+    *Trace = {};
+    Trace->File = fopen(TraceFileName, "wb");
+    Trace->Buffer = (u8 *)malloc(TRACE_BUFFER_SIZE);
+    
+    b32 Result = (Trace->File && Trace->Buffer);
+    if(Result)
+    {
+        trace_header Header = {};
+        Header.Magic = TRACE_MAGIC;
+        Header.Version = TRACE_VERSION;
+        Header.SimFlags = SimFlags;
+        Header.Assume8088 = Timing.Assume8088;
+        Header.SimulateBIU = Timing.SimulateBIU;
+        memcpy(Header.BIU, Timing.BIU, sizeof(Header.BIU));
+        Header.NameByteCount = (u32)strlen(ProgramName);
+        memcpy(Header.Registers, Registers->u16, sizeof(Header.Registers));
+        Header.Clocks = Clocks;
+        
+        PutTraceBytes(Trace, &Header, sizeof(Header));
+        PutTraceBytes(Trace, ProgramName, Header.NameByteCount);
+    }
+    else
+    {
+        fprintf(stderr, "ERROR: Unable to create trace file %s.\n", TraceFileName);
+        if(Trace->File)
+        {
+            fclose(Trace->File);
+        }
+        free(Trace->Buffer);
+        *Trace = {};
+    }
+    
+    return Result;
+}
+
+static void BeginTraceStep(trace_writer *Trace, segmented_access At, instruction Instruction,
+                           register_state_8086 *Registers, instruction_clock_interval Clocks)
+{
+    // NOTE: The bytes have to be saved before the instruction executes, since it might overwrite itself.
+    Trace->Address = GetAbsoluteAddressOf(At);
+    Trace->ByteCount = Instruction.Size;
+    for(u32 ByteIndex = 0; ByteIndex < Instruction.Size; ++ByteIndex)
+    {
+        Trace->Bytes[ByteIndex] = *AccessMemory(At, (u16)ByteIndex);
+    }
+    
+    Trace->PrevRegisters = *Registers;
+    Trace->PrevClocks = Clocks;
+    Trace->WriteLog.RunCount = 0;
+    Trace->WriteLog.Overflowed = false;
+}
+
+static void EndTraceStep(trace_writer *Trace, segmented_access Memory, exec_result Exec, register_state_8086 *Registers)
+{
+    if((Trace->StepCount % TRACE_INDEX_INTERVAL) == 0)
+    {
+        if(Trace->IndexCount == Trace->IndexCapacity)
+        {
+            u32 NewCapacity = Trace->IndexCapacity ? 2*Trace->IndexCapacity : 256;
+            trace_index_entry *NewIndex = (trace_index_entry *)realloc(Trace->Index, NewCapacity*sizeof(trace_index_entry));
+            if(NewIndex)
+            {
+                Trace->Index = NewIndex;
+                Trace->IndexCapacity = NewCapacity;
+            }
+        }
+        
+        // NOTE: If the index couldn't grow, seeking just has to read more steps to get where it's going.
+        if(Trace->IndexCount < Trace->IndexCapacity)
+        {
+            trace_index_entry *Entry = Trace->Index + Trace->IndexCount++;
+            Entry->Step = Trace->StepCount;
+            Entry->Offset = GetTraceOffset(Trace);
+            memcpy(Entry->Registers, Trace->PrevRegisters.u16, sizeof(Entry->Registers));
+            Entry->Clocks = Trace->PrevClocks;
+        }
+    }
+    
+    u8 Record[TRACE_MAX_STEP_SIZE];
+    u8 *At = Record + 1;
+    
+    u32 Tag = Trace->ByteCount;
+    if(Exec.BranchTaken) {Tag |= TraceTag_BranchTaken;}
+    if(Exec.AddressIsUnaligned) {Tag |= TraceTag_AddressIsUnaligned;}
+    if(Exec.RepCount || Exec.ShiftCount) {Tag |= TraceTag_Counts;}
+    if(Trace->WriteLog.RunCount) {Tag |= TraceTag_Writes;}
+    Record[0] = (u8)Tag;
+    
+    At = PutU24(At, Trace->Address);
+    memcpy(At, Trace->Bytes, Trace->ByteCount);
+    At += Trace->ByteCount;
+    
+    u8 *ChangedAt = At;
+    At += 2;
+    u32 Changed = 0;
+    for(u32 RegIndex = 0; RegIndex < Register_count; ++RegIndex)
+    {
+        if(Registers->u16[RegIndex] != Trace->PrevRegisters.u16[RegIndex])
+        {
+            Changed |= (1 << RegIndex);
+            At = PutU16(At, Registers->u16[RegIndex]);
+        }
+    }
+    PutU16(ChangedAt, Changed);
+    
+    if(Tag & TraceTag_Counts)
+    {
+        At = PutU16(At, Exec.RepCount);
+        *At++ = (u8)Exec.ShiftCount;
+    }
+    
+    if(Tag & TraceTag_Writes)
+    {
+        *At++ = (u8)Trace->WriteLog.RunCount;
+    }
+    
+    PutTraceBytes(Trace, Record, (u32)(At - Record));
+    
+    // NOTE: Written bytes are read back out of memory after the step, so they are the final values even
+    // if the instruction wrote the same address more than once.
+    for(u32 RunIndex = 0; RunIndex < Trace->WriteLog.RunCount; ++RunIndex)
+    {
+        memory_write_run Run = Trace->WriteLog.Runs[RunIndex];
+        
+        u8 RunHeader[7];
+        PutU32(PutU24(RunHeader, Run.Address), Run.Count);
+        PutTraceBytes(Trace, RunHeader, sizeof(RunHeader));
+        
+        u8 *Source = Memory.Memory + (Run.Address & Memory.Mask);
+        u32 Contiguous = (Memory.Mask + 1) - (Run.Address & Memory.Mask);
+        if(Contiguous > Run.Count)
+        {
+            Contiguous = Run.Count;
+        }
+        PutTraceBytes(Trace, Source, Contiguous);
+        PutTraceBytes(Trace, Memory.Memory, Run.Count - Contiguous);
+    }
+    
+    ++Trace->StepCount;
+}
+
+static void EndTrace(trace_writer *Trace, trace_stop Stop, u32 StopValue, register_state_8086 *Registers)
+{
+    if(Trace->File)
+    {
+        u8 Tag = 0;
+        PutTraceBytes(Trace, &Tag, 1);
+        
+        trace_end End = {};
+        End.Stop = Stop;
+        End.StopValue = StopValue;
+        memcpy(End.Registers, Registers->u16, sizeof(End.Registers));
+        PutTraceBytes(Trace, &End, sizeof(End));
+        
+        trace_footer Footer = {};
+        Footer.IndexOffset = GetTraceOffset(Trace);
+        Footer.IndexCount = Trace->IndexCount;
+        Footer.StepCount = Trace->StepCount;
+        Footer.IndexInterval = TRACE_INDEX_INTERVAL;
+        Footer.Magic = TRACE_MAGIC;
+        PutTraceBytes(Trace, Trace->Index, Trace->IndexCount*sizeof(trace_index_entry));
+        PutTraceBytes(Trace, &Footer, sizeof(Footer));
+        
+        FlushTrace(Trace);
+        fclose(Trace->File);
+    }
+    
+    free(Trace->Buffer);
+    free(Trace->Index);
+    *Trace = {};
+}
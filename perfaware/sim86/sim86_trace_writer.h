@@ -0,0 +1,34 @@
+/* NOTE: Writing traces is only done by the simulator itself, so it lives apart from the reading (see
+   sim86_trace_reader.h), which is all the tools that look at traces need. The format is in sim86_trace.h. */
+
+#define TRACE_BUFFER_SIZE (1024*1024)
+#define TRACE_MAX_STEP_SIZE (1 + 3 + 15 + 2 + 2*Register_count + 2 + 1 + 1)
+
+struct trace_writer
+{
+    FILE *File;
+    u8 *Buffer;
+    u32 BufferUsed;
+    u64 FlushedByteCount;
+    
+    u64 StepCount;
+    u32 IndexCount;
+    u32 IndexCapacity;
+    trace_index_entry *Index;
+    
+    // NOTE: Saved by BeginTraceStep, for EndTraceStep
+    u32 Address;
+    u32 ByteCount;
+    u8 Bytes[16];
+    register_state_8086 PrevRegisters;
+    instruction_clock_interval PrevClocks;
+    
+    memory_write_log WriteLog;
+};
+
+static b32 BeginTrace(trace_writer *Trace, char *TraceFileName, char *ProgramName, u32 SimFlags, timing_state Timing,
+                      register_state_8086 *Registers, instruction_clock_interval Clocks);
+static void BeginTraceStep(trace_writer *Trace, segmented_access At, instruction Instruction,
+                           register_state_8086 *Registers, instruction_clock_interval Clocks);
+static void EndTraceStep(trace_writer *Trace, segmented_access Memory, exec_result Exec, register_state_8086 *Registers);
+static void EndTrace(trace_writer *Trace, trace_stop Stop, u32 StopValue, register_state_8086 *Registers);